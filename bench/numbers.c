@@ -0,0 +1,137 @@
+//
+// Number parsing/formatting benchmark: json_number_parse vs strtod, json_number_format vs printf
+//
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinyjson.h"
+
+#define COUNT 1000000
+#define ROUNDS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// a set of inputs: the doubles, and their text as printed by %.17g (one buffer, null-separated)
+typedef struct corpus {
+    const char* name;
+    double* values;
+    char** texts;
+    char* storage;
+} corpus;
+
+static void make_corpus(corpus* c, const char* name, double (*generate)(void)) {
+    c->name = name;
+    c->values = malloc(COUNT * sizeof(double));
+    c->texts = malloc(COUNT * sizeof(char*));
+    c->storage = malloc(COUNT * 32);
+    char* pos = c->storage;
+    for (int i = 0; i < COUNT; i++) {
+        c->values[i] = generate();
+        c->texts[i] = pos;
+        pos += sprintf(pos, "%.17g", c->values[i]) + 1;
+    }
+}
+
+static void free_corpus(corpus* c) {
+    free(c->values);
+    free(c->texts);
+    free(c->storage);
+}
+
+// uniformly random bit patterns (mostly huge/tiny magnitudes)
+static double random_bits(void) {
+    double d;
+    do {
+        uint64_t bits = next_random();
+        memcpy(&d, &bits, sizeof(d));
+    } while (!isfinite(d));
+    return d;
+}
+
+// prices/measurements: a handful of digits after the point
+static double random_decimal(void) {
+    return (double)(next_random() % 100000000) / 1000.0;
+}
+
+// ids and timestamps
+static double random_integer(void) {
+    return (double)(next_random() % 10000000000000ULL);
+}
+
+static double sink_total;
+
+static void bench_parse(const corpus* c) {
+    double best_ours = 1e9, best_libc = 1e9;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = now();
+        for (int i = 0; i < COUNT; i++) {
+            double value;
+            json_number_parse(c->texts[i], NULL, &value);
+            sink_total += value;
+        }
+        double mid = now();
+        for (int i = 0; i < COUNT; i++) {
+            sink_total += strtod(c->texts[i], NULL);
+        }
+        double end = now();
+        if (mid - start < best_ours) best_ours = mid - start;
+        if (end - mid < best_libc) best_libc = end - mid;
+    }
+    printf("parse  %-8s json_number_parse %6.1f ns   strtod %6.1f ns   (%.2fx)\n", c->name,
+           best_ours * 1e9 / COUNT, best_libc * 1e9 / COUNT, best_libc / best_ours);
+}
+
+static void bench_format(const corpus* c) {
+    char buffer[64];
+    double best_ours = 1e9, best_libc = 1e9;
+    for (int round = 0; round < ROUNDS; round++) {
+        double start = now();
+        for (int i = 0; i < COUNT; i++) {
+            sink_total += json_number_format(c->values[i], buffer);
+        }
+        double mid = now();
+        for (int i = 0; i < COUNT; i++) {
+            sink_total += snprintf(buffer, sizeof(buffer), "%.17g", c->values[i]);
+        }
+        double end = now();
+        if (mid - start < best_ours) best_ours = mid - start;
+        if (end - mid < best_libc) best_libc = end - mid;
+    }
+    printf("format %-8s json_number_format %5.1f ns   %%.17g  %6.1f ns   (%.2fx)\n", c->name,
+           best_ours * 1e9 / COUNT, best_libc * 1e9 / COUNT, best_libc / best_ours);
+}
+
+int main(int argc, char **argv) {
+    corpus corpora[3];
+    make_corpus(&corpora[0], "bits", random_bits);
+    make_corpus(&corpora[1], "decimal", random_decimal);
+    make_corpus(&corpora[2], "integer", random_integer);
+    for (int i = 0; i < 3; i++) {
+        bench_parse(&corpora[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        bench_format(&corpora[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        free_corpus(&corpora[i]);
+    }
+    return sink_total == 42; // keep the loops from being optimized away
+}
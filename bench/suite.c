@@ -0,0 +1,497 @@
+//
+// Document benchmark suite: parse, serialize, lookup and free timed separately over generated corpora
+// (plus saving and loading the binary form, to compare against parse and serialize)
+// (twitter-like records, canada-like coordinate arrays, integer telemetry samples, deep nesting, wide objects, long strings)
+// plus any JSON files given on the command line, and NDJSON of many small records parsed with 1, 2 and 4 threads
+//
+// usage: tinyjson_bench [--json] [--rounds N] [file...]
+//   --json     print one JSON object per corpus and phase instead of a table
+//   --rounds   timing rounds per phase, the best one is reported (default 5)
+//
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinyjson.h"
+
+// ALLOCATION COUNTING
+// malloc and friends are interposed (the library's calls resolve to these too) and forwarded to glibc's own
+// on other C libraries there's no portable way to forward, so allocations just aren't counted
+
+static int counting;
+static uint64_t alloc_count;
+static uint64_t alloc_bytes;
+
+#if defined(__GLIBC__)
+#define BENCH_COUNT_ALLOCS 1
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += n * size;
+    }
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (counting) {
+        alloc_count++;
+        alloc_bytes += size;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+#endif
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// CORPORA
+
+static uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random(void) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// growable text buffer the generators print into
+typedef struct text {
+    char* data;
+    size_t length;
+    size_t capacity;
+} text;
+
+__attribute__((format(printf, 2, 3))) static void append(text* t, const char* format, ...) {
+    va_list args;
+    while (1) {
+        va_start(args, format);
+        int n = vsnprintf(t->data + t->length, t->capacity - t->length, format, args);
+        va_end(args);
+        if (n >= 0 && t->length + n < t->capacity) {
+            t->length += n;
+            return;
+        }
+        t->capacity = t->capacity ? t->capacity * 2 : 1 << 16;
+        t->data = realloc(t->data, t->capacity);
+    }
+}
+
+static const char* words[] = { "json", "parse", "tiny", "fast", "tape", "arena", "value", "lookup", "the", "a", "of", "caf\\u00e9", "\\\"quoted\\\"", "line\\nbreak" };
+
+static void append_sentence(text* t, int count) {
+    for (int i = 0; i < count; i++) {
+        append(t, "%s%s", i ? " " : "", words[next_random() % (sizeof(words) / sizeof(words[0]))]);
+    }
+}
+
+// an array of status-like records: ids, short and long strings, a nested user object, small arrays, bools and nulls
+static char* generate_twitter(void) {
+    text t = {0};
+    append(&t, "{\"statuses\":[");
+    for (int i = 0; i < 2000; i++) {
+        append(&t, "%s{\"id\":%llu,\"id_str\":\"%llu\",\"text\":\"", i ? "," : "", (unsigned long long)(next_random() >> 4),
+               (unsigned long long)(next_random() >> 4));
+        append_sentence(&t, 5 + (int)(next_random() % 20));
+        append(&t, "\",\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":%d,\"name\":\"user%d\",\"screen_name\":\"u%d\","
+                   "\"followers_count\":%d,\"verified\":%s,\"description\":\"",
+               i * 7, i, i, (int)(next_random() % 100000), next_random() % 2 ? "true" : "false");
+        append_sentence(&t, 8);
+        append(&t, "\"},\"entities\":{\"hashtags\":[\"tag%d\",\"tag%d\"],\"urls\":[]},\"retweet_count\":%d,\"favorited\":false,\"lang\":\"en\"}",
+               i % 13, i % 7, (int)(next_random() % 1000));
+    }
+    append(&t, "],\"search_metadata\":{\"count\":2000,\"completed_in\":0.087}}");
+    return t.data;
+}
+
+// polygons as nested arrays of [longitude, latitude] pairs with full double precision
+static char* generate_canada(void) {
+    text t = {0};
+    append(&t, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[");
+    for (int ring = 0; ring < 50; ring++) {
+        append(&t, "%s[", ring ? "," : "");
+        for (int i = 0; i < 2000; i++) {
+            double lon = -140.0 + (double)(next_random() % 1000000000) / 1e7;
+            double lat = 42.0 + (double)(next_random() % 1000000000) / 2e7;
+            append(&t, "%s[%.15g,%.15g]", i ? "," : "", lon, lat);
+        }
+        append(&t, "]");
+    }
+    append(&t, "]}}]}");
+    return t.data;
+}
+
+// records of sensor readings: long arrays of integers, timestamps included
+static char* generate_telemetry(void) {
+    text t = {0};
+    append(&t, "[");
+    for (int record = 0; record < 500; record++) {
+        append(&t, "%s{\"sensor\":\"s%d\",\"timestamps\":[", record ? "," : "", record % 40);
+        for (int i = 0; i < 200; i++) {
+            append(&t, "%s%lld", i ? "," : "", 1700000000000LL + record * 1000000LL + i * 250);
+        }
+        append(&t, "],\"samples\":[");
+        for (int i = 0; i < 200; i++) {
+            append(&t, "%s%d", i ? "," : "", (int)(next_random() % 200000) - 100000);
+        }
+        append(&t, "]}");
+    }
+    append(&t, "]");
+    return t.data;
+}
+
+// newline-delimited records, each one small, so most of the time goes to handing rounds of them out to the workers
+static char* generate_records(void) {
+    text t = {0};
+    for (int i = 0; i < 200000; i++) {
+        append(&t, "{\"id\":%d,\"ok\":%s,\"tag\":\"t%d\"}\n", i, i % 3 ? "true" : "false", (int)(next_random() % 50));
+    }
+    return t.data;
+}
+
+// objects and arrays nested a few hundred levels deep, many times over
+static char* generate_nested(void) {
+    text t = {0};
+    append(&t, "[");
+    for (int copy = 0; copy < 200; copy++) {
+        append(&t, "%s", copy ? "," : "");
+        for (int depth = 0; depth < 200; depth++) {
+            append(&t, depth % 2 ? "[%d," : "{\"k%d\":", depth);
+        }
+        append(&t, "null");
+        for (int depth = 199; depth >= 0; depth--) {
+            append(&t, depth % 2 ? "]" : "}");
+        }
+    }
+    append(&t, "]");
+    return t.data;
+}
+
+// a few objects with thousands of distinct keys each
+static char* generate_wide(void) {
+    text t = {0};
+    append(&t, "[");
+    for (int object = 0; object < 20; object++) {
+        append(&t, "%s{", object ? "," : "");
+        for (int i = 0; i < 5000; i++) {
+            append(&t, "%s\"field_%d_%d\":%d", i ? "," : "", object, i, i);
+        }
+        append(&t, "}");
+    }
+    append(&t, "]");
+    return t.data;
+}
+
+// a handful of very long strings, with the odd escape
+static char* generate_strings(void) {
+    text t = {0};
+    append(&t, "[");
+    for (int i = 0; i < 40; i++) {
+        append(&t, "%s\"", i ? "," : "");
+        for (int j = 0; j < 4000; j++) {
+            append(&t, j % 100 == 99 ? "esc\\\"aped " : "some text ");
+        }
+        append(&t, "\"");
+    }
+    append(&t, "]");
+    return t.data;
+}
+
+static char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    text t = {0};
+    char chunk[1 << 16];
+    size_t n;
+    append(&t, "%s", "");
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        append(&t, "%.*s", (int)n, chunk);
+    }
+    fclose(f);
+    return t.data;
+}
+
+// MEASURING
+
+typedef struct result {
+    double seconds; // best round
+    uint64_t allocs; // allocations in that round
+    uint64_t bytes;
+} result;
+
+static void start_round(void) {
+    alloc_count = 0;
+    alloc_bytes = 0;
+    counting = 1;
+}
+
+static void end_round(result* r, double seconds) {
+    counting = 0;
+    if (r->seconds == 0 || seconds < r->seconds) {
+        r->seconds = seconds;
+        r->allocs = alloc_count;
+        r->bytes = alloc_bytes;
+    }
+}
+
+static size_t count_nodes(jvalue* v) {
+    size_t count = 1;
+    if (v->type == JSON_OBJECT) {
+        for (size_t i = 0; i < v->length; i++) {
+            count += count_nodes(&v->members[i].value);
+        }
+    } else if (v->type == JSON_ARRAY) {
+        for (size_t i = 0; i < v->length; i++) {
+            count += count_nodes(&v->elements[i]);
+        }
+    }
+    return count;
+}
+
+static size_t found;
+
+// look every key of every object up again
+static void lookup_all(jvalue* v) {
+    if (v->type == JSON_OBJECT) {
+        for (size_t i = 0; i < v->length; i++) {
+            found += json_search_by_key(v->members[i].key, v) != NULL;
+            lookup_all(&v->members[i].value);
+        }
+    } else if (v->type == JSON_ARRAY) {
+        for (size_t i = 0; i < v->length; i++) {
+            lookup_all(&v->elements[i]);
+        }
+    }
+}
+
+static void report(const char* corpus, const char* phase, const result* r, size_t input, size_t nodes, int json) {
+    const double mbs = input / r->seconds / (1024.0 * 1024.0);
+    const double ns = r->seconds * 1e9 / nodes;
+    if (json) {
+        printf("{\"corpus\":\"%s\",\"phase\":\"%s\",\"bytes\":%zu,\"nodes\":%zu,\"seconds\":%.9f,\"mb_per_s\":%.2f,\"ns_per_node\":%.2f,"
+               "\"allocs\":%llu,\"alloc_bytes\":%llu}\n",
+               corpus, phase, input, nodes, r->seconds, mbs, ns, (unsigned long long)r->allocs, (unsigned long long)r->bytes);
+        return;
+    }
+#ifdef BENCH_COUNT_ALLOCS
+    printf("%-10s %-9s %9.1f MB/s %8.1f ns/node %10llu allocs %12llu bytes\n", corpus, phase, mbs, ns,
+           (unsigned long long)r->allocs, (unsigned long long)r->bytes);
+#else
+    printf("%-10s %-9s %9.1f MB/s %8.1f ns/node\n", corpus, phase, mbs, ns);
+#endif
+}
+
+static int bench_corpus(const char* name, char* input, int rounds, int json) {
+    const size_t length = strlen(input);
+    result parse = {0}, interned = {0}, packed = {0}, serialize = {0}, lookup = {0}, release = {0}, encode = {0}, decode = {0}, load = {0};
+    size_t nodes = 0;
+    // shared by every round, like a table shared by a stream of documents with the same shape
+    jintern* table = json_intern_create();
+    for (int round = 0; round < rounds; round++) {
+        char* cursor = input;
+        jvalue* value = calloc(1, sizeof(jvalue));
+        start_round();
+        double start = now();
+        int failed = json_parse_value(&cursor, value);
+        end_round(&parse, now() - start);
+        if (failed) {
+            fprintf(stderr, "%s: parse failed\n", name);
+            json_free_value(value);
+            json_intern_destroy(table);
+            return 1;
+        }
+        nodes = count_nodes(value);
+
+        jvalue* shared = calloc(1, sizeof(jvalue));
+        const jparse_options intern_opts = { .intern = table };
+        start_round();
+        start = now();
+        json_parse_n(input, length, shared, &intern_opts, NULL);
+        end_round(&interned, now() - start);
+        json_free_value(shared);
+
+        jvalue* numbers = calloc(1, sizeof(jvalue));
+        const jparse_options pack_opts = { .flags = JSON_PARSE_PACK_NUMBERS };
+        start_round();
+        start = now();
+        json_parse_n(input, length, numbers, &pack_opts, NULL);
+        end_round(&packed, now() - start);
+        json_free_value(numbers);
+
+        start_round();
+        start = now();
+        char* out = json_write_to_str(value, JSON_WRITE_COMPACT, NULL);
+        end_round(&serialize, now() - start);
+        free(out);
+
+        size_t binary_length;
+        start_round();
+        start = now();
+        char* binary = json_binary_encode(value, &binary_length);
+        end_round(&encode, now() - start);
+
+        jvalue* loaded = calloc(1, sizeof(jvalue));
+        start_round();
+        start = now();
+        failed = json_binary_decode(binary, binary_length, loaded, NULL);
+        end_round(&decode, now() - start);
+        json_free_value(loaded);
+
+        // the fast way back: one arena block sized up front, strings borrowed from the encoding
+        start_round();
+        start = now();
+        const jparse_options in_place = { .flags = JSON_PARSE_INSITU };
+        jarena* arena = json_arena_create(json_binary_arena_size(binary, binary_length, &in_place));
+        loaded = json_arena_alloc(arena, sizeof(jvalue));
+        const jparse_options load_opts = { .flags = in_place.flags, .arena = arena };
+        failed |= json_binary_decode(binary, binary_length, loaded, &load_opts);
+        json_arena_destroy(arena);
+        end_round(&load, now() - start);
+        free(binary);
+        if (failed) {
+            fprintf(stderr, "%s: binary round trip failed\n", name);
+            json_free_value(value);
+            json_intern_destroy(table);
+            return 1;
+        }
+
+        start_round();
+        start = now();
+        lookup_all(value);
+        end_round(&lookup, now() - start);
+
+        start_round();
+        start = now();
+        json_free_value(value);
+        end_round(&release, now() - start);
+    }
+    json_intern_destroy(table);
+    report(name, "parse", &parse, length, nodes, json);
+    report(name, "intern", &interned, length, nodes, json);
+    report(name, "pack", &packed, length, nodes, json);
+    report(name, "serialize", &serialize, length, nodes, json);
+    report(name, "encode", &encode, length, nodes, json);
+    report(name, "decode", &decode, length, nodes, json);
+    report(name, "load", &load, length, nodes, json);
+    report(name, "lookup", &lookup, length, nodes, json);
+    report(name, "free", &release, length, nodes, json);
+    return 0;
+}
+
+static int count_record(void* user, size_t record, jvalue* value) {
+    (void)record;
+    *(size_t*)user += value != NULL;
+    return JSON_SUCCESS;
+}
+
+static int bench_ndjson(int rounds, int json) {
+    char* input = generate_records();
+    const size_t length = strlen(input);
+    const unsigned int threads[] = { 1, 2, 4 };
+    int failed = 0;
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        result parse = {0};
+        size_t records = 0;
+        for (int round = 0; round < rounds; round++) {
+            const jndjson_options opts = { .threads = threads[t] };
+            records = 0;
+            start_round();
+            const double start = now();
+            failed |= json_parse_ndjson(input, length, &opts, count_record, &records);
+            end_round(&parse, now() - start);
+        }
+        char phase[16];
+        snprintf(phase, sizeof(phase), "%u thread%s", threads[t], threads[t] > 1 ? "s" : "");
+        report("ndjson", phase, &parse, length, records, json);
+    }
+    free(input);
+    if (failed) {
+        fprintf(stderr, "ndjson: parse failed\n");
+    }
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    int json = 0;
+    int rounds = 5;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+            if (rounds < 1) {
+                rounds = 1;
+            }
+        } else {
+            files++;
+        }
+    }
+    int failed = 0;
+    if (files == 0) {
+        struct {
+            const char* name;
+            char* (*generate)(void);
+        } corpora[] = {
+            { "twitter", generate_twitter },
+            { "canada", generate_canada },
+            { "telemetry", generate_telemetry },
+            { "nested", generate_nested },
+            { "wide", generate_wide },
+            { "strings", generate_strings },
+        };
+        for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+            char* input = corpora[i].generate();
+            failed |= bench_corpus(corpora[i].name, input, rounds, json);
+            free(input);
+        }
+        failed |= bench_ndjson(rounds, json);
+    }
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            if (strcmp(argv[i], "--rounds") == 0) {
+                i++;
+            }
+            continue;
+        }
+        char* input = read_file(argv[i]);
+        if (input == NULL) {
+            fprintf(stderr, "%s: can't read\n", argv[i]);
+            failed = 1;
+            continue;
+        }
+        failed |= bench_corpus(argv[i], input, rounds, json);
+        free(input);
+    }
+    if (!json) {
+        printf("(%zu lookups)\n", found); // keeps the lookups from being optimized away
+    }
+    return failed;
+}
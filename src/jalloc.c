@@ -0,0 +1,163 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// every allocation the library makes goes through jalloc_hooks (see jmalloc and friends in tinyjson_internal.h),
+// which are all NULL (the C library's malloc) until json_set_allocator says otherwise
+
+jallocator jalloc_hooks;
+
+void json_set_allocator(const jallocator* allocator)
+{
+    jalloc_hooks = allocator != NULL ? *allocator : (jallocator){ 0 };
+}
+
+void* json_malloc(size_t size)
+{
+    return jmalloc(size);
+}
+
+void* json_calloc(size_t count, size_t size)
+{
+    if(size != 0 && count > (size_t)-1 / size) return NULL;
+    return jcalloc(count * size);
+}
+
+void* json_realloc(void* ptr, size_t size)
+{
+    return jrealloc(ptr, size);
+}
+
+void json_free(void* ptr)
+{
+    jfree(ptr);
+}
+
+// POOLS
+// blocks are rounded up to a power of two size class (16 bytes to 4KiB) and carry a small header saying which,
+// so resizing within a class is free and a freed block can go back on its class's list
+// every thread keeps its own freelists, so neither allocating nor freeing ever takes a lock
+// (a block freed on another thread than the one that allocated it just joins that thread's lists)
+// a thread keeps at most JPOOL_CACHE_BYTES per class, past that blocks go back to malloc, and so does everything
+// on its lists when the thread exits
+// bigger blocks go straight to malloc, with the same header
+
+#define JPOOL_MIN_SHIFT 4 // 16 bytes
+#define JPOOL_CLASSES 9 // up to 16 << 8 = 4KiB
+#define JPOOL_LARGE JPOOL_CLASSES // class of blocks too big for any pool
+#define JPOOL_HEADER 16 // keeps blocks as aligned as malloc's
+#define JPOOL_CACHE_BYTES (256 * 1024)
+
+typedef struct jpool_block {
+    struct jpool_block* next;
+} jpool_block;
+
+typedef struct jpool_cache {
+    jpool_block* free[JPOOL_CLASSES];
+    size_t count[JPOOL_CLASSES];
+    int registered; // the thread exit destructor knows about this cache
+} jpool_cache;
+
+static __thread jpool_cache pool_cache;
+static pthread_key_t pool_key;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static size_t class_size(size_t class)
+{
+    return (size_t)1 << (class + JPOOL_MIN_SHIFT);
+}
+
+static size_t class_of(size_t size)
+{
+    size_t class = 0;
+    while(class < JPOOL_CLASSES && class_size(class) < size) class++;
+    return class;
+}
+
+static size_t* header_of(void* ptr)
+{
+    return (size_t*)((char*)ptr - JPOOL_HEADER);
+}
+
+// give everything a thread kept back to malloc
+static void drain(void* cache)
+{
+    jpool_cache* c = cache;
+    for(size_t class = 0; class < JPOOL_CLASSES; class++)
+    {
+        while(c->free[class] != NULL)
+        {
+            jpool_block* block = c->free[class];
+            c->free[class] = block->next;
+            free(header_of(block));
+        }
+        c->count[class] = 0;
+    }
+}
+
+static void make_key(void)
+{
+    pthread_key_create(&pool_key, drain);
+}
+
+static void* pool_malloc(void* user, size_t size)
+{
+    (void)user; // the pools are per thread, there's nothing to pass
+    const size_t class = class_of(size);
+    if(class < JPOOL_CLASSES && pool_cache.free[class] != NULL)
+    {
+        jpool_block* block = pool_cache.free[class];
+        pool_cache.free[class] = block->next;
+        pool_cache.count[class]--;
+        return block;
+    }
+    size_t* header = malloc(JPOOL_HEADER + (class < JPOOL_CLASSES ? class_size(class) : size));
+    if(header == NULL) return NULL;
+    *header = class;
+    return (char*)header + JPOOL_HEADER;
+}
+
+static void pool_free(void* user, void* ptr)
+{
+    (void)user;
+    if(ptr == NULL) return;
+    const size_t class = *header_of(ptr);
+    if(class == JPOOL_LARGE || pool_cache.count[class] >= JPOOL_CACHE_BYTES / class_size(class))
+    {
+        free(header_of(ptr));
+        return;
+    }
+    if(!pool_cache.registered) // first block this thread keeps, make sure it's given back when the thread exits
+    {
+        pthread_once(&pool_once, make_key);
+        pthread_setspecific(pool_key, &pool_cache);
+        pool_cache.registered = 1;
+    }
+    jpool_block* block = ptr;
+    block->next = pool_cache.free[class];
+    pool_cache.free[class] = block;
+    pool_cache.count[class]++;
+}
+
+static void* pool_realloc(void* user, void* ptr, size_t size)
+{
+    if(ptr == NULL) return pool_malloc(user, size);
+    const size_t class = *header_of(ptr);
+    if(class == JPOOL_LARGE && size > class_size(JPOOL_CLASSES - 1)) // stays large, malloc may grow it in place
+    {
+        size_t* header = realloc(header_of(ptr), JPOOL_HEADER + size);
+        return header != NULL ? (char*)header + JPOOL_HEADER : NULL;
+    }
+    if(class < JPOOL_CLASSES && size <= class_size(class)) return ptr; // still fits (shrinking never moves either)
+    void* moved = pool_malloc(user, size);
+    if(moved == NULL) return NULL;
+    // large blocks don't know their size, but one that ends up in a pool was shrunk, so size is what's left of it
+    memcpy(moved, ptr, class < JPOOL_CLASSES && class_size(class) < size ? class_size(class) : size);
+    pool_free(user, ptr);
+    return moved;
+}
+
+const jallocator json_pool_allocator = { pool_malloc, pool_realloc, pool_free, NULL };
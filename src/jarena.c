@@ -0,0 +1,132 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// arenas are singly linked lists of blocks, and allocation just bumps an offset in the current block
+// reset rewinds to the first block without giving anything back, so a document can be torn down in O(1)
+// and the next document reuses the same blocks
+
+#define JARENA_DEFAULT_BLOCK (64 * 1024)
+
+typedef struct jarena_block jarena_block;
+
+struct jarena_block {
+    jarena_block* next;
+    size_t size; // usable bytes in data
+    size_t used; // bytes handed out so far
+    _Alignas(JARENA_ALIGN) char data[];
+};
+
+struct jarena {
+    jarena_block* head; // first block (where reset rewinds to)
+    jarena_block* current; // block we're currently bumping in
+    size_t block_size; // default size for new blocks
+    void* last; // most recent allocation (can be grown in place)
+};
+
+static size_t align_up(size_t n)
+{
+    return (n + JARENA_ALIGN - 1) & ~(size_t)(JARENA_ALIGN - 1);
+}
+
+static jarena_block* new_block(size_t size)
+{
+    jarena_block* b = jmalloc(sizeof(jarena_block) + size);
+    if(b == NULL) return NULL;
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    return b;
+}
+
+jarena* json_arena_create(size_t block_size)
+{
+    jarena* a = jcalloc(sizeof(jarena));
+    if(a == NULL) return NULL;
+    a->block_size = block_size ? align_up(block_size) : JARENA_DEFAULT_BLOCK;
+    a->head = new_block(a->block_size);
+    if(a->head == NULL)
+    {
+        jfree(a);
+        return NULL;
+    }
+    a->current = a->head;
+    return a;
+}
+
+void json_arena_reset(jarena* a)
+{
+    if(a == NULL) return;
+    a->current = a->head; // later blocks are rewound as we walk into them again
+    a->head->used = 0;
+    a->last = NULL;
+}
+
+void json_arena_destroy(jarena* a)
+{
+    if(a == NULL) return;
+    jarena_block* b = a->head;
+    while(b != NULL)
+    {
+        jarena_block* next = b->next;
+        jfree(b);
+        b = next;
+    }
+    jfree(a);
+}
+
+void* json_arena_alloc(jarena* a, size_t size)
+{
+    size = align_up(size ? size : 1);
+    jarena_block* b = a->current;
+    while(b->size - b->used < size) // doesn't fit, move on to (or make) the next block
+    {
+        if(b->next == NULL)
+        {
+            // oversized requests get a block of their own so the default size stays useful
+            jarena_block* fresh = new_block(size > a->block_size ? size : a->block_size);
+            if(fresh == NULL) return NULL;
+            b->next = fresh;
+        }
+        b = b->next;
+        b->used = 0; // rewind blocks left over from before a reset
+        a->current = b;
+    }
+    void* out = b->data + b->used;
+    b->used += size;
+    memset(out, 0, size); // calloc semantics, blocks get reused after a reset
+    a->last = out;
+    return out;
+}
+
+char* json_arena_strndup(jarena* a, const char* s, size_t length)
+{
+    char* out = json_arena_alloc(a, length + 1);
+    if(out == NULL) return NULL;
+    memcpy(out, s, length); // already zeroed, so terminated too
+    return out;
+}
+
+void* json_arena_grow(jarena* a, void* ptr, size_t old_size, size_t new_size)
+{
+    if(ptr == NULL) return json_arena_alloc(a, new_size);
+    if(ptr == a->last) // most recent allocation in the current block can just be extended (or shrunk)
+    {
+        jarena_block* b = a->current;
+        const size_t offset = (char*)ptr - b->data;
+        const size_t aligned = align_up(new_size ? new_size : 1);
+        if(offset + aligned <= b->size)
+        {
+            if(new_size > old_size) memset((char*)ptr + old_size, 0, new_size - old_size);
+            b->used = offset + aligned;
+            return ptr;
+        }
+    }
+    if(new_size <= old_size) return ptr; // shrinking something in the middle of a block is free (and a no-op)
+    void* out = json_arena_alloc(a, new_size);
+    if(out == NULL) return NULL;
+    memcpy(out, ptr, old_size);
+    return out;
+}
@@ -0,0 +1,652 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// binary form of a tree: a 4 byte header ("TJB" and a version byte), then the root value
+// every value is a tag byte followed by its payload:
+//   integer   zigzag varint (the integer -0 has a tag of its own)
+//   double    8 bytes, little endian
+//   string    varint length, the bytes, then a null (so a mapped file can lend its strings out as they are)
+//   array     varint count, then the elements
+//   object    varint count, then every member as a key (a string without the tag) followed by the value
+// varints are LEB128, 7 bits at a time, lowest first
+// nothing needs escaping or number parsing on the way back, and every length is known before anything is read
+
+#define JBIN_VERSION 1
+#define JBIN_HEADER 4
+
+#define JBIN_NULL 0
+#define JBIN_FALSE 1
+#define JBIN_TRUE 2
+#define JBIN_INTEGER 3
+#define JBIN_NEGATIVE_ZERO 4
+#define JBIN_DOUBLE 5
+#define JBIN_STRING 6
+#define JBIN_ARRAY 7
+#define JBIN_OBJECT 8
+
+#define JBIN_SINK_BUFFER 4096
+#define JBIN_INITIAL_CAPACITY 256
+#define JBIN_VARINT_MAX 10 // bytes a 64-bit varint can take
+
+static const char header[JBIN_HEADER] = { 'T', 'J', 'B', JBIN_VERSION };
+
+// encoding, decoding and sizing all walk with an explicit stack of open containers, like the text writer, so deep
+// trees can't run out of C stack
+#define JBIN_LOCAL_FRAMES 32 // frames on the C stack, deeper trees move to the heap
+
+typedef struct jbin_frame {
+    jvalue* value; // the container being walked (NULL when only sizing)
+    size_t index; // next member or element
+    size_t count; // how many there are
+    int object; // members come with a key first
+} jbin_frame;
+
+// make room for one more frame, moving off the C stack (local) the first time
+static jbin_frame* grow_frames(jbin_frame* frames, const jbin_frame* local, size_t* capacity)
+{
+    jbin_frame* more = frames == local ? jmalloc(*capacity * 2 * sizeof(jbin_frame))
+                                       : jrealloc(frames, *capacity * 2 * sizeof(jbin_frame));
+    if(more == NULL) return NULL;
+    if(frames == local) memcpy(more, local, *capacity * sizeof(jbin_frame));
+    *capacity *= 2;
+    return more;
+}
+
+// ENCODING
+// same buffering as the text writer: a staging buffer flushed to the sink, or a growing one handed to the caller
+
+typedef struct jbin_writer {
+    char* buf;
+    size_t length;
+    size_t capacity;
+    json_sink sink; // NULL when building a buffer
+    void* user;
+    int failed; // sticky
+} jbin_writer;
+
+static void flush(jbin_writer* w)
+{
+    if(w->failed || w->length == 0) return;
+    if(w->sink(w->user, w->buf, w->length) != JSON_SUCCESS) w->failed = 1;
+    w->length = 0;
+}
+
+static void put(jbin_writer* w, const void* data, size_t n)
+{
+    if(w->failed) return;
+    if(w->length + n > w->capacity)
+    {
+        if(w->sink != NULL)
+        {
+            flush(w);
+            if(n > w->capacity) // too big to stage, hand it straight to the sink
+            {
+                if(!w->failed && w->sink(w->user, data, n) != JSON_SUCCESS) w->failed = 1;
+                return;
+            }
+        }
+        else
+        {
+            size_t capacity = w->capacity;
+            while(w->length + n > capacity) capacity *= 2;
+            char* more = jrealloc(w->buf, capacity);
+            if(more == NULL)
+            {
+                w->failed = 1;
+                return;
+            }
+            w->buf = more;
+            w->capacity = capacity;
+        }
+    }
+    memcpy(w->buf + w->length, data, n);
+    w->length += n;
+}
+
+static void put_varint(jbin_writer* w, uint64_t n)
+{
+    unsigned char bytes[JBIN_VARINT_MAX];
+    size_t length = 0;
+    while(n >= 0x80)
+    {
+        bytes[length++] = (unsigned char)(n | 0x80);
+        n >>= 7;
+    }
+    bytes[length++] = (unsigned char)n;
+    put(w, bytes, length);
+}
+
+// length-prefixed and null-terminated
+static void put_string(jbin_writer* w, const char* string)
+{
+    const size_t length = strlen(string);
+    put_varint(w, length);
+    put(w, string, length + 1);
+}
+
+static void put_tag(jbin_writer* w, unsigned char tag)
+{
+    put(w, &tag, 1);
+}
+
+static void put_number(jbin_writer* w, const jvalue* val)
+{
+    if(val->flags & JSON_FLAG_INTEGER)
+    {
+        if(val->integer == 0 && signbit(val->number))
+        {
+            put_tag(w, JBIN_NEGATIVE_ZERO);
+            return;
+        }
+        put_tag(w, JBIN_INTEGER);
+        const uint64_t n = (uint64_t)val->integer;
+        put_varint(w, (n << 1) ^ (val->integer < 0 ? ~(uint64_t)0 : 0)); // zigzag, so small negatives stay short
+        return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &val->number, sizeof(bits));
+    unsigned char bytes[8];
+    for(int i = 0; i < 8; i++) bytes[i] = (unsigned char)(bits >> (8 * i));
+    put_tag(w, JBIN_DOUBLE);
+    put(w, bytes, sizeof(bytes));
+}
+
+// packed arrays go out like any other array of numbers, without being unpacked
+static void put_packed(jbin_writer* w, const jvalue* val)
+{
+    put_tag(w, JBIN_ARRAY);
+    put_varint(w, val->length);
+    jvalue number = { .type = JSON_NUMBER, .flags = val->flags & JSON_FLAG_INTEGER };
+    for(size_t i = 0; i < val->length && !w->failed; i++)
+    {
+        if(number.flags) number.integer = val->integers[i];
+        else number.number = val->numbers[i];
+        put_number(w, &number);
+    }
+}
+
+// a scalar, a packed array or an empty container goes out whole, anything else is opened (and opened set)
+static int encode_one(jbin_writer* w, const jvalue* val, int* opened)
+{
+    if((val->flags & JSON_FLAG_LAZY) && jparse_lazy((jvalue*)val)) return JSON_FAILURE;
+    if(val->flags & JSON_FLAG_PACKED)
+    {
+        put_packed(w, val);
+        return w->failed ? JSON_FAILURE : JSON_SUCCESS;
+    }
+    if(json_materialize((jvalue*)val)) return JSON_FAILURE;
+    switch(val->type)
+    {
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            put_tag(w, val->type == JSON_OBJECT ? JBIN_OBJECT : JBIN_ARRAY);
+            put_varint(w, val->length);
+            *opened = val->length > 0;
+            break;
+        case JSON_STRING:
+            if(val->string == NULL) return JSON_FAILURE;
+            put_tag(w, JBIN_STRING);
+            put_string(w, val->string);
+            break;
+        case JSON_NUMBER:
+            put_number(w, val);
+            break;
+        case JSON_BOOL:
+            put_tag(w, val->boolean ? JBIN_TRUE : JBIN_FALSE);
+            break;
+        case JSON_NULL:
+            put_tag(w, JBIN_NULL);
+            break;
+        default:
+            return JSON_FAILURE;
+    }
+    return w->failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+static int encode(jbin_writer* w, const jvalue* val)
+{
+    jbin_frame local[JBIN_LOCAL_FRAMES];
+    jbin_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = JBIN_LOCAL_FRAMES;
+    int failed = 0;
+    while(val != NULL && !failed)
+    {
+        if(depth == capacity) // room for one more, in case val gets opened
+        {
+            jbin_frame* more = grow_frames(frames, local, &capacity);
+            if(more == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            frames = more;
+        }
+        int opened = 0;
+        if(encode_one(w, val, &opened))
+        {
+            failed = 1;
+            break;
+        }
+        if(opened)
+            frames[depth++] = (jbin_frame){ .value = (jvalue*)val, .count = val->length, .object = val->type == JSON_OBJECT };
+        // on to the next member or element of the innermost container, dropping the ones that are done
+        // (counts went out up front, so there's nothing to close)
+        val = NULL;
+        while(depth > 0 && val == NULL && !failed)
+        {
+            jbin_frame* frame = &frames[depth - 1];
+            if(frame->index == frame->count)
+            {
+                depth--;
+                continue;
+            }
+            if(frame->object)
+            {
+                const jmember* m = &frame->value->members[frame->index];
+                if(m->key == NULL) failed = 1;
+                else put_string(w, m->key);
+                val = &m->value;
+            }
+            else val = &frame->value->elements[frame->index];
+            frame->index++;
+        }
+    }
+    if(frames != local) jfree(frames);
+    return failed || w->failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+int json_binary_write(const jvalue* val, json_sink sink, void* user)
+{
+    if(val == NULL || sink == NULL) return JSON_FAILURE;
+    jbin_writer w = { .capacity = JBIN_SINK_BUFFER, .sink = sink, .user = user };
+    w.buf = jmalloc(w.capacity);
+    if(w.buf == NULL) return JSON_FAILURE;
+    put(&w, header, JBIN_HEADER);
+    int result = encode(&w, val);
+    flush(&w);
+    if(w.failed) result = JSON_FAILURE;
+    jfree(w.buf);
+    return result;
+}
+
+char* json_binary_encode(const jvalue* val, size_t* length)
+{
+    if(val == NULL || length == NULL) return NULL;
+    jbin_writer w = { .capacity = JBIN_INITIAL_CAPACITY };
+    w.buf = jmalloc(w.capacity);
+    if(w.buf == NULL) return NULL;
+    put(&w, header, JBIN_HEADER);
+    if(encode(&w, val) || w.failed)
+    {
+        jfree(w.buf);
+        return NULL;
+    }
+    *length = w.length;
+    return w.buf;
+}
+
+// DECODING
+// every read is checked against the end, so a truncated or corrupt file fails instead of reading past it
+
+typedef struct jbin_reader {
+    const char* p;
+    const char* end;
+} jbin_reader;
+
+static int get_byte(jbin_reader* r, unsigned char* byte)
+{
+    if(r->p == r->end) return JSON_FAILURE;
+    *byte = (unsigned char)*r->p++;
+    return JSON_SUCCESS;
+}
+
+static int get_varint(jbin_reader* r, uint64_t* n)
+{
+    *n = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        unsigned char byte;
+        if(get_byte(r, &byte)) return JSON_FAILURE;
+        *n |= (uint64_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return JSON_SUCCESS;
+    }
+    return JSON_FAILURE; // longer than any 64-bit number
+}
+
+// a count of things that each take at least a byte, so it can't be more than what's left
+static int get_count(jbin_reader* r, size_t* count)
+{
+    uint64_t n;
+    if(get_varint(r, &n) || n > (uint64_t)(r->end - r->p)) return JSON_FAILURE;
+    *count = (size_t)n;
+    return JSON_SUCCESS;
+}
+
+static int get_string(jbin_reader* r, const char** string, size_t* length)
+{
+    uint64_t n;
+    if(get_varint(r, &n) || n >= (uint64_t)(r->end - r->p) || r->p[n] != '\0') return JSON_FAILURE;
+    *string = r->p;
+    *length = (size_t)n;
+    r->p += n + 1;
+    return JSON_SUCCESS;
+}
+
+// a string for the tree: borrowed straight from the input with JSON_PARSE_INSITU, copied otherwise
+// (keys are interned instead if there's a table to intern them in)
+static char* ctx_string(const jctx* ctx, const char* string, size_t length, unsigned int* flags)
+{
+    if(ctx->flags & JSON_PARSE_INSITU)
+    {
+        *flags |= JSON_FLAG_BORROWED;
+        return (char*)string; // already terminated
+    }
+    return jctx_strndup(ctx, string, length);
+}
+
+// a scalar or an empty container is decoded whole, anything else gets its members or elements allocated and is
+// opened (and opened set) for decode to fill in, unless it would be nested deeper than depth allows
+static int decode_one(const jctx* ctx, jbin_reader* r, jvalue* out, size_t depth, int* opened)
+{
+    out->flags = ctx->arena != NULL ? JSON_FLAG_ARENA : 0;
+    out->type = JSON_NULL; // until there's something under it that needs freeing
+    unsigned char tag;
+    if(get_byte(r, &tag)) return JSON_FAILURE;
+    switch(tag)
+    {
+        case JBIN_OBJECT:
+        {
+            size_t count;
+            if(depth >= ctx->max_depth || get_count(r, &count)) return JSON_FAILURE;
+            out->type = JSON_OBJECT;
+            out->index = NULL;
+            // zeroed, and a zeroed value is an empty object, so a failure below still leaves a freeable tree
+            out->members = count > 0 ? jctx_alloc(ctx, count * sizeof(jmember)) : NULL;
+            out->length = out->members != NULL ? count : 0;
+            if(out->length != count) return JSON_FAILURE;
+            *opened = count > 0;
+            return JSON_SUCCESS;
+        }
+        case JBIN_ARRAY:
+        {
+            size_t count;
+            if(depth >= ctx->max_depth || get_count(r, &count)) return JSON_FAILURE;
+            out->type = JSON_ARRAY;
+            out->lazy = NULL;
+            out->elements = count > 0 ? jctx_alloc(ctx, count * sizeof(jvalue)) : NULL; // zeroed, like members above
+            out->length = out->elements != NULL ? count : 0;
+            if(out->length != count) return JSON_FAILURE;
+            *opened = count > 0;
+            return JSON_SUCCESS;
+        }
+        case JBIN_STRING:
+        {
+            const char* string;
+            size_t length;
+            if(get_string(r, &string, &length)) return JSON_FAILURE;
+            out->string = ctx_string(ctx, string, length, &out->flags);
+            if(out->string == NULL) return JSON_FAILURE;
+            out->type = JSON_STRING;
+            return JSON_SUCCESS;
+        }
+        case JBIN_INTEGER:
+        {
+            uint64_t n;
+            if(get_varint(r, &n)) return JSON_FAILURE;
+            out->type = JSON_NUMBER;
+            out->integer = (int64_t)((n >> 1) ^ (0 - (n & 1))); // undo the zigzag
+            out->number = (double)out->integer;
+            out->flags |= JSON_FLAG_INTEGER;
+            return JSON_SUCCESS;
+        }
+        case JBIN_NEGATIVE_ZERO:
+            out->type = JSON_NUMBER;
+            out->integer = 0;
+            out->number = -0.0;
+            out->flags |= JSON_FLAG_INTEGER;
+            return JSON_SUCCESS;
+        case JBIN_DOUBLE:
+        {
+            if(r->end - r->p < 8) return JSON_FAILURE;
+            uint64_t bits = 0;
+            for(int i = 0; i < 8; i++) bits |= (uint64_t)(unsigned char)r->p[i] << (8 * i);
+            r->p += 8;
+            out->type = JSON_NUMBER;
+            memcpy(&out->number, &bits, sizeof(bits));
+            out->integer = 0;
+            return JSON_SUCCESS;
+        }
+        case JBIN_TRUE:
+        case JBIN_FALSE:
+            out->type = JSON_BOOL;
+            out->boolean = tag == JBIN_TRUE;
+            return JSON_SUCCESS;
+        case JBIN_NULL:
+            return JSON_SUCCESS;
+        default:
+            return JSON_FAILURE;
+    }
+}
+
+static int decode(const jctx* ctx, jbin_reader* r, jvalue* out)
+{
+    jbin_frame local[JBIN_LOCAL_FRAMES];
+    jbin_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = JBIN_LOCAL_FRAMES;
+    int failed = 0;
+    while(out != NULL && !failed)
+    {
+        if(depth == capacity) // room for one more, in case out gets opened
+        {
+            jbin_frame* more = grow_frames(frames, local, &capacity);
+            if(more == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            frames = more;
+        }
+        int opened = 0;
+        if(decode_one(ctx, r, out, depth, &opened))
+        {
+            failed = 1;
+            break;
+        }
+        if(opened) frames[depth++] = (jbin_frame){ .value = out, .count = out->length, .object = out->type == JSON_OBJECT };
+        // on to the next member or element of the innermost container, finishing the ones that are done
+        out = NULL;
+        while(depth > 0 && out == NULL && !failed)
+        {
+            jbin_frame* frame = &frames[depth - 1];
+            if(frame->index == frame->count)
+            {
+                jvalue* done = frame->value;
+                if(frame->object && (ctx->flags & JSON_PARSE_INDEX) && done->length >= JINDEX_MIN_MEMBERS)
+                {
+                    done->index = jindex_build(done->members, done->length, ctx->arena);
+                    failed = done->index == NULL;
+                }
+                depth--;
+                continue;
+            }
+            if(frame->object)
+            {
+                jmember* member = &frame->value->members[frame->index];
+                const char* key;
+                size_t length;
+                if(get_string(r, &key, &length)) failed = 1;
+                else
+                {
+                    member->key = ctx->intern != NULL ? jctx_key(ctx, key, length, &member->flags)
+                                                      : ctx_string(ctx, key, length, &member->flags);
+                    failed = member->key == NULL;
+                }
+                out = &member->value;
+            }
+            else out = &frame->value->elements[frame->index];
+            frame->index++;
+        }
+    }
+    if(frames != local) jfree(frames);
+    return failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+static int read_header(jbin_reader* r, const char* data, size_t length)
+{
+    if(data == NULL || length < JBIN_HEADER || memcmp(data, header, JBIN_HEADER) != 0) return JSON_FAILURE;
+    r->p = data + JBIN_HEADER;
+    r->end = data + length;
+    return JSON_SUCCESS;
+}
+
+int json_binary_decode(const char* data, size_t length, jvalue* empty, const jparse_options* opts)
+{
+    jbin_reader r;
+    if(empty == NULL || read_header(&r, data, length)) return JSON_FAILURE;
+    jintern_counts counts = { 0 };
+    jctx ctx = { .max_depth = JSON_MAX_DEPTH, .intern_counts = &counts };
+    if(opts != NULL)
+    {
+        ctx.arena = opts->arena;
+        ctx.flags = opts->flags;
+        ctx.intern = opts->intern;
+        if(opts->max_depth != 0) ctx.max_depth = opts->max_depth;
+    }
+    const int result = decode(&ctx, &r, empty);
+    jintern_flush(ctx.intern, &counts);
+    if(result) return JSON_FAILURE;
+    return r.p == r.end ? JSON_SUCCESS : JSON_FAILURE; // nothing may follow the root
+}
+
+int json_binary_read_file(const char* path, jvalue* empty, const jparse_options* opts)
+{
+    jmapping* map = json_map_file(path);
+    if(map == NULL) return JSON_FAILURE;
+    // the mapping is gone when this returns, so nothing may point into it
+    jparse_options copying = { 0 };
+    if(opts != NULL) copying = *opts;
+    copying.flags &= ~JSON_PARSE_INSITU;
+    const int result = json_binary_decode(json_mapping_data(map), json_mapping_length(map), empty, &copying);
+    json_unmap_file(map);
+    return result;
+}
+
+// SIZING
+// walk the encoding without building anything, adding up what decode would take from an arena
+
+// bytes an allocation of size takes up in an arena
+static size_t footprint(size_t size)
+{
+    return (size + JARENA_ALIGN - 1) & ~(size_t)(JARENA_ALIGN - 1);
+}
+
+// what one value takes beyond the jvalue it goes in, a container that isn't empty is opened (and opened set) for
+// measure to walk
+static int measure_one(jbin_reader* r, int insitu, size_t* total, size_t depth, size_t max_depth, jbin_frame* frame, int* opened)
+{
+    unsigned char tag;
+    if(get_byte(r, &tag)) return JSON_FAILURE;
+    size_t count;
+    const char* string;
+    size_t length;
+    switch(tag)
+    {
+        case JBIN_OBJECT:
+        case JBIN_ARRAY:
+            if(depth >= max_depth || get_count(r, &count)) return JSON_FAILURE;
+            if(count == 0) return JSON_SUCCESS;
+            *total += footprint(count * (tag == JBIN_OBJECT ? sizeof(jmember) : sizeof(jvalue)));
+            *frame = (jbin_frame){ .count = count, .object = tag == JBIN_OBJECT };
+            *opened = 1;
+            return JSON_SUCCESS;
+        case JBIN_STRING:
+            if(get_string(r, &string, &length)) return JSON_FAILURE;
+            if(!insitu) *total += footprint(length + 1);
+            return JSON_SUCCESS;
+        case JBIN_INTEGER:
+        {
+            uint64_t n;
+            return get_varint(r, &n);
+        }
+        case JBIN_DOUBLE:
+            if(r->end - r->p < 8) return JSON_FAILURE;
+            r->p += 8;
+            return JSON_SUCCESS;
+        case JBIN_NEGATIVE_ZERO:
+        case JBIN_TRUE:
+        case JBIN_FALSE:
+        case JBIN_NULL:
+            return JSON_SUCCESS;
+        default:
+            return JSON_FAILURE;
+    }
+}
+
+// max_depth is decode's, so everything it accepts gets a size (and everything it rejects gets 0)
+static int measure(jbin_reader* r, int insitu, size_t* total, size_t max_depth)
+{
+    jbin_frame local[JBIN_LOCAL_FRAMES];
+    jbin_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = JBIN_LOCAL_FRAMES;
+    int failed = 0;
+    int more_values = 1;
+    while(more_values && !failed)
+    {
+        if(depth == capacity)
+        {
+            jbin_frame* more = grow_frames(frames, local, &capacity);
+            if(more == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            frames = more;
+        }
+        int opened = 0;
+        if(measure_one(r, insitu, total, depth, max_depth, &frames[depth], &opened))
+        {
+            failed = 1;
+            break;
+        }
+        depth += opened;
+        more_values = 0;
+        while(depth > 0 && !more_values && !failed)
+        {
+            jbin_frame* frame = &frames[depth - 1];
+            if(frame->index == frame->count)
+            {
+                depth--;
+                continue;
+            }
+            if(frame->object)
+            {
+                const char* key;
+                size_t length;
+                if(get_string(r, &key, &length)) failed = 1;
+                else if(!insitu) *total += footprint(length + 1);
+            }
+            frame->index++;
+            more_values = 1;
+        }
+    }
+    if(frames != local) jfree(frames);
+    return failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+size_t json_binary_arena_size(const char* data, size_t length, const jparse_options* opts)
+{
+    jbin_reader r;
+    if(read_header(&r, data, length)) return 0;
+    const int insitu = opts != NULL && (opts->flags & JSON_PARSE_INSITU);
+    const size_t max_depth = opts != NULL && opts->max_depth != 0 ? opts->max_depth : JSON_MAX_DEPTH;
+    size_t total = footprint(sizeof(jvalue)); // the root
+    if(measure(&r, insitu, &total, max_depth) || r.p != r.end) return 0;
+    return total;
+}
@@ -0,0 +1,188 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// object indexes are open-addressed hash tables (linear probing) from a key to the position of the FIRST member with
+// that key, so lookups keep the same first-match semantics as scanning the members
+// the table is kept at most half full (live entries plus tombstones)
+
+#define JINDEX_EMPTY 0
+#define JINDEX_TOMBSTONE ((size_t)-1)
+
+typedef struct jindex_slot {
+    size_t member; // position of the member plus one, JINDEX_EMPTY (so a zeroed table is empty) or JINDEX_TOMBSTONE
+    uint64_t hash;
+} jindex_slot;
+
+struct jindex {
+    size_t capacity; // always a power of two
+    size_t count; // live entries
+    size_t used; // live entries plus tombstones
+    int in_arena; // slots came from an arena, don't free (or grow) them
+    jindex_slot* slots;
+};
+
+static size_t capacity_for(size_t members)
+{
+    size_t capacity = 16;
+    while(capacity < members * 2) capacity *= 2;
+    return capacity;
+}
+
+static int is_live(const jindex_slot* slot)
+{
+    return slot->member != JINDEX_EMPTY && slot->member != JINDEX_TOMBSTONE;
+}
+
+static int holds(const jindex_slot* slot, const jmember* members, const char* key, uint64_t hash)
+{
+    if(!is_live(slot) || slot->hash != hash) return 0;
+    const char* held = members[slot->member - 1].key;
+    return held == key || !strcmp(held, key); // interned keys are the same pointer
+}
+
+// find the slot holding key, or the empty slot where it would go
+static jindex_slot* probe(const jindex* index, const jmember* members, const char* key, uint64_t hash)
+{
+    const size_t mask = index->capacity - 1;
+    jindex_slot* tombstone = NULL;
+    for(size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        jindex_slot* slot = &index->slots[i];
+        if(slot->member == JINDEX_EMPTY) return tombstone != NULL ? tombstone : slot;
+        if(slot->member == JINDEX_TOMBSTONE)
+        {
+            if(tombstone == NULL) tombstone = slot;
+        }
+        else if(holds(slot, members, key, hash)) return slot;
+    }
+}
+
+// same as probe, but never stops on a tombstone (for lookups and removals)
+static jindex_slot* find_slot(const jindex* index, const jmember* members, const char* key, uint64_t hash)
+{
+    const size_t mask = index->capacity - 1;
+    for(size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        jindex_slot* slot = &index->slots[i];
+        if(slot->member == JINDEX_EMPTY) return NULL;
+        if(holds(slot, members, key, hash)) return slot;
+    }
+}
+
+// put a member into a table that is known to have room, keeping an existing entry if there is one
+static void insert_first(jindex* index, const jmember* members, size_t position, uint64_t hash)
+{
+    jindex_slot* slot = probe(index, members, members[position].key, hash);
+    if(is_live(slot)) return; // an earlier member already owns this key
+    if(slot->member == JINDEX_EMPTY) index->used++;
+    slot->member = position + 1;
+    slot->hash = hash;
+    index->count++;
+}
+
+jindex* jindex_build(const jmember* members, size_t length, jarena* arena)
+{
+    const size_t capacity = capacity_for(length);
+    jindex* index;
+    if(arena != NULL)
+    {
+        index = json_arena_alloc(arena, sizeof(jindex));
+        if(index == NULL) return NULL;
+        index->slots = json_arena_alloc(arena, capacity * sizeof(jindex_slot));
+        index->in_arena = 1;
+    }
+    else
+    {
+        index = jcalloc(sizeof(jindex));
+        if(index == NULL) return NULL;
+        index->slots = jcalloc(capacity * sizeof(jindex_slot));
+    }
+    if(index->slots == NULL)
+    {
+        if(arena == NULL) jfree(index);
+        return NULL;
+    }
+    index->capacity = capacity;
+    for(size_t i = 0; i < length; i++) insert_first(index, members, i, jmember_hash(&members[i]));
+    return index;
+}
+
+void jindex_free(jindex* index)
+{
+    if(index == NULL || index->in_arena) return;
+    jfree(index->slots);
+    jfree(index);
+}
+
+size_t jindex_find(const jindex* index, const jmember* members, const char* key)
+{
+    return jindex_find_hashed(index, members, key, json_hash_key(key));
+}
+
+size_t jindex_find_hashed(const jindex* index, const jmember* members, const char* key, uint64_t hash)
+{
+    const jindex_slot* slot = find_slot(index, members, key, hash);
+    return slot != NULL ? slot->member - 1 : JINDEX_NONE;
+}
+
+// rehash everything into a table sized for the live entries (drops tombstones too)
+// the keys are all different already, so every entry just goes into the first free slot
+static int rehash(jindex* index)
+{
+    const size_t capacity = capacity_for(index->count + 1);
+    jindex_slot* slots = jcalloc(capacity * sizeof(jindex_slot));
+    if(slots == NULL) return JSON_FAILURE;
+    for(size_t i = 0; i < index->capacity; i++)
+    {
+        if(!is_live(&index->slots[i])) continue;
+        size_t j = index->slots[i].hash & (capacity - 1);
+        while(slots[j].member != JINDEX_EMPTY) j = (j + 1) & (capacity - 1);
+        slots[j] = index->slots[i];
+    }
+    jfree(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    index->used = index->count;
+    return JSON_SUCCESS;
+}
+
+int jindex_put(jindex* index, const jmember* members, size_t position)
+{
+    if(index->in_arena) return JSON_FAILURE; // can't grow arena memory, caller drops the index
+    if((index->used + 1) * 2 > index->capacity && rehash(index) != JSON_SUCCESS) return JSON_FAILURE;
+    const char* key = members[position].key;
+    const uint64_t hash = jmember_hash(&members[position]);
+    jindex_slot* slot = probe(index, members, key, hash);
+    if(!is_live(slot))
+    {
+        if(slot->member == JINDEX_EMPTY) index->used++;
+        index->count++;
+    }
+    slot->member = position + 1; // replaces whatever member used to be first for this key
+    slot->hash = hash;
+    return JSON_SUCCESS;
+}
+
+void jindex_replace(jindex* index, const jmember* members, const char* key, size_t position)
+{
+    jindex_slot* slot = find_slot(index, members, key, json_hash_key(key));
+    if(slot == NULL) return;
+    if(position != JINDEX_NONE)
+    {
+        slot->member = position + 1;
+        return;
+    }
+    slot->member = JINDEX_TOMBSTONE;
+    index->count--;
+}
+
+void jindex_shift(jindex* index, size_t from, int by)
+{
+    for(size_t i = 0; i < index->capacity; i++)
+    {
+        if(is_live(&index->slots[i]) && index->slots[i].member - 1 >= from) index->slots[i].member += by;
+    }
+}
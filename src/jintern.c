@@ -0,0 +1,204 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// intern tables: every distinct key is stored once, with its hash, and handed out to any number of parses
+// the table is split into shards by hash, each an open-addressed hash table (linear probing) of entry pointers
+// lookups never lock: entries are written before they're published (release) and read after they're found (acquire),
+// and nothing is ever removed, so a reader that doesn't find a key in the table it's looking at just takes the lock
+// adding a key locks its shard only, and a shard that fills up gets a bigger table while readers may still be in the
+// old one, which is kept (on a list) until the whole table is destroyed, they only add up to the size of the last one
+
+#define JINTERN_SHARDS 16 // power of two, picked by the top bits of the hash
+#define JINTERN_INITIAL_SLOTS 16 // power of two, per shard
+#define JINTERN_BLOCK 4096 // arena block size for each shard's entries
+
+typedef struct jintern_entry {
+    uint64_t hash; // json_hash_key of the key
+    size_t length;
+    char key[]; // null-terminated
+} jintern_entry;
+
+typedef struct jintern_slots {
+    size_t capacity; // always a power of two
+    struct jintern_slots* retired; // the table this one replaced
+    jintern_entry* slots[]; // NULL when empty, read and written atomically
+} jintern_slots;
+
+typedef struct jintern_shard {
+    jintern_slots* table; // read and written atomically, replaced when it fills up
+    size_t count; // entries (under lock)
+    size_t bytes; // entries and tables (under lock)
+    jarena* entries; // where the entries live (under lock)
+    pthread_mutex_t lock;
+    char padding[64]; // keep neighbouring shards' locks off each other's cache lines
+} jintern_shard;
+
+struct jintern {
+    jintern_shard shards[JINTERN_SHARDS];
+    size_t references; // totals flushed in by parses (atomic)
+    size_t referenced_bytes;
+};
+
+static jintern_slots* new_slots(size_t capacity)
+{
+    jintern_slots* table = jcalloc(sizeof(jintern_slots) + capacity * sizeof(jintern_entry*));
+    if(table != NULL) table->capacity = capacity;
+    return table;
+}
+
+jintern* json_intern_create(void)
+{
+    jintern* table = jcalloc(sizeof(jintern));
+    if(table == NULL) return NULL;
+    for(int i = 0; i < JINTERN_SHARDS; i++)
+    {
+        jintern_shard* shard = &table->shards[i];
+        shard->table = new_slots(JINTERN_INITIAL_SLOTS);
+        shard->entries = json_arena_create(JINTERN_BLOCK);
+        if(shard->table == NULL || shard->entries == NULL || pthread_mutex_init(&shard->lock, NULL) != 0)
+        {
+            jfree(shard->table);
+            json_arena_destroy(shard->entries);
+            shard->table = NULL;
+            json_intern_destroy(table);
+            return NULL;
+        }
+        shard->bytes = sizeof(jintern_slots) + JINTERN_INITIAL_SLOTS * sizeof(jintern_entry*);
+    }
+    return table;
+}
+
+void json_intern_destroy(jintern* table)
+{
+    if(table == NULL) return;
+    for(int i = 0; i < JINTERN_SHARDS && table->shards[i].table != NULL; i++)
+    {
+        jintern_shard* shard = &table->shards[i];
+        jintern_slots* slots = shard->table;
+        while(slots != NULL)
+        {
+            jintern_slots* retired = slots->retired;
+            jfree(slots);
+            slots = retired;
+        }
+        json_arena_destroy(shard->entries);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    jfree(table);
+}
+
+// the entry for the key in slots, or NULL
+static jintern_entry* find(const jintern_slots* table, const char* key, size_t length, uint64_t hash)
+{
+    const size_t mask = table->capacity - 1;
+    for(size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        jintern_entry* entry = __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+        if(entry == NULL) return NULL;
+        if(entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) return entry;
+    }
+}
+
+// put an entry into the first free slot for it (under lock, the key isn't in there yet)
+static void place(jintern_slots* table, jintern_entry* entry)
+{
+    const size_t mask = table->capacity - 1;
+    size_t i = entry->hash & mask;
+    while(table->slots[i] != NULL) i = (i + 1) & mask;
+    __atomic_store_n(&table->slots[i], entry, __ATOMIC_RELEASE);
+}
+
+// add the key to a shard it wasn't found in, unless someone else just did (under lock)
+static jintern_entry* add(jintern_shard* shard, const char* key, size_t length, uint64_t hash)
+{
+    jintern_slots* table = shard->table;
+    jintern_entry* entry = find(table, key, length, hash);
+    if(entry != NULL) return entry;
+    if((shard->count + 1) * 2 > table->capacity) // keep it at most half full
+    {
+        jintern_slots* bigger = new_slots(table->capacity * 2);
+        if(bigger == NULL) return NULL;
+        for(size_t i = 0; i < table->capacity; i++)
+        {
+            if(table->slots[i] != NULL) place(bigger, table->slots[i]);
+        }
+        bigger->retired = table;
+        __atomic_store_n(&shard->table, bigger, __ATOMIC_RELEASE);
+        shard->bytes += sizeof(jintern_slots) + bigger->capacity * sizeof(jintern_entry*);
+        table = bigger;
+    }
+    entry = json_arena_alloc(shard->entries, sizeof(jintern_entry) + length + 1); // zeroed, so terminated too
+    if(entry == NULL) return NULL;
+    entry->hash = hash;
+    entry->length = length;
+    memcpy(entry->key, key, length);
+    place(table, entry);
+    shard->count++;
+    shard->bytes += (sizeof(jintern_entry) + length + 1 + JARENA_ALIGN - 1) & ~(size_t)(JARENA_ALIGN - 1);
+    return entry;
+}
+
+const char* jintern_get(jintern* table, const char* key, size_t length, jintern_counts* counts)
+{
+    const char* nul = memchr(key, '\0', length); // keys are C strings, anything after a \u0000 is never seen
+    if(nul != NULL) length = nul - key;
+    uint64_t hash = 0xcbf29ce484222325ULL; // json_hash_key, over length bytes
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= 0x100000001b3ULL;
+    }
+    jintern_shard* shard = &table->shards[hash >> 60 & (JINTERN_SHARDS - 1)];
+    jintern_entry* entry = find(__atomic_load_n(&shard->table, __ATOMIC_ACQUIRE), key, length, hash);
+    if(entry == NULL)
+    {
+        pthread_mutex_lock(&shard->lock);
+        entry = add(shard, key, length, hash);
+        pthread_mutex_unlock(&shard->lock);
+        if(entry == NULL) return NULL;
+    }
+    if(counts != NULL)
+    {
+        counts->references++;
+        counts->bytes += length + 1;
+    }
+    return entry->key;
+}
+
+uint64_t jintern_hash(const char* key)
+{
+    return ((const jintern_entry*)(key - offsetof(jintern_entry, key)))->hash;
+}
+
+void jintern_flush(jintern* table, jintern_counts* counts)
+{
+    if(table == NULL || counts->references == 0) return;
+    __atomic_fetch_add(&table->references, counts->references, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&table->referenced_bytes, counts->bytes, __ATOMIC_RELAXED);
+    *counts = (jintern_counts){ 0 };
+}
+
+const char* json_intern(jintern* table, const char* key)
+{
+    if(table == NULL || key == NULL) return NULL;
+    return jintern_get(table, key, strlen(key), NULL);
+}
+
+void json_intern_stats(jintern* table, jintern_stats* stats)
+{
+    *stats = (jintern_stats){ .bytes = sizeof(jintern) };
+    for(int i = 0; i < JINTERN_SHARDS; i++)
+    {
+        jintern_shard* shard = &table->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->keys += shard->count;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    stats->references = __atomic_load_n(&table->references, __ATOMIC_RELAXED);
+    stats->referenced_bytes = __atomic_load_n(&table->referenced_bytes, __ATOMIC_RELAXED);
+}
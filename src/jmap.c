@@ -0,0 +1,86 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// files are mapped rather than read, so the parser runs straight off the page cache without a copy
+// the mapping is private and writable: nothing ever reaches the file, but in-situ parsing can still terminate strings
+// in place (only the pages it touches get copied)
+// mappings aren't null-terminated, so everything here parses with an explicit end
+
+struct jmapping {
+    char* data;
+    size_t length;
+};
+
+static char no_data[1]; // what an empty file maps to (mmap can't map zero bytes)
+
+jmapping* json_map_file(const char* path)
+{
+    if(path == NULL) return NULL;
+    const int fd = open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+    struct stat st;
+    jmapping* map = NULL;
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (map = jmalloc(sizeof(jmapping))) != NULL)
+    {
+        map->length = (size_t)st.st_size;
+        map->data = no_data;
+        if(map->length > 0)
+        {
+            void* data = mmap(NULL, map->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if(data == MAP_FAILED)
+            {
+                jfree(map);
+                map = NULL;
+            }
+            else
+            {
+                madvise(data, map->length, MADV_SEQUENTIAL); // just a hint, parsing reads front to back
+                map->data = data;
+            }
+        }
+    }
+    close(fd); // the mapping keeps the file alive by itself
+    return map;
+}
+
+char* json_mapping_data(const jmapping* map)
+{
+    return map->data;
+}
+
+size_t json_mapping_length(const jmapping* map)
+{
+    return map->length;
+}
+
+void json_unmap_file(jmapping* map)
+{
+    if(map == NULL) return;
+    if(map->data != no_data) munmap(map->data, map->length);
+    jfree(map);
+}
+
+int json_parse_mapping(const jmapping* map, jvalue* empty, const jparse_options* opts)
+{
+    if(map == NULL) return JSON_FAILURE;
+    return jparse_range(map->data, map->data + map->length, empty, opts, NULL, 0);
+}
+
+int json_parse_file(const char* path, jvalue* empty, const jparse_options* opts)
+{
+    jmapping* map = json_map_file(path);
+    if(map == NULL) return JSON_FAILURE;
+    // the mapping is gone when this returns, so nothing may point into it
+    jparse_options copying = { 0 };
+    if(opts != NULL) copying = *opts;
+    copying.flags &= ~(JSON_PARSE_INSITU | JSON_PARSE_LAZY);
+    const int result = json_parse_mapping(map, empty, &copying);
+    json_unmap_file(map);
+    return result;
+}
@@ -0,0 +1,278 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// newline-delimited JSON: the buffer is cut into lines up front (memchr is far faster than parsing),
+// then a pool of workers takes chunks of lines off a shared counter and parses them in place, each with its own arena
+// results land in a slot per line, so putting them back in input order is free
+// the callback api goes round by round (a few thousand lines per worker), so memory stays bounded however big the input is
+// the workers are started once per parse and wait between rounds, so lots of rounds don't mean lots of threads
+
+#define JNDJSON_CHUNK 64 // lines a worker takes at a time
+#define JNDJSON_ROUND_LINES 4096 // lines per worker per round (callback api)
+
+typedef struct jspan {
+    const char* start;
+    size_t length;
+} jspan;
+
+typedef struct jndjson_job {
+    const jspan* lines;
+    size_t count;
+    jvalue** results; // one per line, NULL if it didn't parse
+    size_t next; // first line nobody has taken yet (atomic)
+    unsigned int flags;
+    const jpaths* projection; // only ever read, so the workers share it
+    jintern* intern; // shared too, it's safe to use from every thread at once
+} jndjson_job;
+
+typedef struct jndjson_pool jndjson_pool;
+
+typedef struct jworker {
+    jndjson_job* job;
+    jarena* arena; // NULL for the array api, where every value is malloc'd and handed over
+    pthread_t thread;
+    jndjson_pool* pool;
+} jworker;
+
+// the calling thread is workers[0], the others wait on go for the next round and report back on done
+struct jndjson_pool {
+    jworker* workers;
+    unsigned int started; // workers running, the calling thread included (thread creation may fall short)
+    pthread_mutex_t lock;
+    pthread_cond_t go;
+    pthread_cond_t done;
+    jndjson_job* job; // the round's job
+    size_t round; // bumped for every round, so a worker can tell a new one from a spurious wakeup
+    unsigned int busy; // started workers still on the current round
+    int closing;
+};
+
+static jvalue* parse_line(jworker* w, const jspan* line, const jndjson_job* job)
+{
+    // lines are parsed straight out of the buffer, bounded by their length (flags never include in-situ, so it isn't written to)
+    const jparse_options opts = { .flags = job->flags, .arena = w->arena, .projection = job->projection,
+                                  .intern = job->intern };
+    jvalue* value = w->arena != NULL ? json_arena_alloc(w->arena, sizeof(jvalue)) : jcalloc(sizeof(jvalue));
+    if(value == NULL) return NULL;
+    if(json_parse_n(line->start, line->length, value, &opts, NULL))
+    {
+        if(w->arena == NULL) json_free_value(value);
+        return NULL;
+    }
+    return value;
+}
+
+static void* work(void* arg)
+{
+    jworker* w = arg;
+    jndjson_job* job = w->job;
+    while(1)
+    {
+        const size_t first = __atomic_fetch_add(&job->next, JNDJSON_CHUNK, __ATOMIC_RELAXED);
+        if(first >= job->count) break;
+        const size_t last = first + JNDJSON_CHUNK < job->count ? first + JNDJSON_CHUNK : job->count;
+        for(size_t i = first; i < last; i++) job->results[i] = parse_line(w, &job->lines[i], job);
+    }
+    return NULL;
+}
+
+static void* pool_worker(void* arg)
+{
+    jworker* w = arg;
+    jndjson_pool* pool = w->pool;
+    size_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while(1)
+    {
+        while(pool->round == seen && !pool->closing) pthread_cond_wait(&pool->go, &pool->lock);
+        if(pool->closing) break;
+        seen = pool->round;
+        w->job = pool->job;
+        pthread_mutex_unlock(&pool->lock);
+        work(w);
+        pthread_mutex_lock(&pool->lock);
+        if(--pool->busy == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// start the other threads' workers, fewer of them than asked for is still correct
+static void pool_start(jndjson_pool* pool, jworker* workers, unsigned int threads)
+{
+    *pool = (jndjson_pool){ .workers = workers, .started = 1 };
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->go, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for(; pool->started < threads; pool->started++)
+    {
+        jworker* w = &workers[pool->started];
+        w->pool = pool;
+        if(pthread_create(&w->thread, NULL, pool_worker, w) != 0) break;
+    }
+}
+
+// parse every line of job, the calling thread joining in, and wait until it's all done
+static void pool_run(jndjson_pool* pool, jndjson_job* job)
+{
+    job->next = 0;
+    pthread_mutex_lock(&pool->lock);
+    pool->job = job;
+    pool->busy = pool->started - 1;
+    pool->round++;
+    pthread_cond_broadcast(&pool->go);
+    pthread_mutex_unlock(&pool->lock);
+    pool->workers[0].job = job;
+    work(&pool->workers[0]);
+    pthread_mutex_lock(&pool->lock);
+    while(pool->busy > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_stop(jndjson_pool* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->closing = 1;
+    pthread_cond_broadcast(&pool->go);
+    pthread_mutex_unlock(&pool->lock);
+    for(unsigned int i = 1; i < pool->started; i++) pthread_join(pool->workers[i].thread, NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->go);
+    pthread_cond_destroy(&pool->done);
+}
+
+static int blank(const char* p, const char* end)
+{
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p == end;
+}
+
+// cut up to max non-blank lines out of [*p, end), leaving *p after the last one taken
+static size_t split_lines(const char** p, const char* end, jspan* lines, size_t max)
+{
+    size_t count = 0;
+    while(*p < end && count < max)
+    {
+        const char* newline = memchr(*p, '\n', end - *p);
+        const char* line_end = newline != NULL ? newline : end;
+        if(!blank(*p, line_end))
+        {
+            lines[count].start = *p;
+            lines[count].length = line_end - *p;
+            count++;
+        }
+        *p = newline != NULL ? newline + 1 : end;
+    }
+    return count;
+}
+
+static unsigned int thread_count(const jndjson_options* opts)
+{
+    if(opts != NULL && opts->threads > 0) return opts->threads;
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (unsigned int)online : 1;
+}
+
+// the parse flags records can use: nothing may point into the input, it's read-only and may go away (a mapped file does)
+static unsigned int record_flags(const jndjson_options* opts)
+{
+    return opts != NULL ? opts->flags & ~(JSON_PARSE_INSITU | JSON_PARSE_LAZY) : 0;
+}
+
+static void free_workers(jworker* workers, unsigned int threads)
+{
+    for(unsigned int i = 0; i < threads; i++) json_arena_destroy(workers[i].arena);
+    jfree(workers);
+}
+
+int json_parse_ndjson(const char* buffer, size_t length, const jndjson_options* opts, json_record_fn callback, void* user)
+{
+    if(buffer == NULL || callback == NULL) return JSON_FAILURE;
+    const unsigned int threads = thread_count(opts);
+    const size_t round = (size_t)threads * JNDJSON_ROUND_LINES;
+    jworker* workers = jcalloc(threads * sizeof(jworker));
+    jspan* lines = jmalloc(round * sizeof(jspan));
+    jvalue** results = jmalloc(round * sizeof(jvalue*));
+    int result = workers == NULL || lines == NULL || results == NULL ? JSON_FAILURE : JSON_SUCCESS;
+    for(unsigned int i = 0; result == JSON_SUCCESS && i < threads; i++)
+    {
+        workers[i].arena = json_arena_create(0);
+        if(workers[i].arena == NULL) result = JSON_FAILURE;
+    }
+    const char* p = buffer;
+    const char* end = buffer + length;
+    size_t record = 0;
+    int stopped = 0;
+    int bad_records = 0; // keep going past these, the callback decides what a bad record means
+    jndjson_pool pool;
+    const int pooled = result == JSON_SUCCESS;
+    if(pooled) pool_start(&pool, workers, threads);
+    while(result == JSON_SUCCESS && !stopped && p < end)
+    {
+        jndjson_job job = { .lines = lines, .results = results, .flags = record_flags(opts),
+                            .projection = opts != NULL ? opts->projection : NULL, .intern = opts != NULL ? opts->intern : NULL };
+        job.count = split_lines(&p, end, lines, round);
+        pool_run(&pool, &job);
+        for(size_t i = 0; i < job.count; i++, record++)
+        {
+            if(results[i] == NULL) bad_records = 1;
+            if(callback(user, record, results[i]))
+            {
+                stopped = 1;
+                break;
+            }
+        }
+        for(unsigned int i = 0; i < threads; i++) json_arena_reset(workers[i].arena);
+    }
+    if(pooled) pool_stop(&pool);
+    if(workers != NULL) free_workers(workers, threads);
+    jfree(lines);
+    jfree(results);
+    return result || stopped || bad_records ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+jvalue** json_parse_ndjson_array(const char* buffer, size_t length, const jndjson_options* opts, size_t* count)
+{
+    if(buffer == NULL || count == NULL) return NULL;
+    // count the lines first, so every one of them gets parsed in a single job
+    size_t max = 1;
+    for(const char* p = buffer; (p = memchr(p, '\n', buffer + length - p)) != NULL; p++) max++;
+    const unsigned int threads = thread_count(opts);
+    jworker* workers = jcalloc(threads * sizeof(jworker));
+    jspan* lines = jmalloc(max * sizeof(jspan));
+    jvalue** results = jcalloc(max * sizeof(jvalue*));
+    if(workers == NULL || lines == NULL || results == NULL)
+    {
+        jfree(workers);
+        jfree(lines);
+        jfree(results);
+        return NULL;
+    }
+    const char* p = buffer;
+    jndjson_job job = { .lines = lines, .results = results, .flags = record_flags(opts),
+                        .projection = opts != NULL ? opts->projection : NULL, .intern = opts != NULL ? opts->intern : NULL };
+    job.count = split_lines(&p, buffer + length, lines, max);
+    // a single round: no arenas, values are malloc'd, and each thread's malloc keeps to its own heap anyway
+    jndjson_pool pool;
+    pool_start(&pool, workers, threads);
+    pool_run(&pool, &job);
+    pool_stop(&pool);
+    free_workers(workers, threads);
+    jfree(lines);
+    *count = job.count;
+    return results;
+}
+
+int json_parse_ndjson_file(const char* path, const jndjson_options* opts, json_record_fn callback, void* user)
+{
+    jmapping* map = json_map_file(path);
+    if(map == NULL) return JSON_FAILURE;
+    const int result = json_parse_ndjson(json_mapping_data(map), json_mapping_length(map), opts, callback, user);
+    json_unmap_file(map);
+    return result;
+}
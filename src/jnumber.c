@@ -0,0 +1,549 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <locale.h>
+#include <stdlib.h>
+#include <string.h>
+
+// numbers: strict JSON grammar, exact 64 bit integers, correctly rounded doubles, shortest round-trip output
+//
+// parsing reads the digits into a 64 bit mantissa w and a decimal exponent q, then tries (in order)
+//  - Clinger's fast path: w and 10^q are both exact doubles, so one multiplication/division rounds correctly
+//  - Eisel-Lemire: multiply w by a 128 bit approximation of 5^q, which settles almost every other case
+//  - strtod on a copy of the text with the locale's decimal point, for the rest (more than 19 digits, ambiguous halfway cases)
+//
+// formatting uses Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers")
+// to find the shortest digits that round-trip, then picks fixed or exponent notation, whichever is shorter
+
+#include "jnumber_tables.h"
+
+#define DOUBLE_MANTISSA_BITS 52
+#define DOUBLE_HIDDEN_BIT (1ULL << DOUBLE_MANTISSA_BITS)
+#define DOUBLE_EXPONENT_BIAS 1075 // 1023 + 52, so the mantissa can be treated as an integer
+#define SMALLEST_POWER_OF_TEN -342 // anything with a smaller decimal exponent is 0
+#define LARGEST_POWER_OF_TEN 308 // anything with a larger decimal exponent is infinity
+
+typedef unsigned __int128 uint128;
+
+static double from_bits(uint64_t bits)
+{
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static uint64_t to_bits(double d)
+{
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return bits;
+}
+
+static int is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// PARSING
+
+// Eisel-Lemire, following Lemire, "Number Parsing at a Gigabyte per Second" (and fast_float's compute_float)
+// w != 0, SMALLEST_POWER_OF_TEN <= q <= LARGEST_POWER_OF_TEN
+// returns the bits of the (positive) double
+static uint64_t eisel_lemire(uint64_t w, int q)
+{
+    const int lz = __builtin_clzll(w);
+    w <<= lz;
+    const int index = 2 * (q - SMALLEST_POWER_OF_TEN);
+    uint128 product = (uint128)w * powers_of_five[index];
+    uint64_t high = (uint64_t)(product >> 64);
+    uint64_t low = (uint64_t)product;
+    const uint64_t precision_mask = 0xffffffffffffffffULL >> (DOUBLE_MANTISSA_BITS + 3);
+    if((high & precision_mask) == precision_mask) // the truncated bits matter, bring in the low word of 5^q too
+    {
+        const uint128 second = (uint128)w * powers_of_five[index + 1];
+        const uint64_t second_high = (uint64_t)(second >> 64);
+        low += second_high;
+        if(second_high > low) high++;
+    }
+    const int upperbit = (int)(high >> 63);
+    const int shift = upperbit + 64 - DOUBLE_MANTISSA_BITS - 3;
+    uint64_t mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, then account for the normalization shifts
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+    if(power2 <= 0) // subnormal
+    {
+        if(-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        power2 = mantissa < DOUBLE_HIDDEN_BIT ? 0 : 1;
+        return ((uint64_t)power2 << DOUBLE_MANTISSA_BITS) | (mantissa & (DOUBLE_HIDDEN_BIT - 1));
+    }
+    // exactly halfway between two doubles: round to even (only possible for small q, where 5^q is exact)
+    if(low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) mantissa &= ~1ULL;
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (DOUBLE_HIDDEN_BIT << 1)) // rounding overflowed into the next binade
+    {
+        mantissa = DOUBLE_HIDDEN_BIT;
+        power2++;
+    }
+    mantissa &= ~DOUBLE_HIDDEN_BIT;
+    if(power2 >= 0x7ff) return 0x7ffULL << DOUBLE_MANTISSA_BITS; // infinity
+    return ((uint64_t)power2 << DOUBLE_MANTISSA_BITS) | mantissa;
+}
+
+// strtod, but immune to the locale's idea of a decimal point
+static double fallback_strtod(const char* start, size_t length)
+{
+    char local[64];
+    char* copy = length < sizeof(local) ? local : jmalloc(length + 1);
+    if(copy == NULL) return 0; // out of memory on a 64+ character number, nothing sensible left to do
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+    const char point = localeconv()->decimal_point[0];
+    if(point != '.')
+    {
+        char* dot = memchr(copy, '.', length);
+        if(dot != NULL) *dot = point;
+    }
+    const double value = strtod(copy, NULL);
+    if(copy != local) jfree(copy);
+    return value;
+}
+
+int jnumber_parse(const char* p, const char** end, double* number, int64_t* integer, int* is_integer)
+{
+    static const double exact_powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                           1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* start = p;
+    const int negative = *p == '-';
+    if(negative) p++;
+    if(!is_digit(*p)) return JSON_FAILURE;
+
+    uint64_t w = 0; // first 19 significant digits
+    int digits = 0; // significant digits seen (leading zeros don't count)
+    int dropped = 0; // significant digits that didn't fit in w
+    int q = 0; // decimal exponent of the last digit in w
+
+    // integer part: a single 0, or a run of digits not starting with 0
+    if(*p == '0')
+    {
+        p++;
+        if(is_digit(*p)) return JSON_FAILURE; // no leading zeros
+    }
+    else
+    {
+        for(; is_digit(*p); p++)
+        {
+            if(digits < 19) w = w * 10 + (*p - '0');
+            else dropped++;
+            digits++;
+        }
+    }
+    q = dropped;
+
+    int is_float = 0;
+    if(*p == '.')
+    {
+        is_float = 1;
+        p++;
+        if(!is_digit(*p)) return JSON_FAILURE; // need at least one digit after the point
+        for(; is_digit(*p); p++)
+        {
+            if(digits == 0 && *p == '0') // still in leading zeros (0.000...)
+            {
+                q--;
+                continue;
+            }
+            if(digits < 19)
+            {
+                w = w * 10 + (*p - '0');
+                q--;
+            }
+            else dropped++;
+            digits++;
+        }
+    }
+    if(*p == 'e' || *p == 'E')
+    {
+        is_float = 1;
+        p++;
+        int exponent_negative = 0;
+        if(*p == '+' || *p == '-')
+        {
+            exponent_negative = *p == '-';
+            p++;
+        }
+        if(!is_digit(*p)) return JSON_FAILURE;
+        int exponent = 0;
+        for(; is_digit(*p); p++)
+            if(exponent < 100000) exponent = exponent * 10 + (*p - '0'); // anything past this is 0 or infinity anyways
+        q += exponent_negative ? -exponent : exponent;
+    }
+    *end = p;
+
+    *is_integer = 0;
+    if(!is_float && dropped == 0 && (w <= (uint64_t)INT64_MAX || (negative && w == (uint64_t)INT64_MAX + 1)))
+    {
+        *is_integer = 1;
+        *integer = negative ? (int64_t)(0 - w) : (int64_t)w;
+        *number = negative ? -(double)w : (double)w; // int to double conversion rounds correctly (and keeps -0)
+        return JSON_SUCCESS;
+    }
+
+    double value;
+    if(w == 0) value = 0;
+    else if(dropped == 0 && w <= DOUBLE_HIDDEN_BIT << 1 && q >= -22 && q <= 22) // Clinger
+        value = q < 0 ? (double)w / exact_powers[-q] : (double)w * exact_powers[q];
+    else if(dropped == 0 && q < SMALLEST_POWER_OF_TEN) value = 0;
+    else if(dropped == 0 && q > LARGEST_POWER_OF_TEN) value = from_bits(0x7ffULL << DOUBLE_MANTISSA_BITS);
+    else if(dropped == 0) value = from_bits(eisel_lemire(w, q));
+    else value = fallback_strtod(negative ? start + 1 : start, p - (negative ? start + 1 : start));
+    *number = negative ? -value : value;
+    return JSON_SUCCESS;
+}
+
+// are the 8 bytes of chunk all digits: every byte has a high nibble of 3, and adding 6 to it doesn't carry out of the low one
+static int eight_digits(uint64_t chunk)
+{
+    return ((chunk & 0xf0f0f0f0f0f0f0f0ULL) | (((chunk + 0x0606060606060606ULL) & 0xf0f0f0f0f0f0f0f0ULL) >> 4))
+           == 0x3333333333333333ULL;
+}
+
+// value of 8 digits read little-endian into chunk: pairs of digits, then pairs of pairs, then the two halves,
+// each step one multiply for all the lanes at once
+static uint32_t eight_digits_value(uint64_t chunk)
+{
+    chunk -= 0x3030303030303030ULL;
+    chunk = chunk * 10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000ff000000ffULL) * (100 + (1000000ULL << 32))
+             + ((chunk >> 16) & 0x000000ff000000ffULL) * (1 + (10000ULL << 32))) >> 32;
+    return (uint32_t)chunk;
+}
+
+int jnumber_parse_integer(const char* p, const char* end, const char** stop, int64_t* integer)
+{
+    const int negative = p < end && *p == '-';
+    if(negative) p++;
+    const char* first = p;
+    uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // at most two chunks, a third could overflow (and wouldn't be simple anymore anyways)
+    for(int chunks = 0; chunks < 2 && end - p >= 8; chunks++, p += 8)
+    {
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        if(!eight_digits(chunk)) break;
+        value = value * 100000000 + eight_digits_value(chunk);
+    }
+#endif
+    for(; p < end && is_digit(*p); p++)
+    {
+        if(p - first == 18) return JSON_FAILURE;
+        value = value * 10 + (*p - '0');
+    }
+    if(p == first || (*first == '0' && p - first > 1)) return JSON_FAILURE; // no digits, or a leading zero
+    if(p < end && (*p == '.' || *p == 'e' || *p == 'E')) return JSON_FAILURE; // not an integer after all
+    if(negative && value == 0) return JSON_FAILURE; // -0 isn't a plain integer either
+    *integer = negative ? -(int64_t)value : (int64_t)value;
+    *stop = p;
+    return JSON_SUCCESS;
+}
+
+int json_number_parse(const char* text, char** end, double* value)
+{
+    int64_t integer;
+    int is_integer;
+    const char* stop = text;
+    const int result = jnumber_parse(text, &stop, value, &integer, &is_integer);
+    if(end != NULL) *end = (char*)(result == JSON_SUCCESS ? stop : text);
+    return result;
+}
+
+// FORMATTING
+
+typedef struct diyfp {
+    uint64_t f;
+    int e;
+} diyfp;
+
+static diyfp diyfp_from_double(double d)
+{
+    const uint64_t bits = to_bits(d);
+    const int biased = (int)((bits >> DOUBLE_MANTISSA_BITS) & 0x7ff);
+    const uint64_t significand = bits & (DOUBLE_HIDDEN_BIT - 1);
+    if(biased != 0) return (diyfp){ significand + DOUBLE_HIDDEN_BIT, biased - DOUBLE_EXPONENT_BIAS };
+    return (diyfp){ significand, 1 - DOUBLE_EXPONENT_BIAS }; // subnormal
+}
+
+static diyfp diyfp_normalize(diyfp x)
+{
+    const int shift = __builtin_clzll(x.f);
+    return (diyfp){ x.f << shift, x.e - shift };
+}
+
+static diyfp diyfp_multiply(diyfp a, diyfp b)
+{
+    const uint128 product = (uint128)a.f * b.f;
+    uint64_t high = (uint64_t)(product >> 64);
+    high += (uint64_t)product >> 63; // round
+    return (diyfp){ high, a.e + b.e + 64 };
+}
+
+// the boundaries halfway to the neighbouring doubles, normalized to the same exponent
+static void diyfp_boundaries(diyfp v, diyfp* minus, diyfp* plus)
+{
+    diyfp p = { (v.f << 1) + 1, v.e - 1 };
+    while(!(p.f & (DOUBLE_HIDDEN_BIT << 1)))
+    {
+        p.f <<= 1;
+        p.e--;
+    }
+    p.f <<= 64 - DOUBLE_MANTISSA_BITS - 2;
+    p.e -= 64 - DOUBLE_MANTISSA_BITS - 2;
+    // the lower boundary is closer when v is a power of two (the double below has a smaller exponent)
+    diyfp m = v.f == DOUBLE_HIDDEN_BIT ? (diyfp){ (v.f << 2) - 1, v.e - 2 } : (diyfp){ (v.f << 1) - 1, v.e - 1 };
+    m.f <<= m.e - p.e;
+    m.e = p.e;
+    *minus = m;
+    *plus = p;
+}
+
+// cached power of ten c = 10^-K such that the product with a number with binary exponent e lands in a useful range
+static diyfp cached_power(int e, int* K)
+{
+    const double dk = (-61 - e) * 0.30102999566398114 + 347; // always positive, so truncating + 1 is a ceiling
+    int k = (int)dk;
+    if(dk - k > 0.0) k++;
+    const unsigned index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    return (diyfp){ cached_powers_f[index], cached_powers_e[index] };
+}
+
+static void grisu_round(char* buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while(rest < wp_w && delta - rest >= ten_kappa && (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+    {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int count_digits(uint32_t n)
+{
+    int digits = 1;
+    while(n >= 10)
+    {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+static void digit_gen(diyfp w, diyfp mp, uint64_t delta, char* buffer, int* length, int* K)
+{
+    static const uint64_t pow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+                                      100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+                                      10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+                                      100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL };
+    const diyfp one = { 1ULL << -mp.e, mp.e };
+    const uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = count_digits(p1);
+    *length = 0;
+    while(kappa > 0)
+    {
+        const uint32_t divisor = (uint32_t)pow10[kappa - 1];
+        const uint32_t d = p1 / divisor;
+        p1 %= divisor;
+        if(d || *length) buffer[(*length)++] = (char)('0' + d);
+        kappa--;
+        const uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if(rest <= delta)
+        {
+            *K += kappa;
+            grisu_round(buffer, *length, delta, rest, pow10[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+    while(1)
+    {
+        p2 *= 10;
+        delta *= 10;
+        const char d = (char)(p2 >> -one.e);
+        if(d || *length) buffer[(*length)++] = (char)('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+        if(p2 < delta)
+        {
+            *K += kappa;
+            const int index = -kappa;
+            grisu_round(buffer, *length, delta, p2, one.f, wp_w * (index < 20 ? pow10[index] : 0));
+            return;
+        }
+    }
+}
+
+// shortest digits of a positive, finite, non-zero value: value = digits * 10^K
+static void grisu2(double value, char* digits, int* length, int* K)
+{
+    const diyfp v = diyfp_from_double(value);
+    diyfp w_minus, w_plus;
+    diyfp_boundaries(v, &w_minus, &w_plus);
+    const diyfp c = cached_power(w_plus.e, K);
+    const diyfp w = diyfp_multiply(diyfp_normalize(v), c);
+    diyfp wp = diyfp_multiply(w_plus, c);
+    diyfp wm = diyfp_multiply(w_minus, c);
+    wm.f++;
+    wp.f--;
+    digit_gen(w, wp, wp.f - wm.f, digits, length, K);
+}
+
+// Grisu2 narrows the rounding interval a little to stay exact with 64 bit arithmetic, so once in a while
+// (about 1 in 2000 random doubles) it settles for 16 or 17 digits where fewer would have done
+// drop the last digit (rounding down, then up) as long as the result still reads back as the same double
+static void shorten(double value, char* digits, int* length, int* K)
+{
+    while(*length >= 16)
+    {
+        uint64_t w = 0;
+        for(int i = 0; i < *length - 1; i++) w = w * 10 + (digits[i] - '0');
+        const int q = *K + 1;
+        if(q < SMALLEST_POWER_OF_TEN || q > LARGEST_POWER_OF_TEN) return;
+        if(w == 0 || from_bits(eisel_lemire(w, q)) != value)
+        {
+            w++;
+            if(from_bits(eisel_lemire(w, q)) != value) return;
+        }
+        // write the shorter digits back, minus trailing zeros (they don't make the number any more precise)
+        int n = 0;
+        char reversed[20];
+        int exponent = q;
+        while(w % 10 == 0)
+        {
+            w /= 10;
+            exponent++;
+        }
+        while(w != 0)
+        {
+            reversed[n++] = (char)('0' + w % 10);
+            w /= 10;
+        }
+        for(int i = 0; i < n; i++) digits[i] = reversed[n - 1 - i];
+        *length = n;
+        *K = exponent;
+    }
+}
+
+static int write_exponent(int exponent, char* out)
+{
+    char* pos = out;
+    if(exponent < 0)
+    {
+        *pos++ = '-';
+        exponent = -exponent;
+    }
+    if(exponent >= 100) *pos++ = (char)('0' + exponent / 100);
+    if(exponent >= 10) *pos++ = (char)('0' + exponent / 10 % 10);
+    *pos++ = (char)('0' + exponent % 10);
+    return (int)(pos - out);
+}
+
+int json_number_format(double value, char* buffer)
+{
+    const uint64_t bits = to_bits(value);
+    if(((bits >> DOUBLE_MANTISSA_BITS) & 0x7ff) == 0x7ff) return 0; // infinity and nan aren't JSON
+    char* out = buffer;
+    if(bits >> 63)
+    {
+        *out++ = '-';
+        value = -value;
+    }
+    if(value == 0)
+    {
+        memcpy(out, "0.0", 3);
+        return (int)(out - buffer) + 3;
+    }
+
+    char digits[20];
+    int length, K;
+    grisu2(value, digits, &length, &K);
+    shorten(value, digits, &length, &K);
+    const int point = length + K; // position of the decimal point relative to the first digit
+
+    // fixed notation length: digits, padding zeros, the point, and a ".0" for integral values so they stay doubles
+    int fixed;
+    if(point <= 0) fixed = 2 - point + length; // 0.000ddd
+    else if(point < length) fixed = length + 1; // dd.ddd
+    else fixed = point + 2; // ddd000.0
+    // exponent notation length: d.ddde-xx
+    char exponent[8];
+    const int exponent_length = write_exponent(point - 1, exponent);
+    const int scientific = length + (length > 1 ? 1 : 0) + 1 + exponent_length;
+
+    if(fixed <= scientific)
+    {
+        if(point <= 0)
+        {
+            *out++ = '0';
+            *out++ = '.';
+            memset(out, '0', -point);
+            out += -point;
+            memcpy(out, digits, length);
+            out += length;
+        }
+        else if(point < length)
+        {
+            memcpy(out, digits, point);
+            out += point;
+            *out++ = '.';
+            memcpy(out, digits + point, length - point);
+            out += length - point;
+        }
+        else
+        {
+            memcpy(out, digits, length);
+            out += length;
+            memset(out, '0', point - length);
+            out += point - length;
+            *out++ = '.';
+            *out++ = '0';
+        }
+    }
+    else
+    {
+        *out++ = digits[0];
+        if(length > 1)
+        {
+            *out++ = '.';
+            memcpy(out, digits + 1, length - 1);
+            out += length - 1;
+        }
+        *out++ = 'e';
+        memcpy(out, exponent, exponent_length);
+        out += exponent_length;
+    }
+    return (int)(out - buffer);
+}
+
+int jnumber_format_integer(int64_t integer, int negative_zero, char* buffer)
+{
+    char reversed[20];
+    int length = 0;
+    char* out = buffer;
+    uint64_t magnitude = (uint64_t)integer;
+    if(integer < 0 || negative_zero)
+    {
+        *out++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    do
+    {
+        reversed[length++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while(magnitude != 0);
+    while(length > 0) *out++ = reversed[--length];
+    return (int)(out - buffer);
+}
@@ -0,0 +1,284 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// json pointers (RFC 6901) are compiled once into a list of steps, each holding its unescaped key, the key's hash
+// (so indexed objects are a single probe) and the key read as an array index, and then run against any number of trees
+// several pointers compile into a trie of steps, so a shared prefix is only walked once and every object on the way
+// is scanned once for all the keys wanted from it
+
+#define JSTEP_NO_INDEX ((size_t)-1) // the token isn't a valid array index
+#define JPATH_WIDE 64 // objects with more keys wanted than this are looked up key by key instead of in one scan
+
+typedef struct jstep {
+    char* key; // the reference token with ~1 and ~0 decoded
+    size_t length;
+    uint64_t hash; // json_hash_key(key)
+    size_t index; // the token as an array index, or JSTEP_NO_INDEX
+} jstep;
+
+struct jpointer {
+    size_t count;
+    jstep* steps; // the keys are stored right after the steps, in the same allocation
+};
+
+typedef struct jpath_node {
+    const jstep* step; // how to get here from the parent (NULL for the root)
+    size_t first_child;
+    size_t next_sibling;
+    size_t first_path; // first path that ends here, the others are chained through jpaths.next_path
+    size_t children;
+} jpath_node;
+
+struct jpaths {
+    size_t count;
+    jpointer** pointers; // the compiled paths, which the nodes' steps point into
+    size_t* next_path;
+    jpath_node* nodes; // nodes[0] is the root
+    size_t node_count;
+};
+
+// "0", or digits without a leading zero
+static size_t token_index(const char* key)
+{
+    if(*key == '\0' || (key[0] == '0' && key[1] != '\0')) return JSTEP_NO_INDEX;
+    size_t index = 0;
+    for(const char* c = key; *c != '\0'; c++)
+    {
+        if(*c < '0' || *c > '9') return JSTEP_NO_INDEX;
+        if(index > (JSTEP_NO_INDEX - 1 - (size_t)(*c - '0')) / 10) return JSTEP_NO_INDEX; // too big to be any array's index
+        index = index * 10 + (size_t)(*c - '0');
+    }
+    return index;
+}
+
+jpointer* json_pointer_compile(const char* pointer)
+{
+    if(pointer == NULL || (*pointer != '\0' && *pointer != '/')) return NULL;
+    size_t count = 0;
+    for(const char* c = pointer; *c != '\0'; c++) count += *c == '/';
+    const size_t length = strlen(pointer);
+    // one block: the header, the steps, then every key (each token decodes to at most its own length, plus a terminator)
+    jpointer* ptr = jmalloc(sizeof(jpointer) + count * sizeof(jstep) + length + 1);
+    if(ptr == NULL) return NULL;
+    ptr->count = count;
+    ptr->steps = (jstep*)(ptr + 1);
+    char* out = (char*)(ptr->steps + count);
+    const char* c = pointer;
+    for(size_t i = 0; i < count; i++)
+    {
+        c++; // the slash
+        jstep* step = &ptr->steps[i];
+        step->key = out;
+        for(; *c != '\0' && *c != '/'; c++)
+        {
+            if(*c != '~')
+            {
+                *out++ = *c;
+                continue;
+            }
+            if(c[1] != '0' && c[1] != '1') // ~ has to be followed by 0 or 1
+            {
+                jfree(ptr);
+                return NULL;
+            }
+            *out++ = c[1] == '0' ? '~' : '/';
+            c++;
+        }
+        step->length = out - step->key;
+        *out++ = '\0';
+        step->hash = json_hash_key(step->key);
+        step->index = token_index(step->key);
+    }
+    return ptr;
+}
+
+void json_pointer_free(jpointer* ptr)
+{
+    jfree(ptr);
+}
+
+// the member of obj for step (the first one with that key, like json_search_by_key, but never building an index)
+static jvalue* member_for(const jstep* step, const jvalue* obj)
+{
+    if(obj->index != NULL)
+    {
+        const size_t found = jindex_find_hashed(obj->index, obj->members, step->key, step->hash);
+        return found != JINDEX_NONE ? &obj->members[found].value : NULL;
+    }
+    for(size_t i = 0; i < obj->length; i++)
+    {
+        jmember* m = &obj->members[i];
+        if(m->key[0] == step->key[0] && !strcmp(m->key, step->key)) return &m->value;
+    }
+    return NULL;
+}
+
+static jvalue* step_into(const jstep* step, const jvalue* v)
+{
+    if(json_materialize((jvalue*)v)) return NULL;
+    if(v->type == JSON_OBJECT) return member_for(step, v);
+    if(v->type != JSON_ARRAY || step->index == JSTEP_NO_INDEX) return NULL;
+    return step->index < v->length ? &v->elements[step->index] : NULL;
+}
+
+jvalue* json_pointer_get(const jpointer* ptr, const jvalue* root)
+{
+    if(ptr == NULL) return NULL;
+    const jvalue* v = root;
+    for(size_t i = 0; i < ptr->count && v != NULL; i++) v = step_into(&ptr->steps[i], v);
+    return (jvalue*)v;
+}
+
+void json_paths_free(jpaths* paths)
+{
+    if(paths == NULL) return;
+    for(size_t i = 0; i < paths->count; i++) json_pointer_free(paths->pointers[i]);
+    jfree(paths->pointers);
+    jfree(paths->next_path);
+    jfree(paths->nodes);
+    jfree(paths);
+}
+
+// the child of node reached by step, added if there isn't one yet
+// returns JPATH_NONE on failure
+static size_t child_for(jpaths* paths, size_t* capacity, size_t node, const jstep* step)
+{
+    size_t last = JPATH_NONE;
+    for(size_t c = paths->nodes[node].first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling)
+    {
+        if(!strcmp(paths->nodes[c].step->key, step->key)) return c;
+        last = c;
+    }
+    if(paths->node_count == *capacity)
+    {
+        jpath_node* more = jrealloc(paths->nodes, *capacity * 2 * sizeof(jpath_node));
+        if(more == NULL) return JPATH_NONE;
+        paths->nodes = more;
+        *capacity *= 2;
+    }
+    const size_t added = paths->node_count++;
+    paths->nodes[added] = (jpath_node){ step, JPATH_NONE, JPATH_NONE, JPATH_NONE, 0 };
+    if(last == JPATH_NONE) paths->nodes[node].first_child = added;
+    else paths->nodes[last].next_sibling = added; // keep the children in the order they were asked for
+    paths->nodes[node].children++;
+    return added;
+}
+
+jpaths* json_paths_compile(const char* const* pointers, size_t count)
+{
+    jpaths* paths = jcalloc(sizeof(jpaths));
+    if(paths == NULL) return NULL;
+    size_t capacity = 16;
+    paths->pointers = jcalloc((count ? count : 1) * sizeof(jpointer*));
+    paths->next_path = jmalloc((count ? count : 1) * sizeof(size_t));
+    paths->nodes = jmalloc(capacity * sizeof(jpath_node));
+    if(paths->pointers == NULL || paths->next_path == NULL || paths->nodes == NULL)
+    {
+        json_paths_free(paths);
+        return NULL;
+    }
+    paths->nodes[0] = (jpath_node){ NULL, JPATH_NONE, JPATH_NONE, JPATH_NONE, 0 };
+    paths->node_count = 1;
+    for(size_t i = 0; i < count; i++)
+    {
+        jpointer* ptr = json_pointer_compile(pointers[i]);
+        paths->pointers[i] = ptr;
+        paths->count = i + 1; // so a failure frees what's been compiled so far
+        if(ptr == NULL)
+        {
+            json_paths_free(paths);
+            return NULL;
+        }
+        size_t node = 0;
+        for(size_t s = 0; s < ptr->count && node != JPATH_NONE; s++) node = child_for(paths, &capacity, node, &ptr->steps[s]);
+        if(node == JPATH_NONE)
+        {
+            json_paths_free(paths);
+            return NULL;
+        }
+        paths->next_path[i] = paths->nodes[node].first_path;
+        paths->nodes[node].first_path = i;
+    }
+    return paths;
+}
+
+static size_t walk(const jpaths* paths, size_t node, const jvalue* v, jvalue** out)
+{
+    const jpath_node* n = &paths->nodes[node];
+    size_t found = 0;
+    for(size_t p = n->first_path; p != JPATH_NONE; p = paths->next_path[p])
+    {
+        out[p] = (jvalue*)v;
+        found++;
+    }
+    if(n->children == 0 || json_materialize((jvalue*)v)) return found;
+    if(v->type == JSON_OBJECT && (n->children == 1 || n->children > JPATH_WIDE || v->index != NULL))
+    {
+        for(size_t c = n->first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling)
+        {
+            const jvalue* member = member_for(paths->nodes[c].step, v);
+            if(member != NULL) found += walk(paths, c, member, out);
+        }
+    }
+    else if(v->type == JSON_OBJECT) // one scan over the members for all of the keys, each taking the first member that matches
+    {
+        uint64_t matched = 0;
+        const uint64_t all = n->children == 64 ? ~0ull : (1ull << n->children) - 1;
+        for(size_t i = 0; i < v->length && matched != all; i++)
+        {
+            const jmember* m = &v->members[i];
+            size_t bit = 0;
+            for(size_t c = n->first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling, bit++)
+            {
+                const char* key = paths->nodes[c].step->key;
+                if(matched & 1ull << bit || m->key[0] != key[0] || strcmp(m->key, key) != 0) continue;
+                matched |= 1ull << bit;
+                found += walk(paths, c, &m->value, out);
+                break; // keys in the trie are distinct
+            }
+        }
+    }
+    else if(v->type == JSON_ARRAY)
+    {
+        for(size_t c = n->first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling)
+        {
+            const size_t index = paths->nodes[c].step->index;
+            if(index != JSTEP_NO_INDEX && index < v->length) found += walk(paths, c, &v->elements[index], out);
+        }
+    }
+    return found;
+}
+
+size_t json_paths_get(const jpaths* paths, const jvalue* root, jvalue** out)
+{
+    if(paths == NULL || out == NULL) return 0;
+    for(size_t i = 0; i < paths->count; i++) out[i] = NULL;
+    return root != NULL ? walk(paths, 0, root, out) : 0;
+}
+
+size_t jpaths_child(const jpaths* paths, size_t node, const char* key, size_t length)
+{
+    for(size_t c = paths->nodes[node].first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling)
+    {
+        const jstep* step = paths->nodes[c].step;
+        if(step->length == length && !memcmp(step->key, key, length)) return c;
+    }
+    return JPATH_NONE;
+}
+
+size_t jpaths_element(const jpaths* paths, size_t node, size_t index)
+{
+    for(size_t c = paths->nodes[node].first_child; c != JPATH_NONE; c = paths->nodes[c].next_sibling)
+    {
+        if(paths->nodes[c].step->index == index) return c;
+    }
+    return JPATH_NONE;
+}
+
+int jpaths_ends(const jpaths* paths, size_t node)
+{
+    return paths->nodes[node].first_path != JPATH_NONE;
+}
@@ -0,0 +1,684 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// push parser: a byte-driven state machine that can stop at any byte and pick up where it left off
+// the grammar state lives in an explicit stack of open containers instead of on the C stack,
+// and a token that is cut off by the end of a chunk (string, number or literal) is carried over in a small buffer
+// parsing emits events (jevents), which the tree builder below turns into the same jvalue tree json_parse_value builds
+// (or which go straight to the caller, see json_parse_events)
+
+#define JPUSH_INITIAL_STACK 32
+#define JPUSH_INITIAL_TOKEN 64
+
+enum lex_states {
+    LEX_NONE, // between tokens
+    LEX_STRING,
+    LEX_NUMBER,
+    LEX_LITERAL
+};
+
+enum expect_states {
+    EXPECT_VALUE, // top level, after a colon or after a comma in an array
+    EXPECT_VALUE_OR_CLOSE, // right after [
+    EXPECT_KEY, // after a comma in an object
+    EXPECT_KEY_OR_CLOSE, // right after {
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_CLOSE, // after a value inside a container
+    EXPECT_END // after the top level value, only whitespace is left
+};
+
+// TREE BUILDER
+
+typedef struct jbuild_frame {
+    jvalue* value; // the container being filled
+    size_t capacity; // members or elements it has room for
+    size_t node; // with a projection, the paths node its members or elements are matched against (JPATH_NONE keeps all)
+    size_t position; // elements seen so far, skipped ones included (projections pick them by index)
+} jbuild_frame;
+
+typedef struct jbuilder {
+    jctx ctx;
+    jvalue* root;
+    int root_used;
+    jbuild_frame* frames;
+    size_t depth;
+    size_t frame_capacity;
+    char* key; // key waiting for its value
+    unsigned int key_flags; // and its JSON_FLAG_* bits
+    size_t item_node; // projection node for the root, the value of the member whose key was just read, or the element
+    int containers_only; // its paths go on past it, so it's only kept if it's a container
+    jintern_counts intern_counts; // added to the intern table's totals when the parser is destroyed
+} jbuilder;
+
+static void builder_drop_key(jbuilder* b)
+{
+    if(b->ctx.arena == NULL && !(b->key_flags & JSON_FLAG_INTERNED)) jfree(b->key);
+    b->key = NULL;
+}
+
+// with a projection, match the value that's starting against its array's paths by index, like next_value does
+// (members were matched by builder_key already, and the root has nothing to match)
+// returns 1 if no path goes through it
+static int builder_element(jbuilder* b)
+{
+    if(b->depth == 0) return 0;
+    jbuild_frame* frame = &b->frames[b->depth - 1];
+    if(frame->value->type != JSON_ARRAY) return 0;
+    b->item_node = JPATH_NONE;
+    b->containers_only = 0;
+    if(frame->node == JPATH_NONE) return 0;
+    const size_t child = jpaths_element(b->ctx.projection, frame->node, frame->position++);
+    if(child == JPATH_NONE) return 1;
+    if(!jpaths_ends(b->ctx.projection, child)) b->item_node = child;
+    b->containers_only = b->item_node != JPATH_NONE;
+    return 0;
+}
+
+// with a projection, a scalar that isn't wanted, or turns up where only a container was, is dropped (key and all),
+// like in parse_one
+static int builder_drops_scalar(jbuilder* b)
+{
+    if(builder_element(b)) return 1;
+    if(!b->containers_only) return 0;
+    b->containers_only = 0;
+    builder_drop_key(b);
+    return 1;
+}
+
+// make room for (and hook up) the jvalue the next event fills in
+static jvalue* builder_place(jbuilder* b)
+{
+    if(b->depth == 0)
+    {
+        if(b->root_used) return NULL;
+        b->root_used = 1;
+        b->root->flags = b->ctx.arena != NULL ? JSON_FLAG_ARENA : 0;
+        return b->root;
+    }
+    jbuild_frame* frame = &b->frames[b->depth - 1];
+    jvalue* value;
+    if(frame->value->type == JSON_OBJECT)
+    {
+        jmember* member = jctx_append(&b->ctx, frame->value, &frame->capacity);
+        if(member == NULL) return NULL;
+        member->key = b->key; // the member owns the key from now on
+        member->flags = b->key_flags;
+        b->key = NULL;
+        value = &member->value;
+    }
+    else
+    {
+        value = jctx_append(&b->ctx, frame->value, &frame->capacity);
+        if(value == NULL) return NULL;
+    }
+    value->flags = b->ctx.arena != NULL ? JSON_FLAG_ARENA : 0;
+    return value;
+}
+
+static int builder_open(jbuilder* b, int type)
+{
+    if(b->depth == b->frame_capacity)
+    {
+        const size_t capacity = b->frame_capacity ? b->frame_capacity * 2 : JPUSH_INITIAL_STACK;
+        jbuild_frame* more = jrealloc(b->frames, capacity * sizeof(jbuild_frame));
+        if(more == NULL) return JSON_FAILURE;
+        b->frames = more;
+        b->frame_capacity = capacity;
+    }
+    // members were matched by their key (the root by itself), elements are matched by their index
+    if(builder_element(b)) return JSON_EVENT_SKIP; // not wanted, the parser skips it without any events
+    const size_t node = b->item_node;
+    b->containers_only = 0;
+    jvalue* value = builder_place(b);
+    if(value == NULL) return JSON_FAILURE;
+    value->type = type;
+    value->members = NULL; // same slot as elements, room is made as they come in
+    value->length = 0;
+    value->index = NULL;
+    b->frames[b->depth++] = (jbuild_frame){ .value = value, .node = node };
+    return JSON_SUCCESS;
+}
+
+static int builder_start_object(void* user)
+{
+    return builder_open(user, JSON_OBJECT);
+}
+
+static int builder_start_array(void* user)
+{
+    return builder_open(user, JSON_ARRAY);
+}
+
+// with JSON_PARSE_PACK_NUMBERS, an array that turned out to hold nothing but numbers is packed once it's closed (the
+// same way parse_one packs it up front), in place: number i goes in the block's i-th 8 bytes, which are never past
+// element i, so nothing is overwritten before it's been read
+// like there, doubles are only packed if every integer among them fits in one exactly
+static void builder_pack(const jctx* ctx, jvalue* array)
+{
+    int integers = 1;
+    int inexact = 0;
+    for(size_t i = 0; i < array->length; i++)
+    {
+        const jvalue* element = &array->elements[i];
+        if(element->type != JSON_NUMBER) return; // stays an array like any other
+        if(!(element->flags & JSON_FLAG_INTEGER) || (element->integer == 0 && signbit(element->number))) integers = 0;
+        else inexact |= !jnumber_fits_double(element->integer);
+    }
+    if(!integers && inexact) return;
+    char* block = (char*)array->elements;
+    for(size_t i = 0; i < array->length; i++)
+    {
+        const jvalue element = array->elements[i];
+        if(integers) memcpy(block + i * 8, &element.integer, 8);
+        else memcpy(block + i * 8, &element.number, 8);
+    }
+    if(ctx->arena == NULL) // give back what the jvalues took beyond that
+    {
+        char* shrunk = jrealloc(block, array->length * 8);
+        if(shrunk != NULL) block = shrunk;
+    }
+    array->integers = (int64_t*)block; // same slot as numbers
+    array->arena = ctx->arena;
+    array->flags |= JSON_FLAG_PACKED | (integers ? JSON_FLAG_INTEGER : 0);
+}
+
+static int builder_end(void* user)
+{
+    jbuilder* b = user;
+    jbuild_frame* frame = &b->frames[--b->depth];
+    if(jctx_finish(&b->ctx, frame->value, frame->capacity)) return JSON_FAILURE;
+    // like parse_one, arrays a projection goes through are left alone, only ones that are wanted whole are packed
+    if(frame->value->type == JSON_ARRAY && frame->value->length > 0 && (b->ctx.flags & JSON_PARSE_PACK_NUMBERS)
+       && frame->node == JPATH_NONE)
+        builder_pack(&b->ctx, frame->value);
+    return JSON_SUCCESS;
+}
+
+static int builder_key(void* user, const char* key, size_t length)
+{
+    jbuilder* b = user;
+    const size_t node = b->frames[b->depth - 1].node;
+    b->item_node = JPATH_NONE;
+    if(node != JPATH_NONE)
+    {
+        const size_t child = jpaths_child(b->ctx.projection, node, key, length);
+        if(child == JPATH_NONE) return JSON_EVENT_SKIP; // not wanted, the parser skips its value without any events
+        if(!jpaths_ends(b->ctx.projection, child)) b->item_node = child;
+        b->containers_only = b->item_node != JPATH_NONE;
+    }
+    b->key_flags = 0;
+    b->key = jctx_key(&b->ctx, key, length, &b->key_flags);
+    return b->key != NULL ? JSON_SUCCESS : JSON_FAILURE;
+}
+
+static int builder_string(void* user, const char* string, size_t length)
+{
+    jbuilder* b = user;
+    if(builder_drops_scalar(b)) return JSON_SUCCESS;
+    char* copy = jctx_strndup(&b->ctx, string, length);
+    if(copy == NULL) return JSON_FAILURE;
+    jvalue* value = builder_place(b);
+    if(value == NULL)
+    {
+        if(b->ctx.arena == NULL) jfree(copy);
+        return JSON_FAILURE;
+    }
+    value->type = JSON_STRING;
+    value->string = copy;
+    return JSON_SUCCESS;
+}
+
+static int builder_number(void* user, double number, int64_t integer, int is_integer)
+{
+    if(builder_drops_scalar(user)) return JSON_SUCCESS;
+    jvalue* value = builder_place(user);
+    if(value == NULL) return JSON_FAILURE;
+    value->type = JSON_NUMBER;
+    value->number = number;
+    value->integer = integer;
+    if(is_integer) value->flags |= JSON_FLAG_INTEGER;
+    return JSON_SUCCESS;
+}
+
+static int builder_boolean(void* user, int boolean)
+{
+    if(builder_drops_scalar(user)) return JSON_SUCCESS;
+    jvalue* value = builder_place(user);
+    if(value == NULL) return JSON_FAILURE;
+    value->type = JSON_BOOL;
+    value->boolean = boolean;
+    return JSON_SUCCESS;
+}
+
+static int builder_null(void* user)
+{
+    if(builder_drops_scalar(user)) return JSON_SUCCESS;
+    jvalue* value = builder_place(user);
+    if(value == NULL) return JSON_FAILURE;
+    value->type = JSON_NULL;
+    return JSON_SUCCESS;
+}
+
+static const jevents builder_events = {
+    .start_object = builder_start_object,
+    .end_object = builder_end,
+    .start_array = builder_start_array,
+    .end_array = builder_end,
+    .key = builder_key,
+    .string = builder_string,
+    .number = builder_number,
+    .boolean = builder_boolean,
+    .null = builder_null
+};
+
+// PARSER
+
+struct jparser {
+    const jevents* events;
+    void* user;
+    int expect;
+    unsigned char* stack; // JSON_OBJECT or JSON_ARRAY for every open container
+    size_t depth;
+    size_t stack_capacity;
+    size_t max_depth;
+    int lex;
+    int string_is_key;
+    int escape; // previous chunk ended on a backslash inside a string
+    int string_escaped; // the current string has escapes, so it has to be decoded once it's complete
+    int validate_utf8; // JSON_PARSE_VALIDATE_UTF8
+    const char* literal; // rest of the literal being matched
+    int literal_type; // JSON_BOOL (with literal_value) or JSON_NULL
+    int literal_value;
+    char* token; // start of a token cut off by the end of the previous chunk(s)
+    size_t token_length;
+    size_t token_capacity;
+    int failed;
+    int stopped; // a callback asked to stop, everything after is ignored
+    int skipping; // a callback asked to skip a value, no events until it's over
+    size_t skip_depth; // depth at which the skipped value ends
+    jbuilder builder; // only used when building a tree
+};
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static int is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static int append_token(jparser* p, const char* data, size_t length)
+{
+    if(p->token_length + length + 1 > p->token_capacity)
+    {
+        size_t capacity = p->token_capacity ? p->token_capacity : JPUSH_INITIAL_TOKEN;
+        while(p->token_length + length + 1 > capacity) capacity *= 2;
+        char* more = jrealloc(p->token, capacity);
+        if(more == NULL) return JSON_FAILURE;
+        p->token = more;
+        p->token_capacity = capacity;
+    }
+    memcpy(p->token + p->token_length, data, length);
+    p->token_length += length;
+    p->token[p->token_length] = '\0';
+    return JSON_SUCCESS;
+}
+
+static int push_container(jparser* p, unsigned char type)
+{
+    if(p->depth >= p->max_depth) return JSON_FAILURE;
+    if(p->depth == p->stack_capacity)
+    {
+        const size_t capacity = p->stack_capacity ? p->stack_capacity * 2 : JPUSH_INITIAL_STACK;
+        unsigned char* more = jrealloc(p->stack, capacity);
+        if(more == NULL) return JSON_FAILURE;
+        p->stack = more;
+        p->stack_capacity = capacity;
+    }
+    p->stack[p->depth++] = type;
+    return JSON_SUCCESS;
+}
+
+// call an event callback, unless it isn't set or a value is being skipped
+#define EMIT(p, callback, ...) ((p)->skipping || (p)->events->callback == NULL ? JSON_SUCCESS : (p)->events->callback((p)->user, ##__VA_ARGS__))
+
+// act on what a callback returned, skip_depth is where the value the callback was about ends (if it can be skipped)
+static void handle_event(jparser* p, int result, int can_skip, size_t skip_depth)
+{
+    if(result == JSON_SUCCESS) return;
+    if(result == JSON_EVENT_STOP) p->stopped = 1;
+    else if(result == JSON_EVENT_SKIP)
+    {
+        if(!can_skip) return; // nothing to skip, same as carrying on
+        p->skipping = 1;
+        p->skip_depth = skip_depth;
+    }
+    else p->failed = 1;
+}
+
+// a value just ended, figure out what comes next
+static void value_done(jparser* p)
+{
+    if(p->skipping && p->depth == p->skip_depth) p->skipping = 0;
+    p->expect = p->depth == 0 ? EXPECT_END : EXPECT_COMMA_OR_CLOSE;
+}
+
+static int expects_value(const jparser* p)
+{
+    return p->expect == EXPECT_VALUE || p->expect == EXPECT_VALUE_OR_CLOSE;
+}
+
+// finish a number whose text is text[0, length), followed by something that isn't part of a number
+static int emit_number(jparser* p, const char* text, size_t length)
+{
+    const char* end;
+    double number;
+    int64_t integer;
+    int is_integer;
+    if(jnumber_parse(text, &end, &number, &integer, &is_integer) || (size_t)(end - text) != length) return JSON_FAILURE;
+    handle_event(p, EMIT(p, number, number, integer, is_integer), 0, 0);
+    p->lex = LEX_NONE;
+    value_done(p);
+    return JSON_SUCCESS;
+}
+
+// consume string body bytes from data[i], returns the index after whatever was consumed
+static size_t continue_string(jparser* p, const char* data, size_t i, size_t length)
+{
+    const size_t start = i;
+    while(i < length)
+    {
+        if(p->escape) // escaped character, whatever it is
+        {
+            p->escape = 0;
+            i++;
+            continue;
+        }
+        i = jscan_string_end(data + i, data + length) - data;
+        if(i == length || data[i] == '"') break;
+        if(data[i] == '\\') p->escape = p->string_escaped = 1;
+        i++;
+    }
+    if(i == length) // string continues in the next chunk
+    {
+        if(append_token(p, data + start, length - start)) p->failed = 1;
+        return length;
+    }
+    const char* string = data + start;
+    size_t string_length = i - start;
+    if(p->token_length > 0) // glue the part from earlier chunks together with this one
+    {
+        if(append_token(p, data + start, i - start))
+        {
+            p->failed = 1;
+            return length;
+        }
+        string = p->token;
+        string_length = p->token_length;
+    }
+    if(p->validate_utf8 && jscan_utf8(string, string + string_length) != string + string_length)
+    {
+        p->failed = 1;
+        return length;
+    }
+    if(p->string_escaped) // decode in the token buffer (the chunk is read-only)
+    {
+        if(p->token_length == 0 && append_token(p, string, string_length))
+        {
+            p->failed = 1;
+            return length;
+        }
+        string = p->token;
+        string_length = jstring_unescape(p->token, p->token, p->token + p->token_length);
+        p->string_escaped = 0;
+        if(string_length == JSTRING_INVALID)
+        {
+            p->failed = 1;
+            return length;
+        }
+    }
+    if(p->string_is_key) handle_event(p, EMIT(p, key, string, string_length), 1, p->depth); // skipping a key skips its value
+    else handle_event(p, EMIT(p, string, string, string_length), 0, 0);
+    p->token_length = 0;
+    p->lex = LEX_NONE;
+    if(p->string_is_key) p->expect = EXPECT_COLON;
+    else value_done(p);
+    return i + 1; // past the closing quote
+}
+
+static size_t continue_number(jparser* p, const char* data, size_t i, size_t length)
+{
+    const size_t start = i;
+    while(i < length && is_number_char(data[i])) i++;
+    if(i == length) // might continue in the next chunk (or end at finish)
+    {
+        if(append_token(p, data + start, length - start)) p->failed = 1;
+        return length;
+    }
+    int result;
+    if(p->token_length > 0)
+    {
+        result = append_token(p, data + start, i - start) || emit_number(p, p->token, p->token_length);
+        p->token_length = 0;
+    }
+    else result = emit_number(p, data + start, i - start); // data[i] isn't a number character, so the number parser stops there
+    if(result) p->failed = 1;
+    return i; // whatever ended the number is the next token
+}
+
+static size_t continue_literal(jparser* p, const char* data, size_t i, size_t length)
+{
+    for(; i < length && *p->literal != '\0'; i++, p->literal++)
+    {
+        if(data[i] != *p->literal)
+        {
+            p->failed = 1;
+            return length;
+        }
+    }
+    if(*p->literal != '\0') return length; // rest of the literal is in the next chunk
+    if(p->literal_type == JSON_NULL) handle_event(p, EMIT(p, null), 0, 0);
+    else handle_event(p, EMIT(p, boolean, p->literal_value), 0, 0);
+    p->lex = LEX_NONE;
+    value_done(p);
+    return i;
+}
+
+int jparser_feed(jparser* p, const char* chunk, size_t length)
+{
+    if(p == NULL || p->failed) return JSON_FAILURE;
+    size_t i = 0;
+    while(i < length && !p->failed && !p->stopped)
+    {
+        switch(p->lex)
+        {
+            case LEX_STRING:
+                i = continue_string(p, chunk, i, length);
+                continue;
+            case LEX_NUMBER:
+                i = continue_number(p, chunk, i, length);
+                continue;
+            case LEX_LITERAL:
+                i = continue_literal(p, chunk, i, length);
+                continue;
+            default:
+                break;
+        }
+        const char c = chunk[i];
+        if(is_space(c))
+        {
+            i++;
+            continue;
+        }
+        switch(c)
+        {
+            case '{':
+            case '[':
+                if(!expects_value(p) || push_container(p, c == '{' ? JSON_OBJECT : JSON_ARRAY)) p->failed = 1;
+                else if(c == '{')
+                {
+                    handle_event(p, EMIT(p, start_object), 1, p->depth - 1);
+                    p->expect = EXPECT_KEY_OR_CLOSE;
+                }
+                else
+                {
+                    handle_event(p, EMIT(p, start_array), 1, p->depth - 1);
+                    p->expect = EXPECT_VALUE_OR_CLOSE;
+                }
+                i++;
+                break;
+
+            case '}':
+            case ']':
+            {
+                const unsigned char type = c == '}' ? JSON_OBJECT : JSON_ARRAY;
+                const int empty_close = type == JSON_OBJECT ? p->expect == EXPECT_KEY_OR_CLOSE : p->expect == EXPECT_VALUE_OR_CLOSE;
+                if(p->depth == 0 || p->stack[p->depth - 1] != type || !(empty_close || p->expect == EXPECT_COMMA_OR_CLOSE))
+                {
+                    p->failed = 1;
+                    break;
+                }
+                p->depth--;
+                handle_event(p, type == JSON_OBJECT ? EMIT(p, end_object) : EMIT(p, end_array), 0, 0);
+                value_done(p);
+                i++;
+                break;
+            }
+
+            case ',':
+                if(p->expect != EXPECT_COMMA_OR_CLOSE)
+                {
+                    p->failed = 1;
+                    break;
+                }
+                p->expect = p->stack[p->depth - 1] == JSON_OBJECT ? EXPECT_KEY : EXPECT_VALUE;
+                i++;
+                break;
+
+            case ':':
+                if(p->expect != EXPECT_COLON) p->failed = 1;
+                p->expect = EXPECT_VALUE;
+                i++;
+                break;
+
+            case '"':
+                p->string_is_key = p->expect == EXPECT_KEY || p->expect == EXPECT_KEY_OR_CLOSE;
+                if(!p->string_is_key && !expects_value(p)) p->failed = 1;
+                p->lex = LEX_STRING;
+                i++;
+                break;
+
+            case 't':
+            case 'f':
+            case 'n':
+                if(!expects_value(p)) p->failed = 1;
+                p->lex = LEX_LITERAL;
+                p->literal = c == 't' ? "rue" : c == 'f' ? "alse" : "ull";
+                p->literal_type = c == 'n' ? JSON_NULL : JSON_BOOL;
+                p->literal_value = c == 't';
+                i++;
+                break;
+
+            default:
+                if(!expects_value(p) || !(c == '-' || (c >= '0' && c <= '9'))) p->failed = 1;
+                p->lex = LEX_NUMBER;
+                break;
+        }
+    }
+    return p->failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+int jparser_finish(jparser* p)
+{
+    if(p == NULL || p->failed) return JSON_FAILURE;
+    if(p->stopped) return JSON_SUCCESS;
+    if(p->lex == LEX_NUMBER) // a top level number only ends with the input
+    {
+        if(emit_number(p, p->token, p->token_length) || p->failed)
+        {
+            p->failed = 1;
+            return JSON_FAILURE;
+        }
+        p->token_length = 0;
+        if(p->stopped) return JSON_SUCCESS;
+    }
+    if(p->lex != LEX_NONE || p->expect != EXPECT_END) // cut off in the middle of something
+    {
+        p->failed = 1;
+        return JSON_FAILURE;
+    }
+    return JSON_SUCCESS;
+}
+
+jparser* jparser_create_events(const jevents* events, void* user)
+{
+    jparser* p = jcalloc(sizeof(jparser));
+    if(p == NULL) return NULL;
+    p->events = events;
+    p->user = user;
+    p->expect = EXPECT_VALUE;
+    // events only need a byte per level, but whatever they feed (a tape, a tree) has to stop somewhere too
+    p->max_depth = JSON_MAX_DEPTH;
+    return p;
+}
+
+int json_parse_events(const char* text, const jevents* events, void* user)
+{
+    return json_parse_events_opts(text, events, user, NULL);
+}
+
+int json_parse_events_opts(const char* text, const jevents* events, void* user, const jparse_options* opts)
+{
+    if(text == NULL || events == NULL) return JSON_FAILURE;
+    jparser* p = jparser_create_events(events, user);
+    if(p == NULL) return JSON_FAILURE;
+    if(opts != NULL)
+    {
+        if(opts->max_depth != 0) p->max_depth = opts->max_depth;
+        p->validate_utf8 = (opts->flags & JSON_PARSE_VALIDATE_UTF8) != 0;
+    }
+    // the whole input is one chunk, so strings are handed to the callbacks straight out of text
+    // and the only memory used is the stack of open containers
+    const int result = jparser_feed(p, text, strlen(text)) || jparser_finish(p);
+    jparser_destroy(p);
+    return result ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+jparser* jparser_create(jvalue* empty, const jparse_options* opts)
+{
+    if(empty == NULL) return NULL;
+    jparser* p = jparser_create_events(&builder_events, NULL);
+    if(p == NULL) return NULL;
+    p->user = &p->builder;
+    p->builder.root = empty;
+    p->builder.item_node = JPATH_NONE;
+    if(opts != NULL)
+    {
+        if(opts->max_depth != 0) p->max_depth = opts->max_depth;
+        p->builder.ctx.arena = opts->arena;
+        p->builder.ctx.flags = opts->flags & ~(JSON_PARSE_INSITU | JSON_PARSE_LAZY); // chunks come and go, so nothing can point into them
+        p->validate_utf8 = (opts->flags & JSON_PARSE_VALIDATE_UTF8) != 0;
+        p->builder.ctx.intern = opts->intern;
+        p->builder.ctx.intern_counts = &p->builder.intern_counts;
+        p->builder.ctx.projection = opts->projection;
+        if(opts->projection != NULL && !jpaths_ends(opts->projection, 0)) p->builder.item_node = 0; // "" wants everything
+    }
+    return p;
+}
+
+void jparser_destroy(jparser* p)
+{
+    if(p == NULL) return;
+    builder_drop_key(&p->builder); // a key that never got its value
+    jintern_flush(p->builder.ctx.intern, &p->builder.intern_counts);
+    jfree(p->builder.frames);
+    jfree(p->stack);
+    jfree(p->token);
+    jfree(p);
+}
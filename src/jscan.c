@@ -0,0 +1,427 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define JSCAN_X86 1
+#endif
+
+// structural scanning: find the next interesting byte 16 (SSE2) or 32 (AVX2) bytes at a time
+// every scan is bounded by end, and vector loads are always aligned - an aligned block that holds at least one byte
+// before end never crosses into another page, so it can't fault even when it runs past end (bytes before the cursor
+// and from end on are simply masked out, or clamped away)
+// ASan doesn't know that, hence JSCAN_NO_ASAN on the vector paths
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define JSCAN_ASAN 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__) || defined(JSCAN_ASAN)
+#define JSCAN_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define JSCAN_NO_ASAN
+#endif
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static int is_structural(char c)
+{
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':' || c == '"' || c == '\0';
+}
+
+// SCALAR
+
+static const char* skip_space_scalar(const char* p, const char* end)
+{
+    while(p < end && is_space(*p)) p++;
+    return p;
+}
+
+static const char* string_end_scalar(const char* p, const char* end)
+{
+    while(p < end && *p != '"' && *p != '\\' && *p != '\0') p++;
+    return p;
+}
+
+static const char* structural_scalar(const char* p, const char* end)
+{
+    while(p < end && !is_structural(*p)) p++;
+    return p;
+}
+
+static const char* escape_scalar(const char* p, const char* end)
+{
+    while(p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) p++;
+    return p;
+}
+
+// check the one utf-8 sequence starting at the (non-ascii) byte p
+// returns its length, or 0 if it's malformed (stray continuation, overlong, surrogate, past U+10FFFF, or cut off by end)
+static size_t utf8_sequence(const char* p, const char* end)
+{
+    const unsigned char lead = (unsigned char)*p;
+    size_t length;
+    uint32_t code;
+    uint32_t min;
+    if(lead >= 0xc2 && lead <= 0xdf) { length = 2; code = lead & 0x1f; min = 0x80; }
+    else if((lead & 0xf0) == 0xe0) { length = 3; code = lead & 0x0f; min = 0x800; }
+    else if(lead >= 0xf0 && lead <= 0xf4) { length = 4; code = lead & 0x07; min = 0x10000; }
+    else return 0;
+    if((size_t)(end - p) < length) return 0;
+    for(size_t i = 1; i < length; i++)
+    {
+        if(((unsigned char)p[i] & 0xc0) != 0x80) return 0;
+        code = code << 6 | ((unsigned char)p[i] & 0x3f);
+    }
+    if(code < min || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff)) return 0;
+    return length;
+}
+
+static const char* utf8_scalar(const char* p, const char* end)
+{
+    while(p < end)
+    {
+        uint64_t word;
+        if(end - p >= 8 && (memcpy(&word, p, 8), (word & 0x8080808080808080ull) == 0)) // 8 ascii bytes at once
+        {
+            p += 8;
+            continue;
+        }
+        if((unsigned char)*p < 0x80)
+        {
+            p++;
+            continue;
+        }
+        const size_t length = utf8_sequence(p, end);
+        if(length == 0) return p;
+        p += length;
+    }
+    return end;
+}
+
+#ifdef JSCAN_X86
+
+// SSE2 (always there on x86-64)
+
+static inline unsigned space_mask_sse2(__m128i v)
+{
+    const __m128i spaces = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+    return (unsigned)_mm_movemask_epi8(spaces);
+}
+
+static inline unsigned string_mask_sse2(__m128i v)
+{
+    const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                      _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return (unsigned)_mm_movemask_epi8(hits);
+}
+
+static inline unsigned structural_mask_sse2(__m128i v)
+{
+    // { and [ are 0x7b and 0x5b, } and ] are 0x7d and 0x5d: clearing bit 5 folds each pair together
+    const __m128i folded = _mm_and_si128(v, _mm_set1_epi8((char)~0x20));
+    const __m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('[')), _mm_cmpeq_epi8(folded, _mm_set1_epi8(']')));
+    const __m128i punctuation = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')), _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))),
+                                             _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(brackets, punctuation));
+}
+
+static inline unsigned escape_mask_sse2(__m128i v)
+{
+    // min(v, 0x1f) == v exactly for the control characters (unsigned compare, so utf-8 bytes don't count)
+    const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+    const __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))), controls);
+    return (unsigned)_mm_movemask_epi8(hits);
+}
+
+// the scanners only differ in the mask they compute, and in whether a hit is a set or a clear bit
+#define SSE2_SCAN(name, mask_fn, invert) \
+    JSCAN_NO_ASAN static const char* name(const char* p, const char* end) \
+    { \
+        if(p >= end) return end; \
+        const unsigned offset = (unsigned)((uintptr_t)p & 15); \
+        const char* block = p - offset; \
+        unsigned mask = (mask_fn(_mm_load_si128((const __m128i*)block)) ^ (invert)) & (0xffffu << offset); \
+        while(mask == 0) \
+        { \
+            block += 16; \
+            if(block >= end) return end; \
+            mask = mask_fn(_mm_load_si128((const __m128i*)block)) ^ (invert); \
+        } \
+        const char* found = block + __builtin_ctz(mask); \
+        return found < end ? found : end; \
+    }
+
+SSE2_SCAN(skip_space_sse2, space_mask_sse2, 0xffffu)
+SSE2_SCAN(string_end_sse2, string_mask_sse2, 0)
+SSE2_SCAN(structural_sse2, structural_mask_sse2, 0)
+SSE2_SCAN(escape_sse2, escape_mask_sse2, 0)
+
+static inline unsigned high_mask_sse2(__m128i v)
+{
+    return (unsigned)_mm_movemask_epi8(v);
+}
+
+SSE2_SCAN(non_ascii_sse2, high_mask_sse2, 0)
+
+// SSE2 has no byte shuffle for the lookup tables, so only the ascii runs are vectorized and every multibyte sequence is checked on its own
+static const char* utf8_sse2(const char* p, const char* end)
+{
+    while(1)
+    {
+        p = non_ascii_sse2(p, end);
+        if(p == end) return end;
+        const size_t length = utf8_sequence(p, end);
+        if(length == 0) return p;
+        p += length;
+    }
+}
+
+// AVX2 (checked for at runtime)
+
+__attribute__((target("avx2"))) static inline uint32_t space_mask_avx2(__m256i v)
+{
+    const __m256i spaces = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+    return (uint32_t)_mm256_movemask_epi8(spaces);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t string_mask_avx2(__m256i v)
+{
+    const __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                                         _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    return (uint32_t)_mm256_movemask_epi8(hits);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t structural_mask_avx2(__m256i v)
+{
+    const __m256i folded = _mm256_and_si256(v, _mm256_set1_epi8((char)~0x20));
+    const __m256i brackets = _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8(']')));
+    const __m256i punctuation = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))),
+                                                _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(brackets, punctuation));
+}
+
+__attribute__((target("avx2"))) static inline uint32_t escape_mask_avx2(__m256i v)
+{
+    const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+    const __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))), controls);
+    return (uint32_t)_mm256_movemask_epi8(hits);
+}
+
+#define AVX2_SCAN(name, mask_fn, invert) \
+    JSCAN_NO_ASAN __attribute__((target("avx2"))) static const char* name(const char* p, const char* end) \
+    { \
+        if(p >= end) return end; \
+        const unsigned offset = (unsigned)((uintptr_t)p & 31); \
+        const char* block = p - offset; \
+        uint32_t mask = (mask_fn(_mm256_load_si256((const __m256i*)block)) ^ (invert)) & (0xffffffffu << offset); \
+        while(mask == 0) \
+        { \
+            block += 32; \
+            if(block >= end) return end; \
+            mask = mask_fn(_mm256_load_si256((const __m256i*)block)) ^ (invert); \
+        } \
+        const char* found = block + __builtin_ctz(mask); \
+        return found < end ? found : end; \
+    }
+
+AVX2_SCAN(skip_space_avx2, space_mask_avx2, 0xffffffffu)
+AVX2_SCAN(string_end_avx2, string_mask_avx2, 0)
+AVX2_SCAN(structural_avx2, structural_mask_avx2, 0)
+AVX2_SCAN(escape_avx2, escape_mask_avx2, 0)
+
+// utf-8 validation after Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte":
+// three 16-entry tables, indexed by the high nibble of the previous byte, its low nibble and the high nibble of the current byte,
+// each give the set of errors that byte pair could be part of - a pair is bad when all three tables agree on some error
+// what the pairs can't see (continuations that 3 and 4 byte sequences need further out) is checked with saturating subtractions
+#define U8_TOO_SHORT (1 << 0) // lead byte not followed by a continuation
+#define U8_TOO_LONG (1 << 1) // continuation without a lead byte
+#define U8_OVERLONG_3 (1 << 2)
+#define U8_TOO_LARGE (1 << 3) // past U+10FFFF
+#define U8_SURROGATE (1 << 4)
+#define U8_OVERLONG_2 (1 << 5)
+#define U8_TOO_LARGE_1000 (1 << 6)
+#define U8_OVERLONG_4 (1 << 6)
+#define U8_TWO_CONTS (1 << 7) // two continuations in a row (fine if the byte before started a 3 or 4 byte sequence)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+#define U8_TABLE(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__) // same table in both lanes
+
+// the block shifted back by n bytes, with the end of prev shifted in
+#define U8_PREV(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+__attribute__((target("avx2"))) static inline __m256i utf8_block_errors(__m256i input, __m256i prev_input)
+{
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i prev1 = U8_PREV(input, prev_input, 1);
+    const __m256i byte_1_high = _mm256_shuffle_epi8(U8_TABLE(
+        U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, // ascii
+        U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, // continuation
+        U8_TOO_SHORT | U8_OVERLONG_2, // 1100
+        U8_TOO_SHORT, // 1101
+        U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE, // 1110
+        U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4 // 1111
+    ), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    const __m256i byte_1_low = _mm256_shuffle_epi8(U8_TABLE(
+        U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4, // 0000
+        U8_CARRY | U8_OVERLONG_2, // 0001
+        U8_CARRY, U8_CARRY, // 001x
+        U8_CARRY | U8_TOO_LARGE, // 0100
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, // 0101
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, // 011x
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, // 1000, 1001
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, // 1010, 1011
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, // 1100
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE, // 1101
+        U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000, U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 // 111x
+    ), _mm256_and_si256(prev1, nibble));
+    const __m256i byte_2_high = _mm256_shuffle_epi8(U8_TABLE(
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, // ascii
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE_1000 | U8_OVERLONG_4, // 1000
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE, // 1001
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE, // 101x
+        U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+        U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT // lead byte
+    ), _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    const __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+    // continuations two and three bytes after a 3/4 byte lead are required, and are exactly where U8_TWO_CONTS shows up
+    const __m256i third = _mm256_subs_epu8(U8_PREV(input, prev_input, 2), _mm256_set1_epi8((char)(0xe0 - 0x80)));
+    const __m256i fourth = _mm256_subs_epu8(U8_PREV(input, prev_input, 3), _mm256_set1_epi8((char)(0xf0 - 0x80)));
+    const __m256i required = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(required, special);
+}
+
+// bytes in the block that leave a sequence open at its end (a lead byte in the last three positions that needs more)
+__attribute__((target("avx2"))) static inline __m256i utf8_incomplete(__m256i input)
+{
+    const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t high_mask_avx2(__m256i v)
+{
+    return (uint32_t)_mm256_movemask_epi8(v);
+}
+
+AVX2_SCAN(non_ascii_avx2, high_mask_avx2, 0)
+
+// the leading ascii run (usually the whole string) is skipped with the aligned scanner, the rest goes through the tables
+// from there on, blocks are loaded unaligned, and only when they're entirely before end: the tail goes through a zero-padded copy
+// (the zeros are ascii, so a sequence cut off by end shows up as too short)
+// the tables only say whether a block is bad, so the exact offset comes from the scalar validator
+__attribute__((target("avx2"))) static const char* utf8_avx2(const char* p, const char* end)
+{
+    p = non_ascii_avx2(p, end);
+    if(p == end) return end;
+    const char* start = p; // everything before is ascii, so this is where a sequence starts
+    __m256i prev = _mm256_setzero_si256();
+    __m256i incomplete = _mm256_setzero_si256();
+    __m256i error = _mm256_setzero_si256();
+    for(; end - p >= 32; p += 32)
+    {
+        const __m256i input = _mm256_loadu_si256((const __m256i*)p);
+        if(_mm256_movemask_epi8(input) == 0) error = _mm256_or_si256(error, incomplete); // all ascii: only the block before can be wrong
+        else
+        {
+            error = _mm256_or_si256(error, utf8_block_errors(input, prev));
+            incomplete = utf8_incomplete(input);
+        }
+        prev = input;
+    }
+    // the tail: all ascii (the usual case for short strings) needs no tables
+    int tail_ascii = 1;
+    for(const char* q = p; q < end; q++) tail_ascii &= (unsigned char)*q < 0x80;
+    if(tail_ascii) error = _mm256_or_si256(error, incomplete);
+    else
+    {
+        _Alignas(32) char tail[32] = { 0 };
+        memcpy(tail, p, end - p);
+        const __m256i input = _mm256_load_si256((const __m256i*)tail);
+        error = _mm256_or_si256(error, utf8_block_errors(input, prev)); // there's always padding left after the tail to catch what it leaves open
+    }
+    if(_mm256_testz_si256(error, error)) return end;
+    return utf8_scalar(start, end);
+}
+
+#endif
+
+// DISPATCH
+
+typedef struct jscan_impl {
+    const char* (*skip_space)(const char* p, const char* end);
+    const char* (*string_end)(const char* p, const char* end);
+    const char* (*structural)(const char* p, const char* end);
+    const char* (*escape)(const char* p, const char* end);
+    const char* (*utf8)(const char* p, const char* end);
+} jscan_impl;
+
+static const jscan_impl implementations[] = {
+    [JSON_SIMD_SCALAR] = { skip_space_scalar, string_end_scalar, structural_scalar, escape_scalar, utf8_scalar },
+#ifdef JSCAN_X86
+    [JSON_SIMD_SSE2] = { skip_space_sse2, string_end_sse2, structural_sse2, escape_sse2, utf8_sse2 },
+    [JSON_SIMD_AVX2] = { skip_space_avx2, string_end_avx2, structural_avx2, escape_avx2, utf8_avx2 },
+#endif
+};
+
+static int best_level(void)
+{
+#ifdef JSCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return JSON_SIMD_AVX2;
+    return JSON_SIMD_SSE2;
+#else
+    return JSON_SIMD_SCALAR;
+#endif
+}
+
+static const jscan_impl* active = &implementations[JSON_SIMD_SCALAR];
+
+// pick the best implementation once, when the library is loaded
+__attribute__((constructor)) static void jscan_init(void)
+{
+    active = &implementations[best_level()];
+}
+
+int json_set_simd_level(int level)
+{
+    const int best = best_level();
+    if(level < JSON_SIMD_SCALAR) level = JSON_SIMD_SCALAR;
+    if(level > best) level = best;
+    active = &implementations[level];
+    return level;
+}
+
+const char* jscan_skip_space(const char* p, const char* end)
+{
+    if(p >= end || !is_space(*p)) return p; // most of the time there's no whitespace at all, don't bother with vectors
+    return active->skip_space(p + 1, end);
+}
+
+const char* jscan_string_end(const char* p, const char* end)
+{
+    return active->string_end(p, end);
+}
+
+const char* jscan_structural(const char* p, const char* end)
+{
+    return active->structural(p, end);
+}
+
+const char* jscan_escape(const char* p, const char* end)
+{
+    return active->escape(p, end);
+}
+
+const char* jscan_utf8(const char* p, const char* end)
+{
+    return active->utf8(p, end);
+}
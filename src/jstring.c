@@ -0,0 +1,109 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <string.h>
+
+// escape decoding: the runs between backslashes are found with the vector scanner and moved in bulk,
+// only the escapes themselves go through the switch below
+// strings without any escapes never get here, the parsers copy (or borrow) them as they are
+
+static int hex_digit(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// read the 4 hex digits of a \u escape at p
+// returns the code unit, or -1 if they aren't there
+static long hex4(const char* p, const char* end)
+{
+    if(end - p < 4) return -1;
+    long unit = 0;
+    for(int i = 0; i < 4; i++)
+    {
+        const int digit = hex_digit(p[i]);
+        if(digit < 0) return -1;
+        unit = unit << 4 | digit;
+    }
+    return unit;
+}
+
+static char* put_utf8(char* out, unsigned long code)
+{
+    if(code < 0x80)
+    {
+        *out++ = (char)code;
+    }
+    else if(code < 0x800)
+    {
+        *out++ = (char)(0xc0 | code >> 6);
+        *out++ = (char)(0x80 | (code & 0x3f));
+    }
+    else if(code < 0x10000)
+    {
+        *out++ = (char)(0xe0 | code >> 12);
+        *out++ = (char)(0x80 | (code >> 6 & 0x3f));
+        *out++ = (char)(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        *out++ = (char)(0xf0 | code >> 18);
+        *out++ = (char)(0x80 | (code >> 12 & 0x3f));
+        *out++ = (char)(0x80 | (code >> 6 & 0x3f));
+        *out++ = (char)(0x80 | (code & 0x3f));
+    }
+    return out;
+}
+
+size_t jstring_unescape(char* out, const char* p, const char* end)
+{
+    char* o = out;
+    while(1)
+    {
+        // everything up to the next backslash is copied as is (a quote or null can't be in a string body, but they'd just be copied too)
+        const char* run = p;
+        while(run < end && *run != '\\')
+        {
+            run = jscan_string_end(run, end);
+            if(run < end && *run != '\\') run++;
+        }
+        if(o != p) memmove(o, p, run - p);
+        o += run - p;
+        p = run;
+        if(p == end) return o - out;
+        if(++p == end) return JSTRING_INVALID; // backslash with nothing after it
+        switch(*p++)
+        {
+            case '"': *o++ = '"'; break;
+            case '\\': *o++ = '\\'; break;
+            case '/': *o++ = '/'; break;
+            case 'b': *o++ = '\b'; break;
+            case 'f': *o++ = '\f'; break;
+            case 'n': *o++ = '\n'; break;
+            case 'r': *o++ = '\r'; break;
+            case 't': *o++ = '\t'; break;
+            case 'u':
+            {
+                long unit = hex4(p, end);
+                if(unit < 0) return JSTRING_INVALID;
+                p += 4;
+                unsigned long code = (unsigned long)unit;
+                if(unit >= 0xdc00 && unit <= 0xdfff) return JSTRING_INVALID; // low surrogate without a high one
+                if(unit >= 0xd800 && unit <= 0xdbff) // high surrogate, has to be followed by an escaped low one
+                {
+                    if(end - p < 2 || p[0] != '\\' || p[1] != 'u') return JSTRING_INVALID;
+                    const long low = hex4(p + 2, end);
+                    if(low < 0xdc00 || low > 0xdfff) return JSTRING_INVALID;
+                    p += 6;
+                    code = 0x10000 + ((unit - 0xd800) << 10 | (low - 0xdc00));
+                }
+                o = put_utf8(o, code);
+                break;
+            }
+            default:
+                return JSTRING_INVALID;
+        }
+    }
+}
@@ -0,0 +1,637 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a tape is a whole document flattened into one array of 64-bit entries, in document order
+// each entry is an 8-bit tag and a 56-bit payload:
+//   { and [   payload is the index just past the matching close (low 32 bits) and the number of children (next 24 bits)
+//   } and ]   payload is the index of the matching open
+//   "         payload is the offset of the string in the string buffer, where it sits behind its 32-bit length
+//   l and d   an integer or a double, stored whole in the next entry (payload bit 0 on an l marks -0)
+//   t f n     true, false, null
+// object members are a key (a " entry) followed by the value
+// so skipping any value is one lookup, and nothing points anywhere but into the two buffers
+
+#define TAPE_OPEN_OBJECT '{'
+#define TAPE_CLOSE_OBJECT '}'
+#define TAPE_OPEN_ARRAY '['
+#define TAPE_CLOSE_ARRAY ']'
+#define TAPE_STRING '"'
+#define TAPE_INTEGER 'l'
+#define TAPE_DOUBLE 'd'
+#define TAPE_TRUE 't'
+#define TAPE_FALSE 'f'
+#define TAPE_NULL 'n'
+
+#define TAPE_PAYLOAD_MASK ((1ULL << 56) - 1)
+#define TAPE_COUNT_MAX 0xffffffULL // counts that don't fit are saturated, and recounted when asked for
+#define TAPE_INITIAL 64
+
+struct jtape {
+    uint64_t* entries;
+    size_t length;
+    size_t capacity;
+    char* strings;
+    size_t strings_length;
+    size_t strings_capacity;
+    size_t* open; // containers still open while building
+    size_t depth;
+    size_t open_capacity;
+};
+
+static inline int tag_of(uint64_t entry)
+{
+    return (int)(entry >> 56);
+}
+
+static inline uint64_t payload_of(uint64_t entry)
+{
+    return entry & TAPE_PAYLOAD_MASK;
+}
+
+// BUILDING
+
+static int append(jtape* t, int tag, uint64_t payload)
+{
+    if(t->length == t->capacity)
+    {
+        const size_t capacity = t->capacity ? t->capacity * 2 : TAPE_INITIAL;
+        uint64_t* more = jrealloc(t->entries, capacity * sizeof(uint64_t));
+        if(more == NULL) return JSON_FAILURE;
+        t->entries = more;
+        t->capacity = capacity;
+    }
+    t->entries[t->length++] = ((uint64_t)tag << 56) | payload;
+    return JSON_SUCCESS;
+}
+
+static int append_string(jtape* t, const char* string, size_t length)
+{
+    if(length > UINT32_MAX) return JSON_FAILURE;
+    const size_t needed = t->strings_length + sizeof(uint32_t) + length + 1;
+    if(needed > t->strings_capacity)
+    {
+        size_t capacity = t->strings_capacity ? t->strings_capacity : TAPE_INITIAL * 8;
+        while(capacity < needed) capacity *= 2;
+        char* more = jrealloc(t->strings, capacity);
+        if(more == NULL) return JSON_FAILURE;
+        t->strings = more;
+        t->strings_capacity = capacity;
+    }
+    const size_t offset = t->strings_length;
+    const uint32_t length32 = (uint32_t)length;
+    memcpy(t->strings + offset, &length32, sizeof(uint32_t));
+    memcpy(t->strings + offset + sizeof(uint32_t), string, length);
+    t->strings[offset + sizeof(uint32_t) + length] = '\0';
+    t->strings_length = needed;
+    return append(t, TAPE_STRING, offset);
+}
+
+static int open_container(jtape* t, int tag)
+{
+    if(t->depth == t->open_capacity)
+    {
+        const size_t capacity = t->open_capacity ? t->open_capacity * 2 : TAPE_INITIAL;
+        size_t* more = jrealloc(t->open, capacity * sizeof(size_t));
+        if(more == NULL) return JSON_FAILURE;
+        t->open = more;
+        t->open_capacity = capacity;
+    }
+    t->open[t->depth++] = t->length;
+    return append(t, tag, 0); // patched when the container closes
+}
+
+// close the innermost container, counting its children on the way (skipping over each one is O(1))
+static int close_container(jtape* t, int tag)
+{
+    const size_t start = t->open[--t->depth];
+    uint64_t count = 0;
+    for(size_t i = start + 1; i < t->length; count++)
+    {
+        const uint64_t entry = t->entries[i];
+        switch(tag_of(entry))
+        {
+            case TAPE_OPEN_OBJECT:
+            case TAPE_OPEN_ARRAY:
+                i = (size_t)(payload_of(entry) & 0xffffffffULL);
+                break;
+            case TAPE_INTEGER:
+            case TAPE_DOUBLE:
+                i += 2;
+                break;
+            default:
+                i++;
+                break;
+        }
+    }
+    if(tag == TAPE_CLOSE_OBJECT) count /= 2; // keys and values
+    if(count > TAPE_COUNT_MAX) count = TAPE_COUNT_MAX;
+    if(t->length + 1 > UINT32_MAX) return JSON_FAILURE;
+    t->entries[start] |= (count << 32) | (uint64_t)(t->length + 1);
+    return append(t, tag, start);
+}
+
+static int append_number(jtape* t, double number, int64_t integer, int is_integer)
+{
+    uint64_t bits;
+    if(is_integer)
+    {
+        memcpy(&bits, &integer, sizeof(bits));
+        if(append(t, TAPE_INTEGER, signbit(number) && integer == 0)) return JSON_FAILURE;
+    }
+    else
+    {
+        memcpy(&bits, &number, sizeof(bits));
+        if(append(t, TAPE_DOUBLE, 0)) return JSON_FAILURE;
+    }
+    if(append(t, 0, 0)) return JSON_FAILURE; // the value goes in whole, tag bits and all
+    t->entries[t->length - 1] = bits;
+    return JSON_SUCCESS;
+}
+
+static int tape_start_object(void* user)
+{
+    return open_container(user, TAPE_OPEN_OBJECT);
+}
+
+static int tape_end_object(void* user)
+{
+    return close_container(user, TAPE_CLOSE_OBJECT);
+}
+
+static int tape_start_array(void* user)
+{
+    return open_container(user, TAPE_OPEN_ARRAY);
+}
+
+static int tape_end_array(void* user)
+{
+    return close_container(user, TAPE_CLOSE_ARRAY);
+}
+
+static int tape_string(void* user, const char* string, size_t length)
+{
+    return append_string(user, string, length);
+}
+
+static int tape_number(void* user, double number, int64_t integer, int is_integer)
+{
+    return append_number(user, number, integer, is_integer);
+}
+
+static int tape_boolean(void* user, int boolean)
+{
+    return append(user, boolean ? TAPE_TRUE : TAPE_FALSE, 0);
+}
+
+static int tape_null(void* user)
+{
+    return append(user, TAPE_NULL, 0);
+}
+
+static const jevents tape_events = {
+    .start_object = tape_start_object,
+    .end_object = tape_end_object,
+    .start_array = tape_start_array,
+    .end_array = tape_end_array,
+    .key = tape_string, // keys are just strings that happen to sit before a value
+    .string = tape_string,
+    .number = tape_number,
+    .boolean = tape_boolean,
+    .null = tape_null
+};
+
+// done building: drop the building stack and give back the slack
+static jtape* finish_tape(jtape* t)
+{
+    jfree(t->open);
+    t->open = NULL;
+    t->open_capacity = 0;
+    uint64_t* trimmed = jrealloc(t->entries, t->length * sizeof(uint64_t));
+    if(trimmed != NULL)
+    {
+        t->entries = trimmed;
+        t->capacity = t->length;
+    }
+    return t;
+}
+
+jtape* json_tape_parse(const char* text)
+{
+    jtape* t = jcalloc(sizeof(jtape));
+    if(t == NULL) return NULL;
+    if(json_parse_events(text, &tape_events, t))
+    {
+        json_tape_free(t);
+        return NULL;
+    }
+    return finish_tape(t);
+}
+
+// trees are walked with an explicit stack of open containers, like the writer does, so deep ones can't run out of C stack
+// (when flattening, the tape keeps its own stack of open entries too, the frames only track how far along each one is)
+#define TAPE_LOCAL_FRAMES 32 // frames on the C stack, deeper trees move to the heap
+
+typedef struct jtape_frame {
+    jvalue* value; // the container being walked
+    size_t index; // next member or element
+    size_t next; // converting back: the tape node it comes from (JSON_TAPE_NONE once there are no more)
+} jtape_frame;
+
+// make room for one more frame, moving off the C stack (local) the first time
+static jtape_frame* grow_frames(jtape_frame* frames, const jtape_frame* local, size_t* capacity)
+{
+    jtape_frame* more = frames == local ? jmalloc(*capacity * 2 * sizeof(jtape_frame))
+                                        : jrealloc(frames, *capacity * 2 * sizeof(jtape_frame));
+    if(more == NULL) return NULL;
+    if(frames == local) memcpy(more, local, *capacity * sizeof(jtape_frame));
+    *capacity *= 2;
+    return more;
+}
+
+// a scalar, a packed array or an empty container goes on the tape whole, anything else is opened (and opened set)
+static int from_one(jtape* t, const jvalue* val, int* opened)
+{
+    if((val->flags & JSON_FLAG_LAZY) && jparse_lazy((jvalue*)val)) return JSON_FAILURE;
+    if(val->flags & JSON_FLAG_PACKED) // straight from the numbers, without unpacking them
+    {
+        const int integers = (val->flags & JSON_FLAG_INTEGER) != 0;
+        if(open_container(t, TAPE_OPEN_ARRAY)) return JSON_FAILURE;
+        for(size_t i = 0; i < val->length; i++)
+        {
+            const int failed = integers ? append_number(t, (double)val->integers[i], val->integers[i], 1)
+                                        : append_number(t, val->numbers[i], 0, 0);
+            if(failed) return JSON_FAILURE;
+        }
+        return close_container(t, TAPE_CLOSE_ARRAY);
+    }
+    if(json_materialize((jvalue*)val)) return JSON_FAILURE;
+    switch(val->type)
+    {
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            if(open_container(t, val->type == JSON_OBJECT ? TAPE_OPEN_OBJECT : TAPE_OPEN_ARRAY)) return JSON_FAILURE;
+            if(val->length == 0) return close_container(t, val->type == JSON_OBJECT ? TAPE_CLOSE_OBJECT : TAPE_CLOSE_ARRAY);
+            *opened = 1;
+            return JSON_SUCCESS;
+        case JSON_STRING:
+            if(val->string == NULL) return JSON_FAILURE;
+            return append_string(t, val->string, strlen(val->string));
+        case JSON_NUMBER:
+            return append_number(t, val->number, val->integer, (val->flags & JSON_FLAG_INTEGER) != 0);
+        case JSON_BOOL:
+            return tape_boolean(t, val->boolean);
+        case JSON_NULL:
+            return tape_null(t);
+        default:
+            return JSON_FAILURE;
+    }
+}
+
+static int from_value(jtape* t, const jvalue* val)
+{
+    jtape_frame local[TAPE_LOCAL_FRAMES];
+    jtape_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = TAPE_LOCAL_FRAMES;
+    int failed = 0;
+    while(val != NULL && !failed)
+    {
+        if(depth == capacity) // room for one more, in case val gets opened
+        {
+            jtape_frame* more = grow_frames(frames, local, &capacity);
+            if(more == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            frames = more;
+        }
+        int opened = 0;
+        if(from_one(t, val, &opened))
+        {
+            failed = 1;
+            break;
+        }
+        if(opened) frames[depth++] = (jtape_frame){ .value = (jvalue*)val };
+        // on to the next member or element of the innermost container, closing the ones that are done
+        val = NULL;
+        while(depth > 0 && val == NULL && !failed)
+        {
+            jtape_frame* frame = &frames[depth - 1];
+            if(frame->index < frame->value->length)
+            {
+                if(frame->value->type == JSON_OBJECT)
+                {
+                    const jmember* m = &frame->value->members[frame->index];
+                    failed = m->key == NULL || append_string(t, m->key, strlen(m->key));
+                    val = &m->value;
+                }
+                else val = &frame->value->elements[frame->index];
+                frame->index++;
+            }
+            else
+            {
+                failed = close_container(t, frame->value->type == JSON_OBJECT ? TAPE_CLOSE_OBJECT : TAPE_CLOSE_ARRAY);
+                depth--;
+            }
+        }
+    }
+    if(frames != local) jfree(frames);
+    return failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+jtape* json_tape_from_value(const jvalue* val)
+{
+    if(val == NULL) return NULL;
+    jtape* t = jcalloc(sizeof(jtape));
+    if(t == NULL) return NULL;
+    if(from_value(t, val))
+    {
+        json_tape_free(t);
+        return NULL;
+    }
+    return finish_tape(t);
+}
+
+void json_tape_free(jtape* tape)
+{
+    if(tape == NULL) return;
+    jfree(tape->entries);
+    jfree(tape->strings);
+    jfree(tape->open);
+    jfree(tape);
+}
+
+// ACCESS
+
+static int valid_node(const jtape* tape, size_t node)
+{
+    if(tape == NULL || node >= tape->length) return 0;
+    const int tag = tag_of(tape->entries[node]);
+    return tag != TAPE_CLOSE_OBJECT && tag != TAPE_CLOSE_ARRAY;
+}
+
+int json_tape_type(const jtape* tape, size_t node)
+{
+    if(!valid_node(tape, node)) return -1;
+    switch(tag_of(tape->entries[node]))
+    {
+        case TAPE_OPEN_OBJECT: return JSON_OBJECT;
+        case TAPE_OPEN_ARRAY: return JSON_ARRAY;
+        case TAPE_STRING: return JSON_STRING;
+        case TAPE_INTEGER:
+        case TAPE_DOUBLE: return JSON_NUMBER;
+        case TAPE_TRUE:
+        case TAPE_FALSE: return JSON_BOOL;
+        default: return JSON_NULL;
+    }
+}
+
+size_t json_tape_skip(const jtape* tape, size_t node)
+{
+    if(!valid_node(tape, node)) return JSON_TAPE_NONE;
+    const uint64_t entry = tape->entries[node];
+    switch(tag_of(entry))
+    {
+        case TAPE_OPEN_OBJECT:
+        case TAPE_OPEN_ARRAY: return (size_t)(payload_of(entry) & 0xffffffffULL);
+        case TAPE_INTEGER:
+        case TAPE_DOUBLE: return node + 2;
+        default: return node + 1;
+    }
+}
+
+size_t json_tape_child(const jtape* tape, size_t node)
+{
+    const int type = json_tape_type(tape, node);
+    if(type != JSON_OBJECT && type != JSON_ARRAY) return JSON_TAPE_NONE;
+    return valid_node(tape, node + 1) ? node + 1 : JSON_TAPE_NONE;
+}
+
+size_t json_tape_sibling(const jtape* tape, size_t node)
+{
+    const size_t next = json_tape_skip(tape, node);
+    return next != JSON_TAPE_NONE && valid_node(tape, next) ? next : JSON_TAPE_NONE;
+}
+
+size_t json_tape_length(const jtape* tape, size_t node)
+{
+    const int type = json_tape_type(tape, node);
+    if(type != JSON_OBJECT && type != JSON_ARRAY) return 0;
+    const size_t count = (size_t)(payload_of(tape->entries[node]) >> 32);
+    if(count < TAPE_COUNT_MAX) return count;
+    size_t counted = 0; // saturated, walk it
+    for(size_t child = json_tape_child(tape, node); child != JSON_TAPE_NONE; child = json_tape_sibling(tape, child)) counted++;
+    return type == JSON_OBJECT ? counted / 2 : counted;
+}
+
+size_t json_tape_index(const jtape* tape, size_t array, size_t i)
+{
+    if(json_tape_type(tape, array) != JSON_ARRAY) return JSON_TAPE_NONE;
+    size_t child = json_tape_child(tape, array);
+    while(child != JSON_TAPE_NONE && i-- > 0) child = json_tape_sibling(tape, child);
+    return child;
+}
+
+size_t json_tape_find(const jtape* tape, size_t object, const char* key)
+{
+    if(key == NULL || json_tape_type(tape, object) != JSON_OBJECT) return JSON_TAPE_NONE;
+    const size_t length = strlen(key);
+    for(size_t k = json_tape_child(tape, object); k != JSON_TAPE_NONE; k = json_tape_sibling(tape, k + 1))
+    {
+        size_t key_length;
+        const char* candidate = json_tape_string(tape, k, &key_length);
+        if(key_length == length && memcmp(candidate, key, length) == 0) return k + 1;
+    }
+    return JSON_TAPE_NONE;
+}
+
+const char* json_tape_string(const jtape* tape, size_t node, size_t* length)
+{
+    if(json_tape_type(tape, node) != JSON_STRING) return NULL;
+    const size_t offset = (size_t)payload_of(tape->entries[node]);
+    if(length != NULL)
+    {
+        uint32_t length32;
+        memcpy(&length32, tape->strings + offset, sizeof(uint32_t));
+        *length = length32;
+    }
+    return tape->strings + offset + sizeof(uint32_t);
+}
+
+double json_tape_number(const jtape* tape, size_t node)
+{
+    if(json_tape_type(tape, node) != JSON_NUMBER) return 0;
+    const uint64_t entry = tape->entries[node];
+    const uint64_t bits = tape->entries[node + 1];
+    if(tag_of(entry) == TAPE_INTEGER)
+    {
+        int64_t integer;
+        memcpy(&integer, &bits, sizeof(integer));
+        return payload_of(entry) & 1 ? -0.0 : (double)integer;
+    }
+    double number;
+    memcpy(&number, &bits, sizeof(number));
+    return number;
+}
+
+int json_tape_integer(const jtape* tape, size_t node, int64_t* integer)
+{
+    if(json_tape_type(tape, node) != JSON_NUMBER || tag_of(tape->entries[node]) != TAPE_INTEGER) return JSON_FAILURE;
+    if(integer != NULL) memcpy(integer, &tape->entries[node + 1], sizeof(int64_t));
+    return JSON_SUCCESS;
+}
+
+int json_tape_boolean(const jtape* tape, size_t node)
+{
+    return valid_node(tape, node) && tag_of(tape->entries[node]) == TAPE_TRUE;
+}
+
+// CONVERSION BACK TO A TREE
+
+// a scalar or an empty container is converted whole, anything else gets its members or elements allocated and is
+// opened (and opened set) for to_value to fill in
+static int to_one(const jctx* ctx, const jtape* tape, size_t node, jvalue* out, int* opened)
+{
+    out->flags = ctx->arena != NULL ? JSON_FLAG_ARENA : 0;
+    switch(json_tape_type(tape, node))
+    {
+        case JSON_OBJECT:
+        {
+            const size_t count = json_tape_length(tape, node);
+            out->type = JSON_OBJECT;
+            out->index = NULL;
+            // zeroed, and a zeroed value is an empty object, so a failure below still leaves a freeable tree
+            out->members = count > 0 ? jctx_alloc(ctx, count * sizeof(jmember)) : NULL;
+            out->length = out->members != NULL ? count : 0;
+            if(out->length != count) return JSON_FAILURE;
+            *opened = count > 0;
+            return JSON_SUCCESS;
+        }
+        case JSON_ARRAY:
+        {
+            const size_t count = json_tape_length(tape, node);
+            out->type = JSON_ARRAY;
+            out->lazy = NULL;
+            out->elements = count > 0 ? jctx_alloc(ctx, count * sizeof(jvalue)) : NULL; // zeroed, like members above
+            out->length = out->elements != NULL ? count : 0;
+            if(out->length != count) return JSON_FAILURE;
+            *opened = count > 0;
+            return JSON_SUCCESS;
+        }
+        case JSON_STRING:
+        {
+            size_t length;
+            const char* string = json_tape_string(tape, node, &length);
+            char* copy = jctx_strndup(ctx, string, length);
+            if(copy == NULL) return JSON_FAILURE;
+            out->type = JSON_STRING;
+            out->string = copy;
+            return JSON_SUCCESS;
+        }
+        case JSON_NUMBER:
+            out->type = JSON_NUMBER;
+            out->number = json_tape_number(tape, node);
+            out->integer = 0;
+            if(json_tape_integer(tape, node, &out->integer) == JSON_SUCCESS) out->flags |= JSON_FLAG_INTEGER;
+            return JSON_SUCCESS;
+        case JSON_BOOL:
+            out->type = JSON_BOOL;
+            out->boolean = json_tape_boolean(tape, node);
+            return JSON_SUCCESS;
+        case JSON_NULL:
+            out->type = JSON_NULL;
+            return JSON_SUCCESS;
+        default:
+            return JSON_FAILURE;
+    }
+}
+
+// the tape is walked in order, every open entry says where its container ends, so going from one child to the next
+// is a single lookup
+static int to_value(const jctx* ctx, const jtape* tape, size_t node, jvalue* out)
+{
+    jtape_frame local[TAPE_LOCAL_FRAMES];
+    jtape_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = TAPE_LOCAL_FRAMES;
+    int failed = 0;
+    while(out != NULL && !failed)
+    {
+        if(depth == capacity) // room for one more, in case out gets opened
+        {
+            jtape_frame* more = grow_frames(frames, local, &capacity);
+            if(more == NULL)
+            {
+                failed = 1;
+                break;
+            }
+            frames = more;
+        }
+        int opened = 0;
+        if(to_one(ctx, tape, node, out, &opened))
+        {
+            failed = 1;
+            break;
+        }
+        if(opened) frames[depth++] = (jtape_frame){ .value = out, .next = json_tape_child(tape, node) };
+        // on to the next member or element of the innermost container, finishing the ones that are done
+        out = NULL;
+        while(depth > 0 && out == NULL && !failed)
+        {
+            jtape_frame* frame = &frames[depth - 1];
+            if(frame->next != JSON_TAPE_NONE && frame->index < frame->value->length)
+            {
+                if(frame->value->type == JSON_OBJECT)
+                {
+                    jmember* member = &frame->value->members[frame->index];
+                    size_t length;
+                    const char* key = json_tape_string(tape, frame->next, &length);
+                    member->key = jctx_key(ctx, key, length, &member->flags);
+                    failed = member->key == NULL;
+                    node = frame->next + 1; // members are a key and then the value
+                    out = &member->value;
+                }
+                else
+                {
+                    node = frame->next;
+                    out = &frame->value->elements[frame->index];
+                }
+                frame->next = json_tape_sibling(tape, node);
+                frame->index++;
+            }
+            else
+            {
+                jvalue* done = frame->value;
+                if(done->type == JSON_OBJECT && (ctx->flags & JSON_PARSE_INDEX) && done->length >= JINDEX_MIN_MEMBERS)
+                {
+                    done->index = jindex_build(done->members, done->length, ctx->arena);
+                    failed = done->index == NULL;
+                }
+                depth--;
+            }
+        }
+    }
+    if(frames != local) jfree(frames);
+    return failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+int json_tape_to_value(const jtape* tape, size_t node, jvalue* empty, const jparse_options* opts)
+{
+    if(empty == NULL || !valid_node(tape, node)) return JSON_FAILURE;
+    jintern_counts counts = { 0 };
+    jctx ctx = { .intern_counts = &counts };
+    if(opts != NULL)
+    {
+        ctx.arena = opts->arena;
+        ctx.flags = opts->flags;
+        ctx.intern = opts->intern;
+    }
+    const int result = to_value(&ctx, tape, node, empty);
+    jintern_flush(ctx.intern, &counts);
+    return result;
+}
@@ -0,0 +1,322 @@
+#include "tinyjson.h"
+#include "tinyjson_internal.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// the serializer walks the tree exactly once and appends to a single buffer
+// when there's a sink, the buffer is a fixed-size staging area that gets flushed whenever it fills up,
+// otherwise it grows (doubling) and is handed to the caller at the end
+
+#define JWRITE_SINK_BUFFER 4096
+#define JWRITE_INITIAL_CAPACITY 256
+#define JWRITE_INDENT 4
+#define JWRITE_LOCAL_FRAMES 32 // open containers tracked on the C stack, deeper trees move to the heap
+
+typedef struct jwriter {
+    char* buf;
+    size_t length; // bytes currently in buf
+    size_t capacity;
+    json_sink sink; // NULL when building a string
+    void* user;
+    int flags;
+    int failed; // sticky, once something goes wrong everything after is a no-op
+} jwriter;
+
+static void flush(jwriter* w)
+{
+    if(w->failed || w->length == 0) return;
+    if(w->sink(w->user, w->buf, w->length) != JSON_SUCCESS) w->failed = 1;
+    w->length = 0;
+}
+
+static void put(jwriter* w, const char* data, size_t n)
+{
+    if(w->failed) return;
+    if(w->length + n > w->capacity)
+    {
+        if(w->sink != NULL)
+        {
+            flush(w);
+            if(n > w->capacity) // too big to stage, hand it straight to the sink
+            {
+                if(!w->failed && w->sink(w->user, data, n) != JSON_SUCCESS) w->failed = 1;
+                return;
+            }
+        }
+        else
+        {
+            size_t capacity = w->capacity;
+            while(w->length + n > capacity) capacity *= 2;
+            char* more = jrealloc(w->buf, capacity);
+            if(more == NULL)
+            {
+                w->failed = 1;
+                return;
+            }
+            w->buf = more;
+            w->capacity = capacity;
+        }
+    }
+    memcpy(w->buf + w->length, data, n);
+    w->length += n;
+}
+
+static void put_char(jwriter* w, char c)
+{
+    if(w->length < w->capacity && !w->failed) w->buf[w->length++] = c; // skip the bookkeeping for the common case
+    else put(w, &c, 1);
+}
+
+// newline plus indentation for the given depth (pretty mode only)
+static void newline(jwriter* w, int depth)
+{
+    static const char spaces[] = "                                ";
+    if(!(w->flags & JSON_WRITE_PRETTY)) return;
+    put_char(w, '\n');
+    size_t n = (size_t)depth * JWRITE_INDENT;
+    while(n > 0)
+    {
+        const size_t chunk = n < sizeof(spaces) - 1 ? n : sizeof(spaces) - 1;
+        put(w, spaces, chunk);
+        n -= chunk;
+    }
+}
+
+// quoted and escaped: runs that need no escaping (found with the vector scanner) go out in one piece
+static void write_string(jwriter* w, const char* s)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char* end = s + strlen(s);
+    put_char(w, '"');
+    while(1)
+    {
+        const char* stop = jscan_escape(s, end);
+        put(w, s, stop - s);
+        if(stop == end) break;
+        char escape[6] = { '\\', *stop };
+        size_t length = 2;
+        switch(*stop)
+        {
+            case '"': case '\\': break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default: // any other control character
+                memcpy(escape + 1, "u00", 3);
+                escape[4] = hex[(unsigned char)*stop >> 4];
+                escape[5] = hex[*stop & 0xf];
+                length = 6;
+                break;
+        }
+        put(w, escape, length);
+        s = stop + 1;
+    }
+    put_char(w, '"');
+}
+
+// the tree is walked with an explicit stack of open containers, like the parser, so deep trees can't run out of C stack
+typedef struct jwrite_frame {
+    const jvalue* value; // the container being written
+    size_t index; // next member or element
+} jwrite_frame;
+
+static void write_number(jwriter* w, double number, int64_t integer, int is_integer)
+{
+    char buf[JSON_NUMBER_BUFFER];
+    if(is_integer) put(w, buf, jnumber_format_integer(integer, integer == 0 && signbit(number), buf));
+    else
+    {
+        const int length = json_number_format(number, buf);
+        if(length > 0) put(w, buf, length);
+        else w->failed = 1; // infinities and nan have no JSON spelling, and null would change what the value is
+    }
+}
+
+// packed arrays have no jvalues to push, so they go out whole, straight from their numbers (at depth)
+static void write_packed(jwriter* w, const jvalue* val, int depth)
+{
+    const int integers = (val->flags & JSON_FLAG_INTEGER) != 0;
+    put_char(w, '[');
+    for(size_t i = 0; i < val->length; i++)
+    {
+        if(i > 0) put_char(w, ',');
+        newline(w, depth + 1);
+        if(integers) write_number(w, (double)val->integers[i], val->integers[i], 1);
+        else write_number(w, val->numbers[i], 0, 0);
+    }
+    newline(w, depth);
+    put_char(w, ']');
+}
+
+// a scalar or an empty container goes out whole, anything else is opened and pushed
+static void write_one(jwriter* w, const jvalue* val, jwrite_frame* frame, int* opened)
+{
+    if(json_materialize((jvalue*)val)) // lazy containers have to be parsed to be written
+    {
+        w->failed = 1;
+        return;
+    }
+    switch(val->type)
+    {
+        case JSON_OBJECT:
+        case JSON_ARRAY:
+            if(val->length == 0)
+            {
+                put(w, val->type == JSON_OBJECT ? "{}" : "[]", 2);
+                break;
+            }
+            put_char(w, val->type == JSON_OBJECT ? '{' : '[');
+            *frame = (jwrite_frame){ .value = val };
+            *opened = 1;
+            break;
+
+        case JSON_STRING:
+            write_string(w, val->string);
+            break;
+
+        case JSON_NUMBER:
+            write_number(w, val->number, val->integer, (val->flags & JSON_FLAG_INTEGER) != 0);
+            break;
+
+        case JSON_BOOL:
+            if(val->boolean) put(w, "true", 4);
+            else put(w, "false", 5);
+            break;
+
+        case JSON_NULL:
+            put(w, "null", 4);
+            break;
+
+        default:
+            w->failed = 1; // not something we know how to write
+            break;
+    }
+}
+
+static void write_value(jwriter* w, const jvalue* val)
+{
+    jwrite_frame local[JWRITE_LOCAL_FRAMES];
+    jwrite_frame* frames = local;
+    size_t depth = 0;
+    size_t capacity = JWRITE_LOCAL_FRAMES;
+    while(val != NULL && !w->failed)
+    {
+        if(depth == capacity) // room for one more, in case val gets opened
+        {
+            jwrite_frame* more = frames == local ? jmalloc(capacity * 2 * sizeof(jwrite_frame))
+                                                 : jrealloc(frames, capacity * 2 * sizeof(jwrite_frame));
+            if(more == NULL)
+            {
+                w->failed = 1;
+                break;
+            }
+            if(frames == local) memcpy(more, local, depth * sizeof(jwrite_frame));
+            frames = more;
+            capacity *= 2;
+        }
+        int opened = 0;
+        if((val->flags & JSON_FLAG_LAZY) && jparse_lazy((jvalue*)val)) w->failed = 1; // packed arrays stay packed
+        else if(val->flags & JSON_FLAG_PACKED) write_packed(w, val, (int)depth);
+        else write_one(w, val, &frames[depth], &opened);
+        depth += opened;
+        // on to the next member or element of the innermost container, closing the ones that are done
+        val = NULL;
+        while(depth > 0 && val == NULL)
+        {
+            jwrite_frame* frame = &frames[depth - 1];
+            if(frame->index < frame->value->length)
+            {
+                if(frame->index > 0) put_char(w, ',');
+                newline(w, (int)depth);
+                if(frame->value->type == JSON_OBJECT)
+                {
+                    const jmember* member = &frame->value->members[frame->index];
+                    write_string(w, member->key);
+                    if(w->flags & JSON_WRITE_PRETTY) put(w, ": ", 2);
+                    else put_char(w, ':');
+                    val = &member->value;
+                }
+                else val = &frame->value->elements[frame->index];
+                frame->index++;
+            }
+            else
+            {
+                depth--;
+                newline(w, (int)depth);
+                put_char(w, frame->value->type == JSON_OBJECT ? '}' : ']');
+            }
+        }
+    }
+    if(frames != local) jfree(frames);
+}
+
+int json_write_value(const jvalue* val, int flags, json_sink sink, void* user)
+{
+    if(val == NULL || sink == NULL) return JSON_FAILURE;
+    char staging[JWRITE_SINK_BUFFER];
+    jwriter w = { .buf = staging, .capacity = sizeof(staging), .sink = sink, .user = user, .flags = flags };
+    write_value(&w, val);
+    flush(&w);
+    return w.failed ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+char* json_write_to_str(const jvalue* val, int flags, size_t* length)
+{
+    if(val == NULL) return NULL;
+    jwriter w = { .capacity = JWRITE_INITIAL_CAPACITY, .flags = flags };
+    w.buf = jmalloc(w.capacity);
+    if(w.buf == NULL) return NULL;
+    write_value(&w, val);
+    put_char(&w, '\0');
+    if(w.failed)
+    {
+        jfree(w.buf);
+        return NULL;
+    }
+    if(length != NULL) *length = w.length - 1; // don't count the terminator
+    return w.buf;
+}
+
+int json_sink_file(void* file, const char* data, size_t length)
+{
+    return fwrite(data, 1, length, file) == length ? JSON_SUCCESS : JSON_FAILURE;
+}
+
+int json_sink_fd(void* fd, const char* data, size_t length)
+{
+    const int target = *(const int*)fd;
+    while(length > 0)
+    {
+        const ssize_t written = write(target, data, length);
+        if(written < 0)
+        {
+            if(errno == EINTR) continue;
+            return JSON_FAILURE;
+        }
+        data += written;
+        length -= written;
+    }
+    return JSON_SUCCESS;
+}
+
+void json_print_value(const jvalue* v)
+{
+    // written out whole or not at all, streaming would leave half a document behind when something fails midway
+    char* out = json_write_to_str(v, JSON_WRITE_PRETTY, NULL);
+    if(out == NULL) return;
+    puts(out);
+    jfree(out);
+}
+
+// remember to free what this returns!
+char* json_jval_to_str(const jvalue* val)
+{
+    return json_write_to_str(val, JSON_WRITE_PRETTY, NULL);
+}
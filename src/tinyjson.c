@@ -1,6 +1,7 @@
 #include "tinyjson.h"
+#include "tinyjson_internal.h"
 
-#include <ctype.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,197 +11,662 @@
 
 // use calloc everywhere! gets valgrind to shut up about uninitialized warnings
 
+void* jctx_alloc(const jctx* ctx, size_t size)
+{
+    if(ctx->arena != NULL) return json_arena_alloc(ctx->arena, size);
+    return jcalloc(size);
+}
+
+void* jctx_grow(const jctx* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    if(ctx->arena != NULL) return json_arena_grow(ctx->arena, ptr, old_size, new_size);
+    return jrealloc(ptr, new_size);
+}
+
+char* jctx_strndup(const jctx* ctx, const char* start, size_t length)
+{
+    if(ctx->arena != NULL) return json_arena_strndup(ctx->arena, start, length);
+    char* out = jmalloc(length + 1);
+    if(out == NULL) return NULL;
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return out;
+}
+
+char* jctx_key(const jctx* ctx, const char* start, size_t length, unsigned int* flags)
+{
+    if(ctx->intern == NULL) return jctx_strndup(ctx, start, length);
+    *flags |= JSON_FLAG_INTERNED;
+    return (char*)jintern_get(ctx->intern, start, length, ctx->intern_counts); // never written to, it's shared
+}
+
+void* jctx_append(const jctx* ctx, jvalue* container, size_t* capacity)
+{
+    const size_t size = container->type == JSON_OBJECT ? sizeof(jmember) : sizeof(jvalue);
+    if(container->length == *capacity) // full, double it
+    {
+        const size_t more = *capacity ? *capacity * 2 : 2; // pairs and single members fit right away
+        char* grown = jctx_grow(ctx, container->members, *capacity * size, more * size); // same slot as elements
+        if(grown == NULL) return NULL;
+        container->members = (jmember*)grown;
+        *capacity = more;
+    }
+    char* slot = (char*)container->members + container->length++ * size;
+    memset(slot, 0, size); // grown space isn't zeroed, and an empty object is safe to free
+    return slot;
+}
+
+int jctx_finish(const jctx* ctx, jvalue* container, size_t capacity)
+{
+    // room that's left over is kept: it's never more than what's used, and shrinking every container with realloc
+    // costs more parse time than it saves (arenas couldn't give it back anyway, the children come after it)
+    if(container->length == 0 && capacity > 0) // everything was skipped (projections do that)
+    {
+        if(ctx->arena == NULL) jfree(container->members); // same slot as elements
+        container->members = NULL;
+    }
+    if(container->type == JSON_OBJECT && (ctx->flags & JSON_PARSE_INDEX) && container->length >= JINDEX_MIN_MEMBERS)
+    {
+        container->index = jindex_build(container->members, container->length, ctx->arena);
+        if(container->index == NULL) return JSON_FAILURE;
+    }
+    return JSON_SUCCESS;
+}
+
+// turn the string body between start and end (the closing quote) into a jvalue/jmember string
+// in-situ parses terminate it in place and flag it as borrowed, everything else gets a copy
+// bodies with escapes are decoded on the way (in place for in-situ parses, since decoding only ever shrinks them)
+// returns NULL on failure (memory, or a malformed escape)
+static char* ctx_string(const jctx* ctx, char* start, char* end, int escaped, unsigned int* flags)
+{
+    if(ctx->flags & JSON_PARSE_INSITU)
+    {
+        if(escaped)
+        {
+            const size_t length = jstring_unescape(start, start, end);
+            if(length == JSTRING_INVALID) return NULL;
+            end = start + length;
+        }
+        *end = '\0'; // overwrites the closing quote (or something already decoded), the cursor moves past it anyways
+        *flags |= JSON_FLAG_BORROWED;
+        return start;
+    }
+    if(!escaped) return jctx_strndup(ctx, start, end - start);
+    char* out = ctx->arena != NULL ? json_arena_alloc(ctx->arena, end - start + 1) : jmalloc(end - start + 1);
+    if(out == NULL) return NULL;
+    const size_t length = jstring_unescape(out, start, end);
+    if(length == JSTRING_INVALID)
+    {
+        if(ctx->arena == NULL) jfree(out);
+        return NULL;
+    }
+    out[length] = '\0';
+    return out;
+}
+
+// decode the escapes in the key between start and end into local if they fit, or into a fresh malloc'd buffer
+// returns NULL on failure (memory, or a malformed escape), free what comes back if it isn't local
+static char* decode_key(const char* start, const char* end, char* local, size_t size, size_t* length)
+{
+    char* decoded = (size_t)(end - start) <= size ? local : jmalloc(end - start);
+    if(decoded == NULL) return NULL;
+    *length = jstring_unescape(decoded, start, end);
+    if(*length == JSTRING_INVALID)
+    {
+        if(decoded != local) jfree(decoded);
+        return NULL;
+    }
+    return decoded;
+}
+
+// same as ctx_string, for member keys: with an intern table they're looked up there instead (decoded on the side,
+// so that works for in-situ parses too)
+static char* ctx_key(const jctx* ctx, char* start, char* end, int escaped, unsigned int* flags)
+{
+    if(ctx->intern == NULL) return ctx_string(ctx, start, end, escaped, flags);
+    if(!escaped) return jctx_key(ctx, start, end - start, flags);
+    char local[128];
+    size_t length;
+    char* decoded = decode_key(start, end, local, sizeof(local), &length);
+    if(decoded == NULL) return NULL;
+    char* key = jctx_key(ctx, decoded, length, flags);
+    if(decoded != local) jfree(decoded);
+    return key;
+}
+
+// with JSON_PARSE_VALIDATE_UTF8, check the string body between start and end (the closing quote)
+// on failure the cursor is moved to the offending byte, so that's where the parse reports it
+static int check_utf8(const jctx* ctx, char* start, char** cursor)
+{
+    if(!(ctx->flags & JSON_PARSE_VALIDATE_UTF8)) return JSON_SUCCESS;
+    const char* bad = jscan_utf8(start, *cursor);
+    if(bad == *cursor) return JSON_SUCCESS;
+    *cursor = (char*)bad;
+    if(ctx->error != NULL) ctx->error->code = JSON_ERROR_UTF8;
+    return JSON_FAILURE;
+}
+
 // advance the cursor until it isn't on a space anymore
-static void skip_space(char** cursor)
+static void skip_space(char** cursor, const char* end)
 {
-    if(**cursor == '\0') return; // stop on eof
-    while(isspace(**cursor)) (*cursor)++; // as long as the cursor is on a space, increment the cursor's position
+    *cursor = (char*)jscan_skip_space(*cursor, end); // stops on eof too
 }
 
-// advance the cursor to the next occurrence of a character
-static void advance_to(char target, char** cursor)
+// advance the cursor from the start of a string body to its closing quote (escaped quotes don't count)
+// escaped (if not NULL) is set when the body has escapes in it
+// returns JSON_FAILURE if the input ends first (or there's a raw null in the way)
+static int advance_to_quote(char** cursor, const char* end, int* escaped)
 {
-    if(**cursor == '\0') return;
-    while(**cursor != target) (*cursor)++;
+    while(1)
+    {
+        *cursor = (char*)jscan_string_end(*cursor, end);
+        if(*cursor == end || **cursor == '\0') return JSON_FAILURE;
+        if(**cursor == '"') return JSON_SUCCESS;
+        if(*cursor + 1 == end) return JSON_FAILURE; // backslash: skip whatever it escapes
+        if(escaped != NULL) *escaped = 1;
+        *cursor += 2;
+    }
 }
 
-// free the memory associated with a jmember
-// frees the string, then the value with json_free_value(), then the member itself
-static void json_free_member(jmember* m)
+// skip a whole container without parsing it: only brackets and strings are looked at
+// cursor starts on the opening bracket and is left just past the matching close
+// returns JSON_FAILURE if the input ends first
+static int skip_container(char** cursor, const char* end)
 {
-    free(m->string);
-    json_free_value(m->element);
-    free(m);
+    size_t depth = 0;
+    char* p = *cursor;
+    while(1)
+    {
+        p = (char*)jscan_structural(p, end);
+        if(p == end) return JSON_FAILURE;
+        switch(*p)
+        {
+            case '{':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ']':
+                if(--depth == 0)
+                {
+                    *cursor = p + 1;
+                    return JSON_SUCCESS;
+                }
+                break;
+            case '"':
+                p++;
+                if(advance_to_quote(&p, end, NULL)) return JSON_FAILURE;
+                break;
+            case '\0':
+                return JSON_FAILURE;
+            default: // , and :
+                break;
+        }
+        p++;
+    }
+}
+
+// leave the container at cursor as a lazy span (type is JSON_OBJECT or JSON_ARRAY)
+static int defer_container(const jctx* ctx, char** cursor, jvalue* empty, int type)
+{
+    jlazy* lazy = jctx_alloc(ctx, sizeof(jlazy));
+    if(lazy == NULL) return JSON_FAILURE;
+    lazy->start = *cursor;
+    lazy->end = ctx->end;
+    lazy->arena = ctx->arena;
+    lazy->flags = ctx->flags & ~JCTX_DEFER;
+    lazy->intern = ctx->intern;
+    empty->type = type;
+    empty->members = NULL; // reads as empty until it's parsed
+    empty->length = 0;
+    empty->lazy = lazy;
+    empty->flags |= JSON_FLAG_LAZY;
+    return skip_container(cursor, ctx->end);
+}
+
+// what the children of a container are parsed with
+static inline jctx child_ctx(const jctx* ctx)
+{
+    jctx child = *ctx;
+    if(child.flags & JSON_PARSE_LAZY) child.flags |= JCTX_DEFER;
+    return child;
 }
 
 // check if the text at cursor is a certain literal, and advance cursor to the character after that literal
-static int json_is_literal(char** cursor, const char* literal)
+static int json_is_literal(char** cursor, const char* end, const char* literal)
 {
-    while(*literal != '\0' && !isspace(**cursor))
+    const size_t length = strlen(literal);
+    if((size_t)(end - *cursor) < length || memcmp(*cursor, literal, length) != 0) return 0;
+    *cursor += length;
+    return 1;
+}
+
+// free what hangs off a value that has nothing under it (a scalar, or an empty or lazy container)
+// returns 1 instead for a container with members or elements, which have to go first
+static int release_one(jvalue* v)
+{
+    if(v->flags & JSON_FLAG_LAZY) // never parsed, so there's nothing under it
     {
-        if(*literal != **cursor) return 0;
-        literal ++;
-        (*cursor)++;
+        if(!(v->flags & JSON_FLAG_ARENA)) jfree(v->lazy);
     }
-    return 1;
+    else if(v->flags & JSON_FLAG_PACKED) // numbers, but no jvalues
+    {
+        if(!(v->flags & JSON_FLAG_ARENA)) jfree(v->numbers);
+    }
+    else if(v->type == JSON_OBJECT || v->type == JSON_ARRAY)
+    {
+        if(v->type == JSON_OBJECT) jindex_free(v->index);
+        if(v->length > 0) return 1;
+        jfree(v->members); // same slot as elements
+    }
+    else if(v->type == JSON_STRING && !(v->flags & JSON_FLAG_BORROWED)) // unless it points into someone else's buffer
+    {
+        jfree(v->string);
+    }
+    return 0;
 }
 
-void json_free_value(jvalue* v) // TODO: review edge cases here. what about freeing partially/malformed values?
+// containers on the way down point back up at their parent through their index/lazy slot, which nothing needs
+// by then, and members and elements sit side by side, so the next one to free is always right after the last one:
+// freeing takes no stack and no memory however deep the tree goes
+static void set_parent(jvalue* v, jvalue* parent)
 {
-    if(v == NULL) return;
-    switch(v->type) // following 3 cases are dynamically allocated
+    v->lazy = (jlazy*)parent;
+}
+
+static jvalue* parent_of(const jvalue* v)
+{
+    return (jvalue*)v->lazy;
+}
+
+// free everything under v, but not v itself (which may be a member or element of something else)
+static void release(jvalue* v)
+{
+    jvalue* parent = NULL; // innermost container being emptied
+    jvalue* child = v;
+    while(1)
     {
-        case JSON_OBJECT:
-            while(v->members != NULL) // go until null pointer
+        if(release_one(child)) // go down into it
+        {
+            set_parent(child, parent);
+            parent = child;
+            child = parent->type == JSON_OBJECT ? &parent->members[0].value : &parent->elements[0];
+            continue;
+        }
+        // on to the next member or element, climbing out of every container that's done on the way
+        while(1)
+        {
+            if(parent == NULL) return;
+            if(parent->type == JSON_OBJECT)
             {
-                jmember *next = v->members;
-                v->members = v->members->next;
-                json_free_member(next);
+                jmember* m = (jmember*)((char*)child - offsetof(jmember, value));
+                if(!(m->flags & (JSON_FLAG_BORROWED | JSON_FLAG_INTERNED))) jfree(m->key);
+                if(++m < parent->members + parent->length)
+                {
+                    child = &m->value;
+                    break;
+                }
             }
-            free(v->members); // free the head pointer
-            break;
+            else if(++child < parent->elements + parent->length) break;
+            jvalue* done = parent;
+            parent = parent_of(done);
+            jfree(done->members);
+            child = done;
+        }
+    }
+}
 
-        case JSON_ARRAY: // same concept as for objects
-            for(int i = 0; v->elements[i] != NULL; i++)
-                json_free_value(v->elements[i]);
-            free(v->elements);
-            break;
+void json_free_value(jvalue* v)
+{
+    if(v == NULL) return;
+    release(v);
+    jfree(v); // the jvalue itself was allocated on its own (members and elements never are)
+}
 
-        case JSON_STRING: // for strings just free the string
-            free(v->string);
-            break;
+// is the character at cursor c (never reading past the end of the input)
+static inline int at(const jctx* ctx, const char* cursor, char c)
+{
+    return cursor < ctx->end && *cursor == c;
+}
 
-        default: // in the default case, do nothing (for primitive jvals, all members are alloc'd along with the jvalue)
-            break;
-    }
+static int is_number_char(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
 
-    free(v); // free the jvalue itself
+// parse the number at cursor into empty, and advance the cursor past it
+static int parse_number(const jctx* ctx, char** cursor, jvalue* empty, int* is_integer)
+{
+    const char* last = *cursor;
+    while(last < ctx->end && is_number_char(*last)) last++;
+    // something that can't be part of a number follows it, and the number parser stops there by itself
+    if(last < ctx->end) return jnumber_parse(*cursor, (const char**)cursor, &empty->number, &empty->integer, is_integer);
+    // the number runs right up to the end of the input, which isn't necessarily followed by anything readable
+    const size_t length = last - *cursor;
+    char local[64];
+    char* copy = length < sizeof(local) ? local : jmalloc(length + 1);
+    if(copy == NULL) return JSON_FAILURE;
+    memcpy(copy, *cursor, length);
+    copy[length] = '\0';
+    const char* stop;
+    const int result = jnumber_parse(copy, &stop, &empty->number, &empty->integer, is_integer);
+    if(result == JSON_SUCCESS) *cursor += stop - copy;
+    if(copy != local) jfree(copy);
+    return result;
 }
 
-// assume cursor starts immediately after this object's opening bracket
-static int json_parse_member(char** cursor, jmember* member)
+// read the key of the next member and the colon after it
+// assume cursor starts immediately after this object's opening bracket (or a comma), and leave it just past the colon
+// key and key_end are set to the key's raw body (escapes and all)
+static int read_key(const jctx* ctx, char** cursor, char** key, char** key_end, int* escaped)
 {
-    skip_space(cursor); // chop whitespace
-    // read in the key
-    if(**cursor != '"') return JSON_FAILURE; // look for the opening quote
+    skip_space(cursor, ctx->end); // chop whitespace
+    if(!at(ctx, *cursor, '"')) return JSON_FAILURE; // look for the opening quote
     (*cursor)++;
-    const char* start = *cursor; // parse in the object key
-    advance_to('"', cursor); // find the end of the string
-    const long int length = *cursor - start; // figure length
-    member->string = calloc(length + 1, 1); // allocate the key
-    if(member->string == NULL) return JSON_FAILURE;
-    memcpy(member->string, start, length); // copy in the key
+    *key = *cursor;
+    if(advance_to_quote(cursor, ctx->end, escaped)) return JSON_FAILURE; // find the end of the string
+    if(check_utf8(ctx, *key, cursor)) return JSON_FAILURE;
+    *key_end = *cursor;
     (*cursor)++; // advance the cursor past the closing quote
-    skip_space(cursor);
-    if(**cursor != ':') return JSON_FAILURE; // look for the colon
+    skip_space(cursor, ctx->end);
+    if(!at(ctx, *cursor, ':')) return JSON_FAILURE; // look for the colon
     (*cursor)++; // advance the cursor past the colon
-    // read in the value
-    member->element = calloc(1, sizeof(jvalue));
-    if(member->element == NULL) return JSON_FAILURE;
-    return json_parse_value(cursor, member->element);
+    return JSON_SUCCESS;
 }
 
-void json_print_value(const jvalue* v)
+// step over the value at cursor without building anything (containers are only matched bracket to bracket, like lazy ones)
+static int skip_value(const jctx* ctx, char** cursor)
 {
-    char* str = json_jval_to_str(v);
-    printf("%s\n", str);
-    free(str);
+    skip_space(cursor, ctx->end);
+    if(*cursor == ctx->end) return JSON_FAILURE;
+    switch(**cursor)
+    {
+        case '{':
+        case '[':
+            return skip_container(cursor, ctx->end);
+        case '"':
+            (*cursor)++;
+            if(advance_to_quote(cursor, ctx->end, NULL)) return JSON_FAILURE;
+            (*cursor)++;
+            return JSON_SUCCESS;
+        case 't':
+            return json_is_literal(cursor, ctx->end, "true") ? JSON_SUCCESS : JSON_FAILURE;
+        case 'f':
+            return json_is_literal(cursor, ctx->end, "false") ? JSON_SUCCESS : JSON_FAILURE;
+        case 'n':
+            return json_is_literal(cursor, ctx->end, "null") ? JSON_SUCCESS : JSON_FAILURE;
+        default:
+        {
+            const char* start = *cursor;
+            while(*cursor < ctx->end && is_number_char(**cursor)) (*cursor)++;
+            return *cursor != start ? JSON_SUCCESS : JSON_FAILURE;
+        }
+    }
 }
 
-int json_parse_value(char** cursor, jvalue* empty)
+// with a projection, work out whether the value at cursor, reached through node (JPATH_NONE if no path goes there), is
+// wanted and what it's parsed with
+// values that aren't wanted (or are, but only for what's inside a container that isn't there) are skipped
+// returns JSON_FAILURE on malformed input
+static int project_value(const jctx* ctx, char** cursor, size_t node, jctx* value_ctx, int* keep)
 {
-    skip_space(cursor); // chop whitespace
-    if(**cursor == '\0') return JSON_FAILURE; // can't parse on eof
-    switch(**cursor)
+    *keep = node != JPATH_NONE;
+    if(*keep && jpaths_ends(ctx->projection, node))
     {
-        case '{': // parse an object TODO: review edge cases here, and fix that ugly loop
-            empty->type = JSON_OBJECT;
-            empty->members = NULL; // initialize an empty object (point head to null)
-            (*cursor)++; // go to next character
-            skip_space(cursor); // skip any space before first member
-            if(**cursor == '}')  // if the object closes immediately stop
+        value_ctx->projection = NULL; // everything under here is wanted
+    }
+    else if(*keep)
+    {
+        value_ctx->node = node;
+        skip_space(cursor, ctx->end);
+        *keep = at(ctx, *cursor, '{') || at(ctx, *cursor, '[');
+    }
+    return *keep ? JSON_SUCCESS : skip_value(ctx, cursor);
+}
+
+// same for the member whose key was just read, which is matched by its key
+static int project_member(const jctx* ctx, char** cursor, const char* key, const char* key_end, int escaped, jctx* member_ctx, int* keep)
+{
+    size_t length = key_end - key;
+    char local[128];
+    char* decoded = NULL;
+    if(escaped) // compare the key as it reads, not as it's written
+    {
+        decoded = decode_key(key, key_end, local, sizeof(local), &length);
+        if(decoded == NULL) return JSON_FAILURE;
+        key = decoded;
+    }
+    const size_t node = jpaths_child(ctx->projection, ctx->node, key, length);
+    if(decoded != NULL && decoded != local) jfree(decoded);
+    return project_value(ctx, cursor, node, member_ctx, keep);
+}
+
+// the parser loops over an explicit stack of open containers instead of recursing into them, so how deep a document
+// can nest is down to max_depth, never to the C stack
+// frames for the first few levels live on the C stack, deeper documents move them to the heap
+
+#define JPARSE_LOCAL_FRAMES 32
+
+typedef struct jparse_frame {
+    jvalue* value; // the container being filled
+    size_t capacity; // members or elements it has room for
+    jctx ctx; // what the members or elements are parsed with
+    const jpaths* item_projection; // the projection for the member or element being parsed (per key or per index)
+    size_t item_node;
+    size_t position; // elements read so far, skipped ones included (projections pick them by index)
+} jparse_frame;
+
+typedef struct jparse_stack {
+    jparse_frame* frames;
+    size_t depth;
+    size_t capacity;
+    jparse_frame* local; // the frames on the C stack, until there are too many of them
+} jparse_stack;
+
+// open a frame for value, a container that was just opened and has members or elements to come
+static jparse_frame* push_frame(const jctx* ctx, jparse_stack* stack, jvalue* value)
+{
+    const jctx child = child_ctx(ctx); // before growing, ctx may point into the frames
+    if(stack->depth == stack->capacity)
+    {
+        const size_t capacity = stack->capacity * 2;
+        jparse_frame* more = stack->frames == stack->local ? jmalloc(capacity * sizeof(jparse_frame))
+                                                           : jrealloc(stack->frames, capacity * sizeof(jparse_frame));
+        if(more == NULL) return NULL;
+        if(stack->frames == stack->local) memcpy(more, stack->local, stack->depth * sizeof(jparse_frame));
+        stack->frames = more;
+        stack->capacity = capacity;
+    }
+    jparse_frame* frame = &stack->frames[stack->depth++];
+    *frame = (jparse_frame){ .value = value, .ctx = child };
+    frame->item_projection = frame->ctx.projection;
+    frame->item_node = frame->ctx.node;
+    return frame;
+}
+
+// with JSON_PARSE_PACK_NUMBERS, read an array with nothing but numbers in it (cursor is on the first one) straight into
+// one block of int64_t, converted to double in place (they're the same size) the first time a number isn't an integer
+// plain integers, which is most of them, go through the 8 digits at a time fast path
+// returns JPACK_MIXED, leaving the cursor where it was, as soon as anything else turns up (or something's malformed),
+// and the array is parsed the usual way from the start
+// that includes a block of doubles that would have to hold an integer a double can't (past 2^53), packing mustn't
+// change any value
+#define JPACK_MIXED 2
+#define JPACK_LOCAL 16 // numbers read on the C stack before anything is allocated, so giving up on short arrays is free
+
+typedef union jpacked {
+    int64_t integer;
+    double number;
+} jpacked;
+
+static int pack_numbers(const jctx* ctx, char** cursor, jvalue* empty)
+{
+    const char* p = *cursor;
+    if(p == ctx->end || !(*p == '-' || (*p >= '0' && *p <= '9'))) return JPACK_MIXED; // cheap way out for everything else
+    jpacked local[JPACK_LOCAL];
+    jpacked* packed = local;
+    size_t length = 0;
+    size_t capacity = JPACK_LOCAL;
+    int integers = 1; // everything so far was an integer
+    int inexact = 0; // and at least one of them doesn't fit in a double
+    int result = JPACK_MIXED;
+    while(1)
+    {
+        if(length == capacity) // full, double it
+        {
+            const size_t more = capacity * 2;
+            jpacked* grown = jctx_grow(ctx, packed == local ? NULL : packed, capacity * sizeof(jpacked), more * sizeof(jpacked));
+            if(grown == NULL)
             {
-                (*cursor)++; // continue to the next thing
+                result = JSON_FAILURE;
                 break;
             }
-            jmember* tail = empty->members; // points to NULL (because at first there is no tail)
-            while(1) // go until object close
+            if(packed == local) memcpy(grown, local, sizeof(local));
+            packed = grown;
+            capacity = more;
+        }
+        int64_t integer;
+        if(jnumber_parse_integer(p, ctx->end, &p, &integer) == JSON_SUCCESS)
+        {
+            if(integers)
+            {
+                packed[length].integer = integer;
+                inexact |= !jnumber_fits_double(integer);
+            }
+            else if(jnumber_fits_double(integer)) packed[length].number = (double)integer;
+            else break;
+        }
+        else
+        {
+            jvalue number;
+            int is_integer;
+            char* at_number = (char*)p;
+            if(p == ctx->end || !is_number_char(*p) || parse_number(ctx, &at_number, &number, &is_integer)) break;
+            p = at_number;
+            if(integers && is_integer && !(number.integer == 0 && signbit(number.number)))
+            {
+                packed[length].integer = number.integer;
+                inexact |= !jnumber_fits_double(number.integer);
+            }
+            else
             {
-                jmember* newMember = calloc(1, sizeof(jmember));
-                if(newMember == NULL) return JSON_FAILURE;
-                if(json_parse_member(cursor, newMember)) // try and parse in the next member
+                if(is_integer && !jnumber_fits_double(number.integer)) break;
+                if(integers) // everything before this one becomes a double too
                 {
-                    newMember->next = NULL; // new element is going at the tail
-                    if(tail == NULL) empty->members = newMember; // if there wasn't a tail, point the head to the new element
-                    else tail->next = newMember; // if there was a tail, point it to the new element
-                    tail = newMember; // set the tail to the new element
+                    if(inexact) break;
+                    for(size_t i = 0; i < length; i++) packed[i].number = (double)packed[i].integer;
+                    integers = 0;
                 }
-                else return JSON_FAILURE;
-                skip_space(cursor); // skip until the next thing
-                if(**cursor == '}') break; // stop when encountering a closing bracket
-                if(**cursor != ',') return JSON_FAILURE; // fail when not finding a comma
-                (*cursor)++; // increment the cursor
-                skip_space(cursor);
+                packed[length].number = number.number;
             }
-            (*cursor)++; // continue to the next thing
+        }
+        length++;
+        char* next = (char*)p;
+        skip_space(&next, ctx->end);
+        if(at(ctx, next, ']'))
+        {
+            p = next + 1;
+            result = JSON_SUCCESS;
             break;
+        }
+        if(!at(ctx, next, ',')) break;
+        next++;
+        skip_space(&next, ctx->end);
+        p = next;
+    }
+    if(result == JSON_SUCCESS && packed == local) // still fits on the stack, move it somewhere that lasts
+    {
+        packed = jctx_grow(ctx, NULL, 0, length * sizeof(jpacked));
+        if(packed == NULL) return JSON_FAILURE;
+        memcpy(packed, local, length * sizeof(jpacked));
+    }
+    if(result != JSON_SUCCESS)
+    {
+        if(packed != local && ctx->arena == NULL) jfree(packed);
+        return result;
+    }
+    // room that's left over is kept, like in every other container
+    empty->integers = &packed[0].integer; // same slot as numbers
+    empty->length = length;
+    empty->arena = ctx->arena;
+    empty->flags |= JSON_FLAG_PACKED | (integers ? JSON_FLAG_INTEGER : 0);
+    *cursor = (char*)p;
+    return JSON_SUCCESS;
+}
+
+// would a container opened now be nested deeper than allowed (empty ones count too)
+static int too_deep(const jctx* ctx, const jparse_stack* stack)
+{
+    if(stack->depth < (ctx->max_depth ? ctx->max_depth : JSON_MAX_DEPTH)) return 0;
+    if(ctx->error != NULL) ctx->error->code = JSON_ERROR_DEPTH;
+    return 1;
+}
 
-        case '[': // parse an array
+// parse the value at cursor into empty
+// a container that isn't empty is only opened, and pushed (opened is set) for the loop in parse_value to fill in
+static int parse_one(const jctx* ctx, char** cursor, jvalue* empty, jparse_stack* stack, int* opened)
+{
+    empty->flags = ctx->arena != NULL ? JSON_FLAG_ARENA : 0;
+    skip_space(cursor, ctx->end); // chop whitespace
+    if(*cursor == ctx->end) return JSON_FAILURE; // can't parse on eof
+    if((**cursor == '{' || **cursor == '[') && !(ctx->flags & JCTX_DEFER) && too_deep(ctx, stack)) return JSON_FAILURE;
+    switch(**cursor)
+    {
+        case '{': // open an object
+            if(ctx->flags & JCTX_DEFER) return defer_container(ctx, cursor, empty, JSON_OBJECT); // lazy parse, leave it for later
+            empty->type = JSON_OBJECT;
+            empty->members = NULL; // initialize an empty object
+            empty->length = 0;
+            empty->index = NULL;
+            (*cursor)++; // go to next character
+            skip_space(cursor, ctx->end); // skip any space before first member
+            if(at(ctx, *cursor, '}'))  // if the object closes immediately stop
+            {
+                (*cursor)++; // continue to the next thing
+                break;
+            }
+            if(push_frame(ctx, stack, empty) == NULL) return JSON_FAILURE;
+            *opened = 1;
+            break;
+
+        case '[': // open an array
+            if(ctx->flags & JCTX_DEFER) return defer_container(ctx, cursor, empty, JSON_ARRAY);
             empty->type = JSON_ARRAY;
-            int size = 4;
-            empty->elements = calloc(size, sizeof(jvalue*)); // allocate space for 4 pointers (all set to null)
-            if(empty->elements == NULL) return JSON_FAILURE;
+            empty->elements = NULL; // room is made once there's something to put in it
+            empty->length = 0;
+            empty->lazy = NULL;
             (*cursor)++;
-            skip_space(cursor);
-            if(**cursor == ']') // if array closes immediately, stop
+            skip_space(cursor, ctx->end);
+            if(at(ctx, *cursor, ']')) // if array closes immediately, stop
             {
                 (*cursor)++; // continue to the next thing
                 break;
             }
-            int i = 0;
-            while(1) // TODO: also fix this ugly loop (why is this loop ugly?)
+            if((ctx->flags & JSON_PARSE_PACK_NUMBERS) && ctx->projection == NULL)
             {
-                jvalue* newValue = calloc(1, sizeof(jvalue));
-                if(newValue == NULL) return JSON_FAILURE;
-                if(json_parse_value(cursor, newValue)) // try to parse a value
-                {
-                    if(i + 1 == size) // are we about to overflow?
-                    {
-                        size *= 2; // double the size
-                        jvalue** moreSpace = realloc(empty->elements, size * sizeof(jvalue*));
-                        if(moreSpace == NULL) return JSON_FAILURE; // external caller should handle deallocation anyways
-                        empty->elements = moreSpace; // have to twostep here so that external deallocation can find the old array in case of failure
-                    }
-                    empty->elements[i] = newValue;
-                    i++;
-                }
-                else return JSON_FAILURE;
-                skip_space(cursor); // skip until the next thing
-                if(**cursor == ']') break; // stop when encountering a closing bracket
-                else if(**cursor != ',') return JSON_FAILURE; // fail when not finding a comma
-                (*cursor)++; // increment the cursor
-                skip_space(cursor);
+                const int packed = pack_numbers(ctx, cursor, empty);
+                if(packed == JSON_SUCCESS) break;
+                if(packed == JSON_FAILURE) return JSON_FAILURE;
+                // not all numbers, parse it like any other array
             }
-            empty->elements[i] = NULL; // terminate the array
-            jvalue** trimmed = realloc(empty->elements, (i + 1) * sizeof(jvalue*)); // free any unused space
-            if(trimmed == NULL) return JSON_FAILURE;
-            empty->elements = trimmed; // again twostep so caller can handle deallocation on failure
-            (*cursor)++; // continue to the next thing
+            if(push_frame(ctx, stack, empty) == NULL) return JSON_FAILURE;
+            *opened = 1;
             break;
 
         case '"': // parse a string
             (*cursor)++;
-            const char* start = *cursor;
-            advance_to('"', cursor); // find the end of the string
-            empty->string = calloc(*cursor - start + 1, 1); // allocate the string
+            char* start = *cursor;
+            int escaped = 0;
+            if(advance_to_quote(cursor, ctx->end, &escaped)) return JSON_FAILURE; // find the end of the string
+            if(check_utf8(ctx, start, cursor)) return JSON_FAILURE;
+            empty->string = ctx_string(ctx, start, *cursor, escaped, &empty->flags); // copy the string
             if(empty->string == NULL) return JSON_FAILURE;
-            memcpy(empty->string, start, *cursor - start); // copy the string
             empty->type = JSON_STRING; // set object type
             (*cursor)++; // scoot the cursor past the end of the string (skip closing quotes)
             break; // done!
 
         case 't': // parse a true literal
-            if(json_is_literal(cursor, "true")) // takes care of cursor movement
+            if(json_is_literal(cursor, ctx->end, "true")) // takes care of cursor movement
             {
                 empty->type = JSON_BOOL;
                 empty->boolean = 1;
@@ -209,7 +675,7 @@ int json_parse_value(char** cursor, jvalue* empty)
             return JSON_FAILURE;
 
         case 'f': // parse a false literal
-            if(json_is_literal(cursor, "false")) // takes care of cursor movement
+            if(json_is_literal(cursor, ctx->end, "false")) // takes care of cursor movement
             {
                 empty->type = JSON_BOOL;
                 empty->boolean = 0;
@@ -218,7 +684,7 @@ int json_parse_value(char** cursor, jvalue* empty)
             return JSON_FAILURE;
         
         case 'n': // parse a null literal
-            if(json_is_literal(cursor, "null")) // takes care of cursor movement
+            if(json_is_literal(cursor, ctx->end, "null")) // takes care of cursor movement
             {
                 empty->type = JSON_NULL;
                 break;
@@ -227,197 +693,416 @@ int json_parse_value(char** cursor, jvalue* empty)
 
         default: // parse a number literal
             empty->type = JSON_NUMBER; // set type of the member
-            const char before = **cursor; // save value at cursor FIXME: funky pointers!
-            empty->number = strtod(*cursor, cursor); // strtod moves the cursor one past the last character interpreted
-            if (empty->number == 0 && **cursor == before) return JSON_FAILURE; // TODO: make sure this check actually catches everything!
-            // strtod returns 0 on failure, but does it really not move the cursor?
+            int is_integer;
+            if(parse_number(ctx, cursor, empty, &is_integer)) return JSON_FAILURE;
+            if(is_integer) empty->flags |= JSON_FLAG_INTEGER;
             break;
     }
-    // if we get to the end and there are still things to parse that aren't whitespace, the string must be malformed
-    skip_space(cursor);
-    if (**cursor != '\0') return JSON_FAILURE;
-    return JSON_SUCCESS;
+    return JSON_SUCCESS; // whatever follows is the caller's business
 }
 
-jvalue* json_search_by_key(const char* key, const jvalue* obj)
+// read the next member of the object in frame and add it, leaving *value as the jvalue its value goes into
+// with a projection, *value is left NULL if the member was skipped instead
+static int next_member(jparse_frame* frame, char** cursor, jvalue** value)
 {
-    jmember* here = obj->members;
-    while(here != NULL)
+    const jctx* ctx = &frame->ctx;
+    char* key;
+    char* key_end;
+    int escaped = 0;
+    *value = NULL;
+    if(read_key(ctx, cursor, &key, &key_end, &escaped)) return JSON_FAILURE;
+    if(ctx->projection != NULL)
     {
-        if(!strcmp(here->string, key)) return here->element;
-        here = here->next;
+        jctx member_ctx = *ctx;
+        int keep;
+        if(project_member(ctx, cursor, key, key_end, escaped, &member_ctx, &keep)) return JSON_FAILURE;
+        if(!keep) return JSON_SUCCESS;
+        frame->item_projection = member_ctx.projection;
+        frame->item_node = member_ctx.node;
     }
-    return NULL;
+    // added before it's filled in, so the caller can free whatever a failure leaves behind
+    jmember* member = jctx_append(ctx, frame->value, &frame->capacity);
+    if(member == NULL) return JSON_FAILURE;
+    member->key = ctx_key(ctx, key, key_end, escaped, &member->flags); // copy in the key
+    if(member->key == NULL) return JSON_FAILURE;
+    *value = &member->value;
+    return JSON_SUCCESS;
 }
 
-// delete the first instance of a member with a certain key from an object
-// returns JSON_FAILURE on failure, JSON_SUCCESS on success
-int json_delete_first_member(const char* key, jvalue* obj)
+// find where the next value goes: in the innermost open container, after a comma (or right after its opening bracket,
+// if it was just opened), closing every container that ends on the way
+// *value is left NULL once the outermost container is closed
+static int next_value(jparse_stack* stack, char** cursor, int opened, jvalue** value)
 {
-    if(obj->type != JSON_OBJECT) return JSON_FAILURE;
-    jmember* prev = NULL;
-    jmember* curr = obj->members;
-    while(curr != NULL && strcmp(key, curr->string) != 0) // as long as we're not at the end of the object and key and current string don't match
+    *value = NULL;
+    while(stack->depth > 0)
     {
-        prev = curr; // continue on to the next object
-        curr = curr->next;
+        jparse_frame* frame = &stack->frames[stack->depth - 1];
+        const jctx* ctx = &frame->ctx;
+        const int object = frame->value->type == JSON_OBJECT;
+        if(!opened)
+        {
+            skip_space(cursor, ctx->end); // skip until the next thing
+            if(at(ctx, *cursor, object ? '}' : ']')) // stop when encountering a closing bracket
+            {
+                (*cursor)++; // continue to the next thing
+                if(jctx_finish(ctx, frame->value, frame->capacity)) return JSON_FAILURE;
+                stack->depth--;
+                continue;
+            }
+            if(!at(ctx, *cursor, ',')) return JSON_FAILURE; // fail when not finding a comma
+            (*cursor)++; // increment the cursor
+        }
+        opened = 0;
+        if(!object)
+        {
+            if(ctx->projection != NULL)
+            {
+                jctx element_ctx = *ctx;
+                int keep;
+                const size_t node = jpaths_element(ctx->projection, ctx->node, frame->position++);
+                if(project_value(ctx, cursor, node, &element_ctx, &keep)) return JSON_FAILURE;
+                if(!keep) continue; // skipped, on to whatever follows it
+                frame->item_projection = element_ctx.projection;
+                frame->item_node = element_ctx.node;
+            }
+            *value = jctx_append(ctx, frame->value, &frame->capacity);
+            return *value != NULL ? JSON_SUCCESS : JSON_FAILURE;
+        }
+        if(next_member(frame, cursor, value)) return JSON_FAILURE;
+        if(*value != NULL) return JSON_SUCCESS;
+        // the projection skipped that member, so on to whatever follows it
     }
-    if(curr == NULL) return JSON_SUCCESS; // nothing to delete
-    if(prev == NULL) // have to delete the first member
-        obj->members = curr->next;
-    else
-        prev->next = curr->next; // have the previous element skip over curr and point to the next element
-    json_free_member(curr);
     return JSON_SUCCESS;
 }
 
-// delete all members with a certain key from an object
-// returns JSON_FAILURE on failure, JSON_SUCCESS on success
-int json_delete_all_members(const char* key, jvalue* obj)
+static int parse_value(const jctx* ctx, char** cursor, jvalue* empty)
 {
-    if(obj->type != JSON_OBJECT) return JSON_FAILURE;
-    jmember* prev = NULL;
-    jmember* curr = obj->members;
-    while(curr != NULL) // go until end of object
+    jparse_frame local[JPARSE_LOCAL_FRAMES];
+    jparse_stack stack = { .frames = local, .capacity = JPARSE_LOCAL_FRAMES, .local = local };
+    const jctx* value_ctx = ctx;
+    jctx projected;
+    jvalue* value = empty;
+    int result;
+    while(1)
     {
-        if(!strcmp(key, curr->string))
+        int opened = 0;
+        result = parse_one(value_ctx, cursor, value, &stack, &opened);
+        if(result == JSON_SUCCESS) result = next_value(&stack, cursor, opened, &value);
+        if(result != JSON_SUCCESS || value == NULL) break;
+        const jparse_frame* frame = &stack.frames[stack.depth - 1];
+        value_ctx = &frame->ctx;
+        if(frame->ctx.projection != NULL) // only projected values need a context of their own
         {
-            if(prev == NULL) // have to delete first element
-                obj->members = curr->next;
-            else // have to delete a given element
-                prev->next = curr->next;
-            jmember* next = curr->next;
-            json_free_member(curr);
-            curr = next;
+            projected = frame->ctx;
+            projected.projection = frame->item_projection;
+            projected.node = frame->item_node;
+            value_ctx = &projected;
         }
-        else
+    }
+    if(stack.frames != local) jfree(stack.frames);
+    return result; // whatever follows is the caller's business
+}
+
+int json_parse_value(char** cursor, jvalue* empty)
+{
+    return json_parse_value_opts(cursor, empty, NULL);
+}
+
+int json_parse_value_arena(char** cursor, jvalue* empty, jarena* arena)
+{
+    if(arena == NULL) return JSON_FAILURE;
+    const jparse_options opts = { .arena = arena };
+    return json_parse_value_opts(cursor, empty, &opts);
+}
+
+int json_parse_value_opts(char** cursor, jvalue* empty, const jparse_options* opts)
+{
+    return jparse_range(*cursor, *cursor + strlen(*cursor), empty, opts, cursor, 0);
+}
+
+int json_parse_n(const char* buffer, size_t length, jvalue* empty, const jparse_options* opts, size_t* consumed)
+{
+    if(buffer == NULL) return JSON_FAILURE;
+    char* stop;
+    // the buffer is only written to for in-situ parses, which need it writable anyway
+    const int result = jparse_range((char*)buffer, buffer + length, empty, opts, &stop, consumed != NULL);
+    if(consumed != NULL) *consumed = stop - buffer;
+    return result;
+}
+
+void json_documents_init(jdocuments* docs, const char* buffer, size_t length, const jparse_options* opts)
+{
+    docs->cursor = (char*)buffer; // only written to for in-situ parses, like json_parse_n
+    docs->end = buffer + length;
+    docs->opts = opts != NULL ? *opts : (jparse_options){ 0 };
+}
+
+int json_documents_next(jdocuments* docs, jvalue* empty)
+{
+    skip_space(&docs->cursor, docs->end);
+    if(docs->cursor == docs->end) return JSON_DOCUMENTS_END;
+    return jparse_range(docs->cursor, docs->end, empty, &docs->opts, &docs->cursor, 1);
+}
+
+int jparse_range(char* start, const char* end, jvalue* empty, const jparse_options* opts, char** stop, int partial)
+{
+    jctx ctx = { .end = end };
+    if(opts != NULL)
+    {
+        ctx.arena = opts->arena;
+        ctx.flags = opts->flags & ~JCTX_DEFER;
+        ctx.error = opts->error;
+        ctx.projection = opts->projection;
+        ctx.max_depth = opts->max_depth;
+        ctx.intern = opts->intern;
+        if(ctx.projection != NULL) ctx.flags &= ~JSON_PARSE_LAZY; // the projection already skips what isn't wanted
+        if(ctx.projection != NULL && jpaths_ends(ctx.projection, 0)) ctx.projection = NULL; // "" wants the whole thing
+    }
+    if(ctx.error != NULL) *ctx.error = (jparse_error){ JSON_ERROR_NONE, 0 };
+    jintern_counts counts = { 0 };
+    ctx.intern_counts = &counts;
+    char* cursor = start;
+    int result = parse_value(&ctx, &cursor, empty);
+    jintern_flush(ctx.intern, &counts); // whatever made it into the tree (and a failed parse's keys, which is close enough)
+    if(result == JSON_SUCCESS)
+    {
+        skip_space(&cursor, end);
+        // the one check for the end of the whole document: if there's still something that isn't whitespace, the input is malformed
+        if(!partial && cursor != end) result = JSON_FAILURE;
+    }
+    if(result != JSON_SUCCESS && ctx.error != NULL)
+    {
+        if(ctx.error->code == JSON_ERROR_NONE) ctx.error->code = JSON_ERROR_SYNTAX;
+        ctx.error->offset = cursor - start;
+    }
+    if(stop != NULL) *stop = cursor;
+    return result;
+}
+
+// turn a packed array into the jvalues it stands for (in its arena, if it came from one)
+static int unpack(jvalue* v)
+{
+    const jctx ctx = { .arena = v->arena };
+    jvalue* elements = jctx_alloc(&ctx, v->length * sizeof(jvalue));
+    if(elements == NULL) return JSON_FAILURE;
+    const unsigned int flags = v->flags & JSON_FLAG_ARENA;
+    for(size_t i = 0; i < v->length; i++)
+    {
+        jvalue* e = &elements[i];
+        e->type = JSON_NUMBER;
+        e->flags = flags;
+        if(v->flags & JSON_FLAG_INTEGER)
         {
-            prev = curr; // advance to next element FIXME: this looks bugged
-            curr = curr->next;
+            e->flags |= JSON_FLAG_INTEGER;
+            e->integer = v->integers[i];
+            e->number = (double)e->integer;
         }
+        else e->number = v->numbers[i];
     }
+    if(ctx.arena == NULL) jfree(v->numbers);
+    v->elements = elements;
+    v->lazy = NULL; // same slot as arena
+    v->flags = flags;
     return JSON_SUCCESS;
 }
 
-// add a member to an object (prepends)
-// returns JSON_FAILURE on failure, JSON_SUCCESS on success
-int json_add_member(const char* key, jvalue* element, jvalue* obj)
+// parse one level of a lazy container (which may come out packed)
+int jparse_lazy(jvalue* v)
 {
-    if(obj->type != JSON_OBJECT) return JSON_FAILURE;
-    jmember* new_member = calloc(1, sizeof(jmember));
-    if(new_member == NULL) return JSON_FAILURE;
-    new_member->string = calloc(strlen(key) + 1, 1);
-    if(new_member->string == NULL)
+    jlazy* lazy = v->lazy;
+    jintern_counts counts = { 0 };
+    const jctx ctx = { .arena = lazy->arena, .flags = lazy->flags, .end = lazy->end, .intern = lazy->intern,
+                       .intern_counts = &counts };
+    // parse next to v, so a malformed span leaves v lazy (and intact) instead of half-built
+    jvalue parsed = { 0 };
+    char* cursor = lazy->start;
+    const int result = parse_value(&ctx, &cursor, &parsed);
+    jintern_flush(ctx.intern, &counts);
+    if(result)
     {
-        free(new_member);
+        if(ctx.arena == NULL) release(&parsed);
         return JSON_FAILURE;
     }
-    strcpy(new_member->string, key);
-    new_member->element = element;
-    new_member->next = obj->members;
-    obj->members = new_member;
+    *v = parsed;
+    if(ctx.arena == NULL) jfree(lazy);
     return JSON_SUCCESS;
 }
 
-// calculate how many characters are needed to print a json value - newlines and whitespace included (but not the null)
-// newline after every opening bracket and every comma
-// returns -1 on failure (null pointer)
-static unsigned long jvallen(const jvalue* val)
+int json_materialize(jvalue* v)
 {
-    if(val == NULL) return -1;
-    unsigned long length = -1;
-    char buf[256];
-    switch(val->type)
-    {
-        case JSON_OBJECT:
-            length = 2; // {\n
-            const jmember* now = val->members;
-            while(now != NULL)
-            {
-                length += strlen(now->string) + 5 + jvallen(now->element) + (now->next != NULL ? 2 : 0); // "(string)" : (length of value) (,\n if there's another member coming)(5 + strlen + vallen + maybe 2)
-                now = now->next; 
-            }
-            length += 2; // }\n
-            break;
-        case JSON_ARRAY:
-            length = 2;
-            for(int i = 0; val->elements[i] != NULL; i++)
-                length += jvallen(val->elements[i]) + (val->elements[i + 1] != NULL ? 2 : 0); // same concept as for objects
-            length += 2; // ]\n
-            break;
-        case JSON_STRING:
-            length = strlen(val->string) + 2;
-            break;
-        case JSON_NUMBER:
-            sprintf(buf, "%g", val->number);
-            length = strlen(buf);
-            break;
-        case JSON_BOOL:
-            length = val->boolean ? 4 : 5;
-            break;
-        case JSON_NULL:
-            length = 4;
-            break;
+    if(v == NULL || !(v->flags & (JSON_FLAG_LAZY | JSON_FLAG_PACKED))) return JSON_SUCCESS;
+    if((v->flags & JSON_FLAG_LAZY) && jparse_lazy(v)) return JSON_FAILURE;
+    return (v->flags & JSON_FLAG_PACKED) ? unpack(v) : JSON_SUCCESS;
+}
 
-        default:
-            break;
+size_t json_length(const jvalue* v)
+{
+    if(v == NULL || (v->type != JSON_OBJECT && v->type != JSON_ARRAY)) return 0;
+    if((v->flags & JSON_FLAG_LAZY) && jparse_lazy((jvalue*)v)) return 0; // packed arrays stay that way, they know their length
+    return v->length;
+}
+
+// arr's packed block if its flags (among PACKED and INTEGER) are as wanted, parsing it first if it's lazy
+static void* packed_block(const jvalue* arr, unsigned int wanted)
+{
+    if(arr == NULL || arr->type != JSON_ARRAY) return NULL;
+    if((arr->flags & JSON_FLAG_LAZY) && jparse_lazy((jvalue*)arr)) return NULL;
+    return (arr->flags & (JSON_FLAG_PACKED | JSON_FLAG_INTEGER)) == wanted ? arr->integers : NULL;
+}
+
+int64_t* json_array_integers(const jvalue* arr)
+{
+    return packed_block(arr, JSON_FLAG_PACKED | JSON_FLAG_INTEGER);
+}
+
+double* json_array_doubles(const jvalue* arr)
+{
+    return packed_block(arr, JSON_FLAG_PACKED);
+}
+
+jvalue* json_array_at(const jvalue* arr, size_t i)
+{
+    if(arr == NULL || arr->type != JSON_ARRAY || json_materialize((jvalue*)arr) || i >= arr->length) return NULL;
+    return &arr->elements[i];
+}
+
+jmember* json_member_at(const jvalue* obj, size_t i)
+{
+    if(obj == NULL || obj->type != JSON_OBJECT || json_materialize((jvalue*)obj) || i >= obj->length) return NULL;
+    return &obj->members[i];
+}
+
+// does the member have key, which is interned (pointers only have to be compared for keys from the same table,
+// keys from another one are told apart by their hash before falling back on comparing them)
+static int has_interned(const jmember* m, const char* key, uint64_t hash)
+{
+    if(m->key == key) return 1;
+    if((m->flags & JSON_FLAG_INTERNED) && jintern_hash(m->key) != hash) return 0;
+    return !strcmp(m->key, key);
+}
+
+// position of the first member with key (which is interned if interned is set), or JINDEX_NONE
+static size_t find_member(const jvalue* obj, const char* key, int interned)
+{
+    const uint64_t hash = interned ? jintern_hash(key) : 0;
+    if(obj->index != NULL)
+        return interned ? jindex_find_hashed(obj->index, obj->members, key, hash) : jindex_find(obj->index, obj->members, key);
+    for(size_t i = 0; i < obj->length; i++)
+    {
+        if(interned ? has_interned(&obj->members[i], key, hash) : !strcmp(obj->members[i].key, key))
+        {
+            // a long walk means a wide object, index it so the next lookup doesn't have to walk again
+            // (arena-backed objects can't grow new memory after the fact, they only get indexed by JSON_PARSE_INDEX)
+            if(i >= JINDEX_MIN_MEMBERS && !(obj->flags & JSON_FLAG_ARENA))
+                ((jvalue*)obj)->index = jindex_build(obj->members, obj->length, NULL); // just a cache, failing to build it is fine
+            return i;
+        }
     }
+    if(obj->length >= JINDEX_MIN_MEMBERS && !(obj->flags & JSON_FLAG_ARENA))
+        ((jvalue*)obj)->index = jindex_build(obj->members, obj->length, NULL);
+    return JINDEX_NONE;
+}
+
+jvalue* json_search_by_key(const char* key, const jvalue* obj)
+{
+    if(json_materialize((jvalue*)obj)) return NULL; // lookups are the point where lazy objects get parsed
+    const size_t found = find_member(obj, key, 0);
+    return found != JINDEX_NONE ? &obj->members[found].value : NULL;
+}
 
-    return length;
+jvalue* json_search_interned(const char* key, const jvalue* obj)
+{
+    if(json_materialize((jvalue*)obj)) return NULL;
+    const size_t found = find_member(obj, key, 1);
+    return found != JINDEX_NONE ? &obj->members[found].value : NULL;
 }
 
-// remember to free what this returns!
-char* json_jval_to_str(const jvalue* val)
+// take the member at position out of obj (freeing it), moving the ones after it down
+static void remove_member(jvalue* obj, size_t position)
 {
-    if(val == NULL) return NULL;
-    char* out = calloc(jvallen(val) + 1, 1);
-    if(out == NULL) return NULL;
+    jmember* m = &obj->members[position];
+    if(!(m->flags & (JSON_FLAG_BORROWED | JSON_FLAG_INTERNED))) jfree(m->key);
+    release(&m->value);
+    memmove(m, m + 1, (obj->length - position - 1) * sizeof(jmember));
+    obj->length--;
+}
 
-    char* pos = out;
-    switch(val->type)
+// delete the first instance of a member with a certain key from an object
+// returns JSON_FAILURE on failure, JSON_SUCCESS on success
+int json_delete_first_member(const char* key, jvalue* obj)
+{
+    if(obj->type != JSON_OBJECT || (obj->flags & JSON_FLAG_ARENA) || json_materialize(obj)) return JSON_FAILURE;
+    const size_t found = find_member(obj, key, 0);
+    if(found == JINDEX_NONE) return JSON_SUCCESS; // nothing to delete
+    if(obj->index != NULL) // the next member with the same key (if any) is now the first one
     {
-        case JSON_OBJECT:
-            sprintf(pos, "{\n");
-            pos += 2;
-            jmember* now = val->members;
-            while(now != NULL)
-            {
-                char* inner = json_jval_to_str(now->element); // TODO: this is probably slow - going over a lot of strings a lot of times. not to mention the memory issues from recursive parsing!
-                sprintf(pos, "\"%s\" : %s%s", now->string, inner, now->next != NULL ? ",\n" : "");
-                pos += strlen(now->string) + 5 + strlen(inner) + (now->next != NULL ? 2 : 0);
-                free(inner);
-                now = now->next;
-            }
-            sprintf(pos, "\n}");
-            pos += 2;
-            break;
-        case JSON_ARRAY:
-            sprintf(pos, "[\n");
-            pos += 2;
-            for(int i = 0; val->elements[i] != NULL; i++)
-            {
-                char* inner = json_jval_to_str(val->elements[i]);
-                sprintf(pos, "%s%s", inner, val->elements[i + 1] != NULL ? ",\n" : "");
-                pos += strlen(inner) + (val->elements[i + 1] != NULL ? 2 : 0);
-                free(inner);
-            }
-            sprintf(pos, "\n]");
-            pos += 2;
-            break;
-        case JSON_STRING:
-            sprintf(out, "\"%s\"", val->string);
-            break;
-        case JSON_NUMBER:
-            sprintf(out, "%g", val->number);
-            break;
-        case JSON_BOOL:
-            strcpy(out, val->boolean ? "true" : "false");
-            break;
-        case JSON_NULL:
-            strcpy(out, "null");
-            break;
-        default:
-            break;
+        size_t next = found + 1;
+        while(next < obj->length && strcmp(key, obj->members[next].key) != 0) next++;
+        jindex_replace(obj->index, obj->members, key, next < obj->length ? next : JINDEX_NONE);
+        jindex_shift(obj->index, found + 1, -1);
     }
-    return out;
+    remove_member(obj, found);
+    return JSON_SUCCESS;
+}
+
+// delete all members with a certain key from an object
+// returns JSON_FAILURE on failure, JSON_SUCCESS on success
+int json_delete_all_members(const char* key, jvalue* obj)
+{
+    if(obj->type != JSON_OBJECT || (obj->flags & JSON_FLAG_ARENA) || json_materialize(obj)) return JSON_FAILURE;
+    size_t kept = 0;
+    for(size_t i = 0; i < obj->length; i++)
+    {
+        jmember* m = &obj->members[i];
+        if(!strcmp(key, m->key))
+        {
+            if(!(m->flags & (JSON_FLAG_BORROWED | JSON_FLAG_INTERNED))) jfree(m->key);
+            release(&m->value);
+        }
+        else obj->members[kept++] = *m; // close the gap as we go
+    }
+    if(kept == obj->length) return JSON_SUCCESS;
+    obj->length = kept;
+    if(obj->index != NULL) // everything after the first deleted member moved, easier to start over
+    {
+        jindex_free(obj->index);
+        obj->index = jindex_build(obj->members, obj->length, NULL); // it's only a cache, NULL is fine
+    }
+    return JSON_SUCCESS;
+}
+
+// add a member to an object (appends, or goes just ahead of the first member with the same key)
+// returns JSON_FAILURE on failure, JSON_SUCCESS on success
+int json_add_member(const char* key, jvalue* element, jvalue* obj)
+{
+    if(obj->type != JSON_OBJECT || (obj->flags & JSON_FLAG_ARENA) || json_materialize(obj)) return JSON_FAILURE;
+    // a key that's already there has to be the first match from now on, anything new just goes on the end
+    // (the lookup indexes wide objects, so building one a member at a time stays linear)
+    const size_t shadowed = find_member(obj, key, 0);
+    const size_t position = shadowed != JINDEX_NONE ? shadowed : obj->length;
+    char* copy = jmalloc(strlen(key) + 1);
+    if(copy == NULL) return JSON_FAILURE;
+    strcpy(copy, key);
+    jmember* members = jrealloc(obj->members, (obj->length + 1) * sizeof(jmember));
+    if(members == NULL)
+    {
+        jfree(copy);
+        return JSON_FAILURE;
+    }
+    memmove(members + position + 1, members + position, (obj->length - position) * sizeof(jmember));
+    members[position] = (jmember){ .key = copy, .value = *element };
+    obj->members = members;
+    obj->length++;
+    jfree(element); // its contents live in the member now
+    if(obj->index != NULL)
+    {
+        if(position + 1 < obj->length) jindex_shift(obj->index, position, 1);
+        if(jindex_put(obj->index, obj->members, position) != JSON_SUCCESS)
+        {
+            jindex_free(obj->index); // can't keep it in sync, drop it (it'll be rebuilt on a later lookup)
+            obj->index = NULL;
+        }
+    }
+    return JSON_SUCCESS;
 }
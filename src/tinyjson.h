@@ -1,6 +1,9 @@
 #ifndef TINYJSON_HEADER
 #define TINYJSON_HEADER
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define JSON_SUCCESS 0
 #define JSON_FAILURE 1
 
@@ -16,22 +19,66 @@ enum JSON_TYPES {
 typedef struct jvalue jvalue;
 typedef struct jmember jmember;
 typedef struct jnumber jnumber;
+typedef struct jarena jarena;
+typedef struct jindex jindex;
+typedef struct jparser jparser;
+typedef struct jtape jtape;
+typedef struct jlazy jlazy;
+typedef struct jmapping jmapping;
+typedef struct jpointer jpointer;
+typedef struct jpaths jpaths;
+typedef struct jintern jintern;
+
+// bits for jvalue.flags, these are maintained by the library
+#define JSON_FLAG_ARENA 0x1 // the value (and everything under it) lives in an arena
+#define JSON_FLAG_BORROWED 0x2 // the string (or member key) points into the parsed buffer and isn't freed
+#define JSON_FLAG_INTEGER 0x4 // the number was written as an integer that fits in 64 bits, integer holds it exactly
+#define JSON_FLAG_LAZY 0x8 // the container hasn't been parsed yet (see JSON_PARSE_LAZY), lazy holds where it is
+#define JSON_FLAG_INTERNED 0x10 // the member key lives in an intern table (see json_intern_create) and isn't freed
+// the array holds nothing but numbers, packed into integers (with JSON_FLAG_INTEGER) or numbers instead of elements
+// (see JSON_PARSE_PACK_NUMBERS)
+#define JSON_FLAG_PACKED 0x20
 
+// jvalues you build yourself should be zero-initialized (calloc), so flags and index start out empty
+// objects and arrays keep their members and elements side by side in one block, with the count next to them:
+//     for(size_t i = 0; i < obj->length; i++) use obj->members[i].key and obj->members[i].value
+//     for(size_t i = 0; i < arr->length; i++) use arr->elements[i]
+// (or JSON_FOR_EACH_MEMBER/JSON_FOR_EACH_ELEMENT below, which also take care of lazy containers and packed arrays)
+// members used to be a linked list (m->next, m->string, m->element) and elements a null-terminated array of pointers,
+// code written against those becomes one of the loops above
+// growing or shrinking a container (json_add_member, the delete functions) can move everything in it,
+// so pointers to its members and elements don't stay valid across those
 struct jvalue {
     int type;
+    unsigned int flags; // JSON_FLAG_* bits, leave these alone
     union {
-        jmember* members; // objects are linked lists of members (last member points to null)
-        jvalue** elements; // arrays are arrays of pointers to jvalues (terminate with null ptr)
+        struct {
+            union {
+                jmember* members; // objects: length members, in document order
+                jvalue* elements; // arrays: length elements, in document order
+                double* numbers; // packed arrays (JSON_FLAG_PACKED): length numbers, in document order
+                int64_t* integers; // packed arrays with JSON_FLAG_INTEGER: length integers, in document order
+            };
+            size_t length; // how many members or elements there are
+            union {
+                jindex* index; // optional hash index over members (objects, built by the library, NULL if there is none)
+                jlazy* lazy; // unparsed source of a JSON_FLAG_LAZY object or array (length is 0 until it's parsed)
+                jarena* arena; // packed arrays: the arena their numbers came from (NULL if they're malloc'd)
+            };
+        };
         char* string;
-        double number;
+        struct {
+            double number; // always set for numbers
+            int64_t integer; // only meaningful with JSON_FLAG_INTEGER
+        };
         int boolean; // true is 1, false is 0
     };
 };
 
 struct jmember {
-    char* string; // members contain a string and a pointer to an element, and a pointer to the next member in the object
-    jvalue* element;
-    jmember* next;
+    char* key;
+    unsigned int flags; // JSON_FLAG_* bits for the key, leave these alone
+    jvalue value; // stored right in the member, not behind a pointer
 };
 
 struct jnumber {
@@ -39,38 +86,428 @@ struct jnumber {
     double value; // actual value of the number
 };
 
-// print a json value to stdout (uses printf)
+// print a json value to stdout (pretty, followed by a newline)
+// prints nothing if v can't be written (see json_write_value)
 void json_print_value(const jvalue* v);
 
 // free the memory associated with a jvalue
 // also frees all members/elements of the value if it's an array or object
 void json_free_value(jvalue* v);
 
-// parse a json value from a string, and leave the cursor on the first character after that value
+// parse a json value from a string, and leave the cursor after that value (and any whitespace following it)
+// the string must hold exactly one value, only whitespace may follow it (json_documents_next parses several in a row)
 // cursor should be the address of the beginning of a string (eg char** cursor = &str)
-// empty MUST be a previously malloc'd jvalue (will be filled)
+// empty MUST be a jvalue from json_malloc or json_calloc (will be filled)
 // returns JSON_FAILURE on fail (due to syntax or memory errors)
-// regardless of success or failure, the caller is expected to allocate (using malloc(sizeof(jvalue))) and free empty (using json_free_value)
+// regardless of success or failure, the caller is expected to allocate (using json_malloc(sizeof(jvalue))) and free empty (using json_free_value)
 int json_parse_value(char** cursor, jvalue* empty);
 
+// allocator hooks: every allocation the library makes (nodes, strings, arena blocks, parser state...) and every free
+// goes through these, so a drop-in allocator (jemalloc arenas, a tracking allocator, json_pool_allocator below) sees all of it
+typedef struct jallocator {
+    void* (*allocate)(void* user, size_t size);
+    void* (*resize)(void* user, void* ptr, size_t size); // ptr may be NULL (allocate size then)
+    void (*release)(void* user, void* ptr); // ptr may be NULL (do nothing then)
+    void* user; // passed to all of them
+} jallocator;
+// use allocator from now on (NULL goes back to malloc, realloc and free), it's copied
+// not thread safe, set it before anything is allocated, and don't free memory from one allocator with another
+// while hooks are set, values you build yourself and hand to the library (json_add_member, json_free_value...) have to
+// come from json_malloc or json_calloc, and everything the library hands back (json_write_to_str, arrays of values...)
+// is freed with json_free
+void json_set_allocator(const jallocator* allocator);
+void* json_malloc(size_t size);
+void* json_calloc(size_t count, size_t size);
+void* json_realloc(void* ptr, size_t size);
+void json_free(void* ptr);
+// a ready-made allocator on top of malloc, for code that builds and tears down trees a node at a time:
+// blocks up to 4KiB come in power of two size classes kept on per-thread freelists, so most allocations and frees
+// take neither a lock nor a trip to malloc, and containers that grow a member at a time rarely move
+// json_set_allocator(&json_pool_allocator);
+extern const jallocator json_pool_allocator;
+
+// arenas hand out memory from large bump-allocated blocks, so a whole parsed document costs a handful of mallocs
+// and is torn down by a single json_arena_reset (or json_arena_destroy)
+// block_size is the size of each block in bytes (0 picks a default of 64KiB)
+// returns NULL on failure
+jarena* json_arena_create(size_t block_size);
+// throw away everything allocated from the arena, keeping its blocks around for reuse
+void json_arena_reset(jarena* arena);
+// free the arena and all of its blocks
+void json_arena_destroy(jarena* arena);
+// allocate size zeroed bytes from the arena (never free these individually)
+// returns NULL on failure
+void* json_arena_alloc(jarena* arena, size_t size);
+
+// same as json_parse_value, but every node, key and string of the parsed value is carved out of arena
+// empty may come from anywhere (json_arena_alloc(arena, sizeof(jvalue)) is a good fit)
+// do NOT call json_free_value on the result, reset or destroy the arena instead
+// the mutation functions below allocate through the installed allocator, so they fail on arena-backed objects
+int json_parse_value_arena(char** cursor, jvalue* empty, jarena* arena);
+
+// parse flags
+#define JSON_PARSE_INDEX 0x1 // build hash indexes for wide objects while parsing instead of on first lookup
+// parse in-situ: strings and keys are terminated inside the input buffer and point straight into it instead of being copied
+// the buffer must be writable, is modified by the parse, and must outlive the parsed value
+// (json_free_value knows not to free these strings)
+#define JSON_PARSE_INSITU 0x2
+// parse lazily: only the top level value is parsed, nested objects and arrays are just matched bracket to bracket
+// and left as JSON_FLAG_LAZY spans of the input, which are parsed a level at a time when a lookup helper first touches them
+// (json_search_by_key, json_array_at, the delete/add functions, the writers, or json_materialize directly)
+// the input must outlive the parsed value, and syntax errors inside a span only show up when it's parsed (as a failed lookup)
+#define JSON_PARSE_LAZY 0x4
+// reject strings and keys that aren't valid utf-8 (a JSON_ERROR_UTF8 error, see jparse_error)
+// checked along with the string scan, costs next to nothing on ascii
+#define JSON_PARSE_VALIDATE_UTF8 0x8
+// pack arrays made of nothing but numbers into a plain block of int64_t (if every one of them is an integer that fits)
+// or double, 8 bytes a number instead of a jvalue each (JSON_FLAG_PACKED, see json_array_integers and json_array_doubles)
+// integers in an array that also holds other numbers become doubles, so they're written back out as doubles
+// anything that needs the elements as jvalues (json_array_at, JSON_FOR_EACH_ELEMENT, pointers) unpacks the array first
+#define JSON_PARSE_PACK_NUMBERS 0x10
+
+// what went wrong with a failed parse
+#define JSON_ERROR_NONE 0
+#define JSON_ERROR_SYNTAX 1 // malformed input (or out of memory)
+#define JSON_ERROR_UTF8 2 // a string or key that isn't valid utf-8 (with JSON_PARSE_VALIDATE_UTF8)
+#define JSON_ERROR_DEPTH 3 // objects and arrays nested deeper than max_depth
+typedef struct jparse_error {
+    int code; // JSON_ERROR_*
+    size_t offset; // bytes from the start of the input to where the parse gave up (for utf-8, the first byte of the bad sequence)
+} jparse_error;
+
+#define JSON_MAX_DEPTH 1024
+
+// intern tables keep one copy of every distinct member key, shared by every parse that's given the table
+// (documents with the same shape then cost no memory for their keys past the first), and lookups with an interned
+// key compare pointers instead of strings
+// any number of threads can parse with the same table at once, it only ever grows until it's destroyed,
+// which has to wait until no value refers to it any more (values that use it are freed as usual)
+// returns NULL on failure
+jintern* json_intern_create(void);
+void json_intern_destroy(jintern* table);
+// the interned copy of key (added if it isn't there yet), for json_search_interned
+// returns NULL on failure
+const char* json_intern(jintern* table, const char* key);
+typedef struct jintern_stats {
+    size_t keys; // distinct keys in the table
+    size_t bytes; // memory the table holds, keys and bookkeeping
+    size_t references; // member keys parses have pointed at the table so far
+    size_t referenced_bytes; // what those keys would have cost as copies of their own (without malloc overhead)
+} jintern_stats;
+// a snapshot of how much the table holds, and how much it saved (referenced_bytes - bytes)
+void json_intern_stats(jintern* table, jintern_stats* stats);
+
+// everything about a parse that isn't the input or the output
+// zero-initialize and set what you need (jparse_options opts = {0};)
+typedef struct jparse_options {
+    unsigned int flags; // JSON_PARSE_* flags
+    jarena* arena; // if not NULL, the value is parsed into this arena (see json_parse_value_arena)
+    jparse_error* error; // if not NULL, filled in by every parse (JSON_ERROR_NONE on success)
+    // if not NULL, only build the members these paths go through (see json_paths_compile), everything else is skipped
+    // without being allocated or checked beyond matching brackets and quotes (JSON_PARSE_LAZY is ignored)
+    // array elements are picked by index like json_paths_get picks them, and scalars where a path goes further are dropped
+    const jpaths* projection;
+    // deepest nesting of objects and arrays to accept, 0 means JSON_MAX_DEPTH
+    // nesting never costs C stack (the parser keeps its own), this just keeps hostile input from eating memory
+    size_t max_depth;
+    // if not NULL, member keys are interned here instead of being copied (this takes precedence over JSON_PARSE_INSITU
+    // for keys), the table has to outlive the value
+    jintern* intern;
+} jparse_options;
+
+// same as json_parse_value, with options (opts may be NULL for defaults)
+int json_parse_value_opts(char** cursor, jvalue* empty, const jparse_options* opts);
+// parse length bytes of buffer, which doesn't need to be null-terminated (a slice of a bigger buffer is fine)
+// nothing past buffer + length is ever read, and with JSON_PARSE_INSITU the buffer has to be writable
+// if consumed is NULL, nothing but whitespace may follow the value
+// otherwise anything may follow it, and consumed receives the bytes taken by the value and the whitespace after it
+// (so the next value of a concatenated stream starts at buffer + *consumed)
+int json_parse_n(const char* buffer, size_t length, jvalue* empty, const jparse_options* opts, size_t* consumed);
+
+// iterate over a buffer of concatenated (or whitespace/newline separated) values, parsing one at a time
+// jdocuments docs;
+// json_documents_init(&docs, buffer, length, &opts);
+// while((result = json_documents_next(&docs, empty)) == JSON_SUCCESS) { ... }
+// the buffer (which doesn't need to be null-terminated) has to stay around while you iterate, and for as long as
+// the values need it with JSON_PARSE_INSITU or JSON_PARSE_LAZY
+typedef struct jdocuments {
+    char* cursor; // where the next value starts (or where the last one went wrong)
+    const char* end;
+    jparse_options opts;
+} jdocuments;
+#define JSON_DOCUMENTS_END 2 // no values left (only whitespace was)
+// opts may be NULL for defaults
+void json_documents_init(jdocuments* docs, const char* buffer, size_t length, const jparse_options* opts);
+// parse the next value into empty (which is the caller's to allocate and free, as with json_parse_value)
+// returns JSON_SUCCESS, JSON_DOCUMENTS_END when there's nothing left, or JSON_FAILURE on a malformed value
+// (there's no telling where the next value would start after that, so stop there)
+int json_documents_next(jdocuments* docs, jvalue* empty);
+
+// parse the file at path, which is memory-mapped instead of read (so there's no copy, and no null terminator needed)
+// JSON_PARSE_INSITU and JSON_PARSE_LAZY are ignored, the file is unmapped before this returns
+// nothing but whitespace may follow the value
+// returns JSON_FAILURE if the file can't be mapped or doesn't parse
+int json_parse_file(const char* path, jvalue* empty, const jparse_options* opts);
+// map a file yourself to keep it around while values point into it (in-situ strings, lazy spans)
+// the mapping is private: in-situ parsing writes to it, but never to the file
+// returns NULL on failure
+jmapping* json_map_file(const char* path);
+// the mapped bytes (NOT null-terminated) and how many there are
+char* json_mapping_data(const jmapping* map);
+size_t json_mapping_length(const jmapping* map);
+// parse the whole mapping, any flags allowed (unmap only once you're done with the value)
+int json_parse_mapping(const jmapping* map, jvalue* empty, const jparse_options* opts);
+void json_unmap_file(jmapping* map);
+
+// push parsing: feed the input a chunk at a time as it arrives (from a socket, a pipe, a file read in pieces...)
+// chunks can be split anywhere, even in the middle of a string or number, and the result is the same
+// tree json_parse_value_opts builds from the whole input at once (JSON_PARSE_INSITU and JSON_PARSE_LAZY are ignored,
+// since nothing can point into chunks that come and go, and opts->error isn't filled in)
+// empty is filled in as the parse goes, and is yours to free (or not, if it's in an arena) like with json_parse_value
+// unlike json_parse_value, nothing but whitespace may follow the value
+// returns NULL on failure
+jparser* jparser_create(jvalue* empty, const jparse_options* opts);
+// parse the next length bytes of input
+// returns JSON_FAILURE as soon as the input can't be valid JSON (or memory runs out), the parser is dead after that
+int jparser_feed(jparser* p, const char* chunk, size_t length);
+// there is no more input: returns JSON_SUCCESS if everything fed so far was exactly one complete value
+int jparser_finish(jparser* p);
+// free the parser (not the value it built)
+void jparser_destroy(jparser* p);
+
+// event parsing (SAX): instead of building a tree, the parser calls back into a jevents as it goes
+// there is no per-node allocation, memory use only grows with nesting depth
+// strings and keys are decoded (like everywhere else), but not null-terminated, and only valid during the call
+// numbers come with their double value, and also the exact integer if is_integer is set (see JSON_FLAG_INTEGER)
+// callbacks left NULL are simply not called
+// every callback returns one of:
+//   JSON_SUCCESS to keep going
+//   JSON_FAILURE to abort the parse (which then fails)
+//   JSON_EVENT_STOP to end the parse early (which then succeeds, without looking at the rest of the input)
+//   JSON_EVENT_SKIP from start_object/start_array to skip the rest of that container (its end event isn't called either),
+//   or from key to skip that member's value - the skipped input is still checked, but no events are delivered for it
+//   (from any other callback, JSON_EVENT_SKIP is the same as JSON_SUCCESS)
+#define JSON_EVENT_STOP 2
+#define JSON_EVENT_SKIP 3
+typedef struct jevents {
+    int (*start_object)(void* user);
+    int (*end_object)(void* user);
+    int (*start_array)(void* user);
+    int (*end_array)(void* user);
+    int (*key)(void* user, const char* key, size_t length);
+    int (*string)(void* user, const char* string, size_t length);
+    int (*number)(void* user, double number, int64_t integer, int is_integer);
+    int (*boolean)(void* user, int boolean);
+    int (*null)(void* user);
+} jevents;
+
+// parse the null-terminated text, calling events (with user) along the way
+// nothing but whitespace may follow the value, and nesting deeper than JSON_MAX_DEPTH fails
+// returns JSON_FAILURE on a syntax error or if a callback returned JSON_FAILURE, JSON_SUCCESS otherwise
+int json_parse_events(const char* text, const jevents* events, void* user);
+// same, with options (opts may be NULL, its max_depth and JSON_PARSE_VALIDATE_UTF8 are honoured)
+int json_parse_events_opts(const char* text, const jevents* events, void* user, const jparse_options* opts);
+// a push parser (see jparser_create) that calls events instead of building a tree, nested at most JSON_MAX_DEPTH deep
+// jparser_feed returns JSON_SUCCESS without looking at the chunk once a callback has stopped the parse
+jparser* jparser_create_events(const jevents* events, void* user);
+
+// tapes are a read-only alternative to the jvalue tree: the whole document lives in one contiguous array of
+// 64-bit entries (plus one buffer for all of its strings), so walking it never chases pointers across the heap
+// nodes are indexes into the tape, the root is JSON_TAPE_ROOT and JSON_TAPE_NONE means there's no such node
+// skipping over any value (even a huge container) and the length of any container are O(1)
+#define JSON_TAPE_ROOT ((size_t)0)
+#define JSON_TAPE_NONE ((size_t)-1)
+// parse null-terminated text into a tape (strings are decoded, like everywhere else)
+// returns NULL on failure
+jtape* json_tape_parse(const char* text);
+// flatten an existing tree into a tape
+// returns NULL on failure
+jtape* json_tape_from_value(const jvalue* val);
+// build a tree from node (and everything under it) into empty, which is treated like in json_parse_value_opts
+// (opts may be NULL, its arena and JSON_PARSE_INDEX are honoured)
+int json_tape_to_value(const jtape* tape, size_t node, jvalue* empty, const jparse_options* opts);
+void json_tape_free(jtape* tape);
+// JSON_* type of node, or -1 if it isn't a node
+int json_tape_type(const jtape* tape, size_t node);
+// index just past node and everything under it (which is where the next node starts, if there is one)
+size_t json_tape_skip(const jtape* tape, size_t node);
+// first child of an array or object, and the node after a child in its container
+// in an object the children alternate between keys (strings) and their values
+size_t json_tape_child(const jtape* tape, size_t node);
+size_t json_tape_sibling(const jtape* tape, size_t node);
+// number of elements (arrays) or members (objects), 0 for anything else
+size_t json_tape_length(const jtape* tape, size_t node);
+// i-th element of an array
+size_t json_tape_index(const jtape* tape, size_t array, size_t i);
+// value of the first member with this key (non-recursive, like json_search_by_key)
+size_t json_tape_find(const jtape* tape, size_t object, const char* key);
+// the string (null-terminated, valid as long as the tape is), with its length in length if that isn't NULL
+// returns NULL if node isn't a string
+const char* json_tape_string(const jtape* tape, size_t node, size_t* length);
+// value of a number (0 if node isn't a number)
+double json_tape_number(const jtape* tape, size_t node);
+// exact value of an integer (see JSON_FLAG_INTEGER)
+// returns JSON_FAILURE if node isn't an integer
+int json_tape_integer(const jtape* tape, size_t node, int64_t* integer);
+// 1 for true, 0 for false (or anything that isn't a boolean)
+int json_tape_boolean(const jtape* tape, size_t node);
+
+// newline-delimited JSON (one document per line), parsed on a pool of threads
+// blank lines are skipped, every other line is a record (numbered from 0 in input order)
+typedef struct jndjson_options {
+    unsigned int threads; // worker threads, the calling thread included (0 uses one per online CPU)
+    unsigned int flags; // JSON_PARSE_* flags for every record (JSON_PARSE_INSITU and JSON_PARSE_LAZY are ignored)
+    const jpaths* projection; // if not NULL, only build these members of every record (see jparse_options)
+    jintern* intern; // if not NULL, every record's keys are interned here (see jparse_options)
+} jndjson_options;
+// called for every record, in input order, from the calling thread
+// value is NULL if the record didn't parse, otherwise it lives in a worker's arena and is only valid during the call
+// return JSON_SUCCESS to keep going, JSON_FAILURE to stop
+typedef int (*json_record_fn)(void* user, size_t record, jvalue* value);
+// parse the length bytes at buffer as NDJSON (opts may be NULL for defaults)
+// returns JSON_SUCCESS if every record parsed and the callback never stopped, JSON_FAILURE otherwise
+int json_parse_ndjson(const char* buffer, size_t length, const jndjson_options* opts, json_record_fn callback, void* user);
+// same, reading the records from a file
+int json_parse_ndjson_file(const char* path, const jndjson_options* opts, json_record_fn callback, void* user);
+// parse every record into an array of *count values, in input order (NULL where a record didn't parse)
+// free each value with json_free_value, then the array with json_free
+// returns NULL on failure
+jvalue** json_parse_ndjson_array(const char* buffer, size_t length, const jndjson_options* opts, size_t* count);
+
+// numbers are parsed with strict JSON grammar and rounded correctly, independent of the locale
+// text must be null-terminated (or at least not end in the middle of a number)
+// on success, end (if not NULL) is left one past the number, on failure it's set to text
+// returns JSON_FAILURE if text doesn't start with a valid number
+int json_number_parse(const char* text, char** end, double* value);
+// write the shortest text that parses back to exactly value into buffer (at least JSON_NUMBER_BUFFER bytes)
+// integral values keep a ".0" (or use an exponent, whichever is shorter) so they read back as doubles
+// returns the length written (no null terminator), or 0 for infinities and nan, which JSON can't represent
+#define JSON_NUMBER_BUFFER 32
+int json_number_format(double value, char* buffer);
+
+// SIMD levels for the structural scanner the parser uses to skip whitespace and string bodies
+#define JSON_SIMD_SCALAR 0
+#define JSON_SIMD_SSE2 1 // x86-64 only
+#define JSON_SIMD_AVX2 2 // x86-64 only
+// by default the best level the CPU supports is picked when the library is loaded, this overrides it
+// (levels the CPU doesn't support are clamped down, all levels give identical results)
+// not thread safe, call it before parsing
+// returns the level now in use
+int json_set_simd_level(int level);
+
+// parse a JSON_FLAG_LAZY container (one level, its own nested containers stay lazy), or unpack a JSON_FLAG_PACKED array
+// into elements, does nothing to anything else
+// call this before reading members or elements of a lazily parsed value (or one parsed with JSON_PARSE_PACK_NUMBERS) directly
+// returns JSON_FAILURE if the span turned out to be malformed (the value stays lazy), or memory runs out
+int json_materialize(jvalue* v);
+
+// number of members of an object or elements of an array (parsing it first if it's lazy, packed arrays stay packed),
+// 0 for anything else
+size_t json_length(const jvalue* v);
+// the json_length(arr) numbers of a packed array (parsing it first if it's lazy), to read (or change) in place
+// returns NULL if arr isn't packed, or holds the other kind (JSON_FLAG_INTEGER says which)
+int64_t* json_array_integers(const jvalue* arr);
+double* json_array_doubles(const jvalue* arr);
+// i-th element of an array (parsing it first if it's lazy, unpacking it if it's packed)
+// returns NULL if arr isn't an array or is too short
+jvalue* json_array_at(const jvalue* arr, size_t i);
+// i-th member of an object, in document order (parsing it first if it's lazy)
+// returns NULL if obj isn't an object or is too short
+jmember* json_member_at(const jvalue* obj, size_t i);
+
+// loop over the members of an object or the elements of an array, in order, parsing it first if it's lazy
+// (and unpacking it if it's packed), the body doesn't run at all for anything else (obj and arr are evaluated more than once)
+// JSON_FOR_EACH_MEMBER(m, obj) { ... m->key, m->value ... }
+// JSON_FOR_EACH_ELEMENT(e, arr) { ... e->type ... }
+#define JSON_FOR_EACH_MEMBER(m, obj) \
+    for(jmember *m = json_member_at(obj, 0), *m##_end = m != NULL ? m + (obj)->length : NULL; m != m##_end; m++)
+#define JSON_FOR_EACH_ELEMENT(e, arr) \
+    for(jvalue *e = json_array_at(arr, 0), *e##_end = e != NULL ? e + (arr)->length : NULL; e != e##_end; e++)
+
 // search for a certain key in a json object (non-recursive)
 // returns NULL if the key didn't exist, returns a pointer to the value associated with the first instance of the key otherwise
 // caller should ensure the jvalue being passed is a properly built object!
+// wide objects get a hash index the first time a lookup has to walk far, making later lookups O(1) on average
+// (this writes to obj, so don't search the same object from several threads at once unless it was parsed with JSON_PARSE_INDEX)
 jvalue* json_search_by_key(const char* key, const jvalue* obj);
+// same, with a key from json_intern: members with interned keys are matched by pointer, without comparing strings
+jvalue* json_search_interned(const char* key, const jvalue* obj);
+
+// json pointers (RFC 6901, eg "/items/3/meta/id", with ~1 for a / and ~0 for a ~ in a key) are compiled once and
+// then looked up in as many trees as you like, without allocating (apart from parsing lazy containers on the way)
+// a token that's a plain number also works as an array index, "" is the whole tree
+// returns NULL if the pointer is malformed (or memory runs out)
+jpointer* json_pointer_compile(const char* pointer);
+// the value ptr points at in root, or NULL if there's no such value
+jvalue* json_pointer_get(const jpointer* ptr, const jvalue* root);
+void json_pointer_free(jpointer* ptr);
+// several pointers at once: one walk of the tree finds all of them, visiting shared prefixes once and scanning
+// every object on the way once for all the keys wanted from it
+// returns NULL if any pointer is malformed (or memory runs out)
+jpaths* json_paths_compile(const char* const* pointers, size_t count);
+// fill out[i] with the value for pointers[i] (NULL for the ones that aren't there)
+// returns how many were found
+size_t json_paths_get(const jpaths* paths, const jvalue* root, jvalue** out);
+void json_paths_free(jpaths* paths);
 
+// none of these work on arena-backed objects (JSON_FLAG_ARENA), they return JSON_FAILURE for those
 // delete the first instance of a member with a certain key from an object
 // returns JSON_FAILURE on failure, JSON_SUCCESS on success
 int json_delete_first_member(const char* key, jvalue* obj);
 // delete all members with a certain key from an object
 // returns JSON_FAILURE on failure, JSON_SUCCESS on success
 int json_delete_all_members(const char* key, jvalue* obj);
-// add a member to an object (prepends)
-// returns JSON_FAILURE on failure, JSON_SUCCESS on success
+// add a member to the end of an object, or just ahead of the first member with the same key if there is one (so it
+// shadows that member, and only the members after it move along)
+// val is moved into the member: its contents are copied over and val itself is freed, so it has to come from json_malloc
+// (and mustn't be used afterwards), the value lives on as json_search_by_key(key, obj)
+// returns JSON_FAILURE on failure (val is left alone then), JSON_SUCCESS on success
 int json_add_member(const char* key, jvalue* val, jvalue* obj);
 
 // allocate and return a pointer to a valid json string representing val
-// output will be valid json, but not necessarily pretty
+// same as json_write_to_str(val, JSON_WRITE_PRETTY, NULL)
 // returns NULL on failure
 char* json_jval_to_str(const jvalue* val);
 
+// serializer flags
+#define JSON_WRITE_COMPACT 0 // no whitespace at all
+#define JSON_WRITE_PRETTY 1 // one member/element per line, indented by four spaces per level
+
+// a sink receives the serialized output in order, a chunk at a time
+// return JSON_SUCCESS to keep going, JSON_FAILURE to abort the write
+typedef int (*json_sink)(void* user, const char* data, size_t length);
+
+// ready-made sinks: user is a FILE* for json_sink_file, and a pointer to an int file descriptor for json_sink_fd
+int json_sink_file(void* file, const char* data, size_t length);
+int json_sink_fd(void* fd, const char* data, size_t length);
+
+// serialize val in a single pass, streaming the output to sink through a small fixed buffer
+// returns JSON_FAILURE if the sink failed or val is malformed (that includes numbers JSON has no spelling for: nan and
+// the infinities), JSON_SUCCESS otherwise; whatever went to the sink before the failure stays there
+int json_write_value(const jvalue* val, int flags, json_sink sink, void* user);
+// serialize val in a single pass into one growable buffer
+// if length isn't NULL, it receives the length of the output (not counting the null terminator)
+// returns NULL on failure, remember to json_free what this returns!
+char* json_write_to_str(const jvalue* val, int flags, size_t* length);
+
+// binary form of a tree, for caching parsed documents: tagged values, varint lengths and counts, and length-prefixed
+// strings, so loading it back needs no scanning, unescaping or number parsing (and the round trip loses nothing)
+// write the binary form of val to sink (see json_write_value)
+int json_binary_write(const jvalue* val, json_sink sink, void* user);
+// the binary form of val in one buffer, *length bytes long
+// returns NULL on failure, remember to json_free what this returns!
+char* json_binary_encode(const jvalue* val, size_t* length);
+// rebuild the tree in length bytes of data into empty, which is treated like in json_parse_value_opts
+// opts may be NULL, its arena and JSON_PARSE_INDEX are honoured, and with JSON_PARSE_INSITU strings and keys point
+// straight into data (which has to outlive the tree, but isn't written to)
+// returns JSON_FAILURE if data isn't a whole, well-formed encoding
+int json_binary_decode(const char* data, size_t length, jvalue* empty, const jparse_options* opts);
+// same, from a file (JSON_PARSE_INSITU is ignored, the file is unmapped before this returns)
+int json_binary_read_file(const char* path, jvalue* empty, const jparse_options* opts);
+// how big an arena block has to be for json_binary_decode with these options to put the whole tree
+// (root jvalue included) in a single allocation: json_arena_create(json_binary_arena_size(...))
+// opts may be NULL, its JSON_PARSE_INSITU and max_depth matter (indexes from JSON_PARSE_INDEX aren't counted)
+// returns 0 if data isn't something json_binary_decode would accept with them
+size_t json_binary_arena_size(const char* data, size_t length, const jparse_options* opts);
+
 #endif
@@ -0,0 +1,199 @@
+#ifndef TINYJSON_INTERNAL_HEADER
+#define TINYJSON_INTERNAL_HEADER
+
+// declarations shared between the library's translation units, not part of the public api
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+// allocation (jalloc.c), the library never calls malloc and friends directly
+// the hooks set by json_set_allocator, all NULL for the C library's own
+extern jallocator jalloc_hooks;
+
+static inline void* jmalloc(size_t size)
+{
+    return jalloc_hooks.allocate != NULL ? jalloc_hooks.allocate(jalloc_hooks.user, size) : malloc(size);
+}
+
+// zeroed
+static inline void* jcalloc(size_t size)
+{
+    if(jalloc_hooks.allocate == NULL) return calloc(1, size);
+    void* ptr = jalloc_hooks.allocate(jalloc_hooks.user, size);
+    if(ptr != NULL) memset(ptr, 0, size);
+    return ptr;
+}
+
+static inline void* jrealloc(void* ptr, size_t size)
+{
+    return jalloc_hooks.resize != NULL ? jalloc_hooks.resize(jalloc_hooks.user, ptr, size) : realloc(ptr, size);
+}
+
+static inline void jfree(void* ptr)
+{
+    if(jalloc_hooks.release != NULL) jalloc_hooks.release(jalloc_hooks.user, ptr);
+    else free(ptr);
+}
+
+// every arena allocation is rounded up to a multiple of this
+#define JARENA_ALIGN 16
+// copy length bytes of s into the arena and null-terminate them
+char* json_arena_strndup(jarena* a, const char* s, size_t length);
+// resize an arena allocation: grows in place when ptr was the last thing allocated, copies otherwise
+// old memory is never given back (that happens on reset)
+void* json_arena_grow(jarena* a, void* ptr, size_t old_size, size_t new_size);
+
+// vectorized scanners (jscan.c), all of them stop at end (and return end if there's nothing to find before it)
+// first byte at or after p that isn't JSON whitespace (space, tab, newline, carriage return)
+const char* jscan_skip_space(const char* p, const char* end);
+// first quote, backslash or null at or after p
+const char* jscan_string_end(const char* p, const char* end);
+// first structural character ({}[],:"), or null, at or after p
+const char* jscan_structural(const char* p, const char* end);
+// first byte at or after p that has to be escaped in JSON output (quote, backslash or control character)
+const char* jscan_escape(const char* p, const char* end);
+// first byte of the first malformed utf-8 sequence at or after p (overlongs, surrogates and anything past U+10FFFF count)
+const char* jscan_utf8(const char* p, const char* end);
+
+// string escapes (jstring.c)
+#define JSTRING_INVALID ((size_t)-1)
+// decode the escapes in the string body [p, end) into out, which may be p itself (decoding never makes a string longer)
+// \u escapes become utf-8, surrogate pairs included, and \u0000 a null byte
+// returns the decoded length (out isn't terminated), or JSTRING_INVALID if an escape is malformed
+size_t jstring_unescape(char* out, const char* p, const char* end);
+
+// numbers (jnumber.c)
+// parse a number with strict JSON grammar, leaving end one past it
+// integers that fit in 64 bits are also returned exactly (is_integer set)
+// returns JSON_FAILURE if p isn't a number
+int jnumber_parse(const char* p, const char** end, double* number, int64_t* integer, int* is_integer);
+// fast path for the common case of a plain integer (an optional minus and at most 18 digits, no fraction or exponent),
+// which is read 8 digits at a time, bounded by end (it doesn't need anything after the number)
+// returns JSON_FAILURE for anything else, jnumber_parse sorts those out (including the malformed ones)
+int jnumber_parse_integer(const char* p, const char* end, const char** stop, int64_t* integer);
+// write an integer to buffer (at least JSON_NUMBER_BUFFER bytes), negative_zero gives "-0"
+// returns the length written (no terminator)
+int jnumber_format_integer(int64_t integer, int negative_zero, char* buffer);
+// can a double hold integer exactly (everything up to 2^53 in magnitude, and bigger ones with enough trailing zero bits)
+static inline int jnumber_fits_double(int64_t integer)
+{
+    const double number = (double)integer;
+    return number < 9223372036854775808.0 && (int64_t)number == integer; // 2^63 itself would overflow the cast back
+}
+
+// everything the parser needs to know about where its memory comes from (and what else to do while parsing)
+typedef struct jctx {
+    jarena* arena; // NULL means every node gets its own calloc
+    unsigned int flags; // JSON_PARSE_* flags, plus the JCTX_* bits below
+    const char* end; // end of the input (the parser never reads at or past it)
+    jparse_error* error; // where to say why a parse failed, if anywhere
+    const jpaths* projection; // if not NULL, only the members under node are built
+    size_t node;
+    size_t max_depth; // 0 means JSON_MAX_DEPTH
+    jintern* intern; // if not NULL, member keys come from here
+    struct jintern_counts* intern_counts; // what the parse took from intern, added to its totals once it's done
+} jctx;
+
+// internal ctx bits, kept clear of the public JSON_PARSE_* flags
+#define JCTX_DEFER 0x40000000u // containers at this level are left lazy (set for the children of a lazy parse)
+
+// where a lazy container's text starts, and what to parse it with
+struct jlazy {
+    char* start; // opening bracket, in the caller's buffer
+    const char* end; // end of the input it came from
+    jarena* arena;
+    unsigned int flags;
+    jintern* intern;
+};
+
+// allocate zeroed memory for a node, from the arena if there is one
+void* jctx_alloc(const jctx* ctx, size_t size);
+// parse the value at the start of [start, end), without needing a terminator, leaving *stop past it
+// unless partial is set, only whitespace may follow the value
+// the bounded core behind every parse entry point
+int jparse_range(char* start, const char* end, jvalue* empty, const jparse_options* opts, char** stop, int partial);
+// parse a JSON_FLAG_LAZY value's span in place, a level deep, like json_materialize but leaving packed arrays packed
+int jparse_lazy(jvalue* v);
+
+// resize an allocation made by jctx_alloc (new space isn't zeroed)
+void* jctx_grow(const jctx* ctx, void* ptr, size_t old_size, size_t new_size);
+// copy length characters from start into a fresh null-terminated string
+char* jctx_strndup(const jctx* ctx, const char* start, size_t length);
+// same for a member key (already decoded), which is interned instead if the ctx has a table (flags gets
+// JSON_FLAG_INTERNED then)
+char* jctx_key(const jctx* ctx, const char* start, size_t length, unsigned int* flags);
+// add a zeroed member (objects) or element (arrays) to the end of container, which has room for *capacity of them,
+// growing it (and *capacity) when it's full
+// it's counted in length right away, so freeing a half-built container is always safe
+// returns NULL on failure
+void* jctx_append(const jctx* ctx, jvalue* container, size_t* capacity);
+// once the last member or element is in: index wide objects with JSON_PARSE_INDEX (capacity is what jctx_append left)
+int jctx_finish(const jctx* ctx, jvalue* container, size_t capacity);
+
+// objects with fewer members than this are never indexed, a linear scan is just as fast
+#define JINDEX_MIN_MEMBERS 16
+
+// hash used for object keys (64 bit FNV-1a)
+static inline uint64_t json_hash_key(const char* key)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(const unsigned char* c = (const unsigned char*)key; *c != '\0'; c++)
+    {
+        hash ^= *c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// indexes refer to members by their position in the object, so the members array can move around freely
+#define JINDEX_NONE ((size_t)-1)
+// build an index over length members, from the arena if there is one
+// returns NULL on failure
+jindex* jindex_build(const jmember* members, size_t length, jarena* arena);
+void jindex_free(jindex* index);
+// position of the first member with this key, or JINDEX_NONE
+size_t jindex_find(const jindex* index, const jmember* members, const char* key);
+// same, with json_hash_key(key) already worked out
+size_t jindex_find_hashed(const jindex* index, const jmember* members, const char* key, uint64_t hash);
+// make the member at position the first one for its key (after adding it)
+// returns JSON_FAILURE if the index couldn't be grown, in which case it should be dropped
+int jindex_put(jindex* index, const jmember* members, size_t position);
+// point key's entry at a different position, or remove it with JINDEX_NONE
+void jindex_replace(jindex* index, const jmember* members, const char* key, size_t position);
+// move every position from from onwards by by (after members were inserted or removed in front of them)
+void jindex_shift(jindex* index, size_t from, int by);
+
+// key interning (jintern.c)
+// references a parse made to its intern table, counted locally and added to the table's totals in one go
+typedef struct jintern_counts {
+    size_t references;
+    size_t bytes;
+} jintern_counts;
+// the interned copy of the length bytes at key (up to the first null, like any other key), counted in counts if
+// that isn't NULL
+// returns NULL on failure
+const char* jintern_get(jintern* table, const char* key, size_t length, jintern_counts* counts);
+// json_hash_key of an interned key, without rehashing it
+uint64_t jintern_hash(const char* key);
+// add counts to the table's totals and clear them (table may be NULL)
+void jintern_flush(jintern* table, jintern_counts* counts);
+// json_hash_key for a member's key, which interned keys already know
+static inline uint64_t jmember_hash(const jmember* m)
+{
+    return (m->flags & JSON_FLAG_INTERNED) ? jintern_hash(m->key) : json_hash_key(m->key);
+}
+
+// projections: a compiled jpaths trie (see jpointer.c) walked while parsing, nodes are numbered from the root, 0
+#define JPATH_NONE ((size_t)-1)
+// the child of node for a (decoded, unterminated) key, or JPATH_NONE if nothing under node goes through it
+size_t jpaths_child(const jpaths* paths, size_t node, const char* key, size_t length);
+// same for an array's element at index, which only tokens that read as that index go through (like json_paths_get)
+size_t jpaths_element(const jpaths* paths, size_t node, size_t index);
+// is node the end of a path (so everything under it is wanted)
+int jpaths_ends(const jpaths* paths, size_t node);
+
+#endif
@@ -0,0 +1,227 @@
+//
+// Allocator hook tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// counts what's live, so anything the library allocated or freed behind the hooks' backs shows up
+// (single threaded only, the ndjson test below has a thread count of 1)
+typedef struct counts {
+    long live;
+    long calls;
+    int freed_unknown; // something came back through release that never went out through the hooks
+} counts;
+
+// every block remembers its size in front of it, and a marker to tell it came from here
+#define MARKER 0x6a736f6eUL
+
+void* counting_allocate(void* user, size_t size) {
+    counts* c = user;
+    size_t* block = malloc(size + 16);
+    if (block == NULL) {
+        return NULL;
+    }
+    block[0] = MARKER;
+    c->live++;
+    c->calls++;
+    return block + 2;
+}
+
+void counting_release(void* user, void* ptr) {
+    counts* c = user;
+    if (ptr == NULL) {
+        return;
+    }
+    size_t* block = (size_t*)ptr - 2;
+    if (block[0] != MARKER) {
+        c->freed_unknown = 1;
+        return;
+    }
+    block[0] = 0;
+    c->live--;
+    free(block);
+}
+
+void* counting_resize(void* user, void* ptr, size_t size) {
+    counts* c = user;
+    if (ptr == NULL) {
+        return counting_allocate(user, size);
+    }
+    size_t* block = (size_t*)ptr - 2;
+    if (block[0] != MARKER) {
+        c->freed_unknown = 1;
+        return NULL;
+    }
+    block = realloc(block, size + 16);
+    c->calls++;
+    return block != NULL ? block + 2 : NULL;
+}
+
+int alloc_hooks_test(const int verbose) {
+    counts c = { 0 };
+    const jallocator counting = { counting_allocate, counting_resize, counting_release, &c };
+    json_set_allocator(&counting);
+    char text[2048];
+    char* pos = text + sprintf(text, "{\"s\": \"caf\\u00e9\", \"n\": [1, 2.5, {\"deep\": [true]}]");
+    for (int i = 0; i < 40; i++) {
+        pos += sprintf(pos, ", \"k%d\": %d", i, i);
+    }
+    sprintf(pos, "}");
+    int failed = 0;
+    // every way of building a tree, and everything that's built off one
+    const unsigned int modes[] = { 0, JSON_PARSE_INDEX, JSON_PARSE_LAZY };
+    for (int mode = 0; mode < 3; mode++) {
+        jvalue* json = json_calloc(1, sizeof(jvalue));
+        const jparse_options opts = { .flags = modes[mode] };
+        failed |= json_parse_n(text, strlen(text), json, &opts, NULL);
+        failed |= json_search_by_key("k39", json)->number != 39;
+        failed |= json_array_at(json_search_by_key("n", json), 2)->type != JSON_OBJECT;
+        char* out = json_write_to_str(json, JSON_WRITE_PRETTY, NULL);
+        jtape* tape = json_tape_from_value(json);
+        jvalue* copy = json_calloc(1, sizeof(jvalue));
+        failed |= json_tape_to_value(tape, JSON_TAPE_ROOT, copy, NULL);
+        size_t length;
+        char* data = json_binary_encode(copy, &length);
+        jvalue* decoded = json_calloc(1, sizeof(jvalue));
+        failed |= json_binary_decode(data, length, decoded, NULL);
+        jvalue* added = json_calloc(1, sizeof(jvalue));
+        added->type = JSON_NULL;
+        failed |= json_add_member("added", added, decoded);
+        failed |= json_delete_all_members("k3", decoded);
+        json_free(out);
+        json_tape_free(tape);
+        json_free(data);
+        json_free_value(copy);
+        json_free_value(decoded);
+        json_free_value(json);
+    }
+    jvalue* pushed = json_calloc(1, sizeof(jvalue));
+    jparser* p = jparser_create(pushed, NULL);
+    failed |= jparser_feed(p, text, 100) || jparser_feed(p, text + 100, strlen(text) - 100) || jparser_finish(p);
+    jparser_destroy(p);
+    json_free_value(pushed);
+    const char* pointers[] = { "/n/2/deep/0", "/k7" };
+    jpaths* paths = json_paths_compile(pointers, 2);
+    jarena* arena = json_arena_create(0);
+    jvalue* projected = json_arena_alloc(arena, sizeof(jvalue));
+    const jparse_options projection = { .arena = arena, .projection = paths };
+    failed |= json_parse_n(text, strlen(text), projected, &projection, NULL);
+    json_arena_destroy(arena);
+    json_paths_free(paths);
+    const jndjson_options ndjson = { .threads = 1 };
+    size_t count;
+    jvalue** values = json_parse_ndjson_array("{\"a\": 1}\n[2]\n", 12, &ndjson, &count);
+    for (size_t i = 0; i < count; i++) {
+        json_free_value(values[i]);
+    }
+    json_free(values);
+    json_set_allocator(NULL);
+    if (failed || c.live != 0 || c.calls < 100 || c.freed_unknown) {
+        if (verbose) {
+            printf("%ld blocks left over after %ld calls (unknown frees: %d)\n", c.live, c.calls, c.freed_unknown);
+        }
+        failed = 1;
+    }
+    // and back to malloc, which the counting hooks don't see
+    const long calls = c.calls;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* cursor = text;
+    if (!failed && (json_parse_value(&cursor, json) != JSON_SUCCESS || c.calls != calls)) {
+        failed = 2;
+    }
+    json_free_value(json);
+    return failed;
+}
+
+int alloc_pool_test(const int verbose) {
+    json_set_allocator(&json_pool_allocator);
+    int failed = 0;
+    // build an object a member at a time and take it apart again, a few times over so the freelists get used
+    for (int round = 0; !failed && round < 5; round++) {
+        jvalue* obj = json_calloc(1, sizeof(jvalue));
+        for (int i = 0; i < 300; i++) {
+            jvalue* value = json_calloc(1, sizeof(jvalue));
+            value->type = JSON_STRING;
+            value->string = json_malloc(16);
+            sprintf(value->string, "v%d", i);
+            char key[16];
+            sprintf(key, "k%d", i % 100);
+            failed |= json_add_member(key, value, obj);
+        }
+        // the last member added for every key shadows the older ones
+        for (int i = 0; !failed && i < 100; i++) {
+            char key[16];
+            char expected[16];
+            sprintf(key, "k%d", i);
+            sprintf(expected, "v%d", i + 200);
+            const jvalue* found = json_search_by_key(key, obj);
+            if (found == NULL || strcmp(found->string, expected) != 0) {
+                if (verbose) {
+                    printf("Round %d: %s went wrong\n", round, key);
+                }
+                failed = 1;
+            }
+        }
+        // every even key's 3 members, and k1's
+        for (int i = 0; i < 100; i += 2) {
+            char key[16];
+            sprintf(key, "k%d", i);
+            json_delete_all_members(key, obj);
+            json_delete_first_member("k1", obj);
+        }
+        if (!failed && (obj->length != 147 || json_search_by_key("k1", obj) != NULL
+                        || strcmp(json_search_by_key("k99", obj)->string, "v299") != 0)) {
+            failed = 2;
+        }
+        json_free_value(obj);
+    }
+    // bigger than any pool, grown and shrunk across the classes
+    char* big = json_malloc(10);
+    strcpy(big, "keep");
+    big = json_realloc(big, 100000);
+    big[99999] = 'x';
+    big = json_realloc(big, 200000);
+    big = json_realloc(big, 30);
+    if (!failed && strcmp(big, "keep") != 0) {
+        failed = 3;
+    }
+    json_free(big);
+    // blocks freed on other threads than the ones that allocated them
+    char* buffer = malloc(5000 * 40);
+    char* pos = buffer;
+    for (int i = 0; i < 5000; i++) {
+        pos += sprintf(pos, "{\"id\": %d, \"tags\": [\"t%d\"]}\n", i, i % 7);
+    }
+    const jndjson_options opts = { .threads = 4 };
+    size_t count;
+    jvalue** values = json_parse_ndjson_array(buffer, pos - buffer, &opts, &count);
+    for (size_t i = 0; i < count; i++) {
+        if (!failed && json_search_by_key("id", values[i])->number != (double)i) {
+            failed = 4;
+        }
+        json_free_value(values[i]);
+    }
+    json_free(values);
+    free(buffer);
+    json_set_allocator(NULL);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Allocator hooks\n");
+    run_test(alloc_hooks_test, "alloc_hooks", verbose);
+    run_test(alloc_pool_test, "alloc_pool", verbose);
+    return 0;
+}
@@ -0,0 +1,180 @@
+//
+// Arena-backed and in-situ parsing tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+int arena_document_test(const int verbose) {
+    char* in = "{ \"name\" : \"tablet\", \"tags\" : [\"a\", \"b\", \"c\", \"d\", \"e\"], \"nested\" : { \"x\" : 1 } }";
+    jarena* arena = json_arena_create(0);
+    if (arena == NULL) {
+        return 1;
+    }
+    jvalue* json = json_arena_alloc(arena, sizeof(jvalue));
+    if (json_parse_value_arena(&in, json, arena) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE_ARENA failed (%s)\n", in);
+        }
+        json_arena_destroy(arena);
+        return 1;
+    }
+    if (json->type != JSON_OBJECT) {
+        if (verbose) {
+            printf("Parsed value has wrong type\n");
+        }
+        json_arena_destroy(arena);
+        return 1;
+    }
+    jvalue* name = json_search_by_key("name", json);
+    jvalue* tags = json_search_by_key("tags", json);
+    jvalue* nested = json_search_by_key("nested", json);
+    if (name == NULL || name->type != JSON_STRING || strcmp(name->string, "tablet") != 0
+        || tags == NULL || tags->type != JSON_ARRAY || nested == NULL || nested->type != JSON_OBJECT) {
+        if (verbose) {
+            printf("Parsed members are incorrect\n");
+        }
+        json_arena_destroy(arena);
+        return 1;
+    }
+    if (tags->length != 5 || strcmp(tags->elements[4].string, "e") != 0) {
+        if (verbose) {
+            printf("Parsed array is incorrect (%zu elements)\n", tags->length);
+        }
+        json_arena_destroy(arena);
+        return 1;
+    }
+    json_arena_destroy(arena);
+    return 0;
+}
+
+int arena_reuse_test(const int verbose) {
+    // tiny blocks force the parser to spill into new blocks, then reset has to rewind all of them
+    jarena* arena = json_arena_create(64);
+    if (arena == NULL) {
+        return 1;
+    }
+    for (int round = 0; round < 3; round++) {
+        char* in = "[1, 2, 3, 4, 5, 6, 7, 8, 9, \"a long enough string to need its own block in this arena\"]";
+        jvalue* json = json_arena_alloc(arena, sizeof(jvalue));
+        if (json_parse_value_arena(&in, json, arena) != JSON_SUCCESS || json->type != JSON_ARRAY) {
+            if (verbose) {
+                printf("JSON_PARSE_VALUE_ARENA failed in round %d\n", round);
+            }
+            json_arena_destroy(arena);
+            return 1;
+        }
+        if (json->elements[8].number != 9 || json->length != 10) {
+            if (verbose) {
+                printf("Parsed value is incorrect in round %d\n", round);
+            }
+            json_arena_destroy(arena);
+            return 1;
+        }
+        json_arena_reset(arena);
+    }
+    json_arena_destroy(arena);
+    return 0;
+}
+
+int arena_mutation_test(const int verbose) {
+    // members of an arena-backed object live in the arena, so the mutation functions have to refuse it
+    // rather than realloc or free arena memory
+    char text[] = "{ \"a\" : 1, \"b\" : { \"c\" : 2 }, \"a\" : 3 }";
+    jarena* arena = json_arena_create(0);
+    if (arena == NULL) {
+        return 1;
+    }
+    jvalue* json = json_arena_alloc(arena, sizeof(jvalue));
+    char* in = text;
+    const jparse_options opts = { .arena = arena };
+    if (json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE_OPTS failed (%s)\n", in);
+        }
+        json_arena_destroy(arena);
+        return 1;
+    }
+    int failed = 0;
+    jvalue* extra = calloc(1, sizeof(jvalue));
+    extra->type = JSON_NULL;
+    if (json_add_member("d", extra, json) != JSON_FAILURE || json_add_member("c", extra, json_search_by_key("b", json)) != JSON_FAILURE) {
+        if (verbose) {
+            printf("JSON_ADD_MEMBER accepted an arena-backed object\n");
+        }
+        failed++;
+    }
+    free(extra); // still ours, the failed adds left it alone
+    if (json_delete_first_member("a", json) != JSON_FAILURE || json_delete_all_members("a", json) != JSON_FAILURE) {
+        if (verbose) {
+            printf("The delete functions accepted an arena-backed object\n");
+        }
+        failed++;
+    }
+    if (json->length != 3 || json_search_by_key("a", json) == NULL || json_search_by_key("a", json)->number != 1) {
+        if (verbose) {
+            printf("The object changed anyway\n");
+        }
+        failed++;
+    }
+    json_arena_destroy(arena);
+    return failed;
+}
+
+int insitu_test(const int verbose) {
+    char text[] = "{ \"key\" : \"value\", \"list\" : [\"x\", \"y\\\"z\"] }";
+    char* in = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INSITU };
+    if (json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE_OPTS failed (%s)\n", in);
+        }
+        json_free_value(json);
+        return 1;
+    }
+    jvalue* value = json_search_by_key("key", json);
+    jvalue* list = json_search_by_key("list", json);
+    if (value == NULL || strcmp(value->string, "value") != 0 || list == NULL || strcmp(list->elements[1].string, "y\"z") != 0) {
+        if (verbose) {
+            printf("Parsed strings are incorrect\n");
+        }
+        json_free_value(json);
+        return 1;
+    }
+    // strings have to live inside the input buffer, not in copies of it
+    if (value->string < text || value->string >= text + sizeof(text) || json->members[0].key < text
+        || json->members[0].key >= text + sizeof(text)) {
+        if (verbose) {
+            printf("Strings were copied out of the input\n");
+        }
+        json_free_value(json);
+        return 1;
+    }
+    // and mixing in a heap-allocated member has to free cleanly next to them
+    jvalue* extra = calloc(1, sizeof(jvalue));
+    extra->type = JSON_NULL;
+    json_add_member("extra", extra, json);
+    json_free_value(json);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Arena\n");
+    run_test(arena_document_test, "arena_document", verbose);
+    run_test(arena_reuse_test, "arena_reuse", verbose);
+    run_test(arena_mutation_test, "arena_mutation", verbose);
+    run_test(insitu_test, "insitu", verbose);
+    return 0;
+}
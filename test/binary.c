@@ -0,0 +1,232 @@
+//
+// Binary encoding tests
+// For absolute best coverage run with valgrind (or a sanitizer, which catches reads past truncated encodings)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+const char* documents[] = {
+    "{\"a\": [1, -2, 3.25, -0, -0.0, 9223372036854775807, -9223372036854775808, 1e300, 18446744073709551616],"
+    " \"b\": {\"c\": \"caf\\u00e9 \\\"quoted\\\" \\ud83d\\ude00\\n\", \"c\": null, \"\": true}, \"d\": [], \"e\": {}, \"f\": false}",
+    "\"just a string\"",
+    "-17",
+    "[[[[[]]]], {\"x\": [{\"y\": [0.1, 0.2]}]}]",
+    "null",
+};
+
+jvalue* parse(const char* text, unsigned int flags) {
+    char* cursor = (char*)text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = flags };
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS) {
+        json_free_value(json);
+        return NULL;
+    }
+    return json;
+}
+
+int binary_roundtrip_test(const int verbose) {
+    int failed = 0;
+    for (size_t i = 0; !failed && i < sizeof(documents) / sizeof(documents[0]); i++) {
+        jvalue* json = parse(documents[i], JSON_PARSE_LAZY);
+        char* text = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+        size_t length = 0;
+        char* data = json_binary_encode(json, &length);
+        jvalue* back = calloc(1, sizeof(jvalue));
+        if (data == NULL || json_binary_decode(data, length, back, NULL) != JSON_SUCCESS) {
+            failed = 1;
+        } else {
+            // the text of what comes back has to be exactly the text of what went in
+            char* again = json_write_to_str(back, JSON_WRITE_COMPACT, NULL);
+            if (again == NULL || strcmp(text, again) != 0) {
+                if (verbose) {
+                    printf("%s came back as %s\n", text, again ? again : "(failure)");
+                }
+                failed = 2;
+            }
+            free(again);
+        }
+        json_free_value(back);
+        // every cut short version of it has to fail cleanly, and so does anything after the root
+        for (size_t cut = 0; !failed && cut < length; cut++) {
+            char* prefix = malloc(cut ? cut : 1);
+            memcpy(prefix, data, cut);
+            back = calloc(1, sizeof(jvalue));
+            if (json_binary_decode(prefix, cut, back, NULL) != JSON_FAILURE || json_binary_arena_size(prefix, cut, NULL) != 0) {
+                if (verbose) {
+                    printf("%s cut to %zu bytes was accepted\n", text, cut);
+                }
+                failed = 3;
+            }
+            json_free_value(back);
+            free(prefix);
+        }
+        char* longer = malloc(length + 1);
+        memcpy(longer, data, length);
+        longer[length] = 0;
+        back = calloc(1, sizeof(jvalue));
+        if (!failed && json_binary_decode(longer, length + 1, back, NULL) != JSON_FAILURE) {
+            failed = 4;
+        }
+        json_free_value(back);
+        free(longer);
+        free(data);
+        free(text);
+        json_free_value(json);
+    }
+    // integers stay integers, -0 stays -0
+    jvalue* json = parse("[-0, 12345678901234567, 0.5]", 0);
+    size_t length;
+    char* data = json_binary_encode(json, &length);
+    jvalue* back = calloc(1, sizeof(jvalue));
+    if (!failed && (json_binary_decode(data, length, back, NULL) != JSON_SUCCESS || !(back->elements[0].flags & JSON_FLAG_INTEGER)
+                    || back->elements[0].number != 0 || 1 / back->elements[0].number > 0
+                    || back->elements[1].integer != 12345678901234567LL || (back->elements[2].flags & JSON_FLAG_INTEGER))) {
+        failed = 5;
+    }
+    json_free_value(back);
+    json_free_value(json);
+    // garbage isn't an encoding
+    data[0] = 'X';
+    back = calloc(1, sizeof(jvalue));
+    if (!failed && json_binary_decode(data, length, back, NULL) != JSON_FAILURE) {
+        failed = 6;
+    }
+    json_free_value(back);
+    free(data);
+    return failed;
+}
+
+int binary_load_test(const int verbose) {
+    jvalue* json = parse(documents[0], 0);
+    size_t length;
+    char* data = json_binary_encode(json, &length);
+    char* text = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    int failed = data == NULL;
+    // the whole tree in one arena block, with strings borrowed from the encoding
+    const unsigned int modes[] = { 0, JSON_PARSE_INSITU };
+    for (int mode = 0; !failed && mode < 2; mode++) {
+        const jparse_options sizing = { .flags = modes[mode] };
+        const size_t size = json_binary_arena_size(data, length, &sizing);
+        jarena* arena = json_arena_create(size);
+        jvalue* back = json_arena_alloc(arena, sizeof(jvalue));
+        const jparse_options opts = { .flags = modes[mode] | JSON_PARSE_INDEX, .arena = arena };
+        if (size == 0 || json_binary_decode(data, length, back, &opts) != JSON_SUCCESS) {
+            failed = 1;
+        } else {
+            char* again = json_write_to_str(back, JSON_WRITE_COMPACT, NULL);
+            const jvalue* c = json_search_by_key("c", json_search_by_key("b", back));
+            const int borrowed = c->string > data && c->string < data + length;
+            if (again == NULL || strcmp(text, again) != 0 || borrowed != (modes[mode] == JSON_PARSE_INSITU)) {
+                if (verbose) {
+                    printf("Mode %d: %s\n", mode, again ? again : "(failure)");
+                }
+                failed = 2;
+            }
+            free(again);
+        }
+        json_arena_destroy(arena);
+    }
+    // through a file and a sink
+    char path[] = "/tmp/tinyjson_binary_XXXXXX";
+    int fd = mkstemp(path);
+    if (!failed && (fd < 0 || json_binary_write(json, json_sink_fd, &fd) != JSON_SUCCESS)) {
+        failed = 3;
+    }
+    close(fd);
+    jvalue* back = calloc(1, sizeof(jvalue));
+    if (!failed && json_binary_read_file(path, back, NULL) != JSON_SUCCESS) {
+        failed = 4;
+    }
+    char* again = failed ? NULL : json_write_to_str(back, JSON_WRITE_COMPACT, NULL);
+    if (!failed && (again == NULL || strcmp(text, again) != 0)) {
+        failed = 5;
+    }
+    free(again);
+    json_free_value(back);
+    unlink(path);
+    free(text);
+    free(data);
+    json_free_value(json);
+    return failed;
+}
+
+int binary_deep_test(const int verbose) {
+    // far deeper than any C stack could recurse, encoded, sized and decoded without recursing
+    const size_t depth = 1000000;
+    char* text = malloc(depth * 6 + 2);
+    char* pos = text;
+    for (size_t i = 0; i < depth; i++) {
+        if (i % 2) {
+            memcpy(pos, "{\"k\":", 5);
+            pos += 5;
+        } else {
+            *pos++ = '[';
+        }
+    }
+    *pos++ = '1';
+    for (size_t i = depth; i > 0; i--) {
+        *pos++ = (i - 1) % 2 ? '}' : ']';
+    }
+    *pos = '\0';
+    char* cursor = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options deep = { .max_depth = depth };
+    int failed = json_parse_value_opts(&cursor, json, &deep) != JSON_SUCCESS;
+    size_t length = 0;
+    char* data = failed ? NULL : json_binary_encode(json, &length);
+    if (!failed && data == NULL) {
+        if (verbose) {
+            printf("%zu levels didn't encode\n", depth);
+        }
+        failed = 1;
+    }
+    // sizing agrees with decoding on what's too deep, whatever the limit
+    jvalue* back = calloc(1, sizeof(jvalue));
+    if (!failed && (json_binary_arena_size(data, length, NULL) != 0 || json_binary_decode(data, length, back, NULL) != JSON_FAILURE)) {
+        failed = 2;
+    }
+    json_free_value(back);
+    const size_t size = failed ? 0 : json_binary_arena_size(data, length, &deep);
+    if (!failed && size == 0) {
+        if (verbose) {
+            printf("No arena size for %zu levels with the limit raised\n", depth);
+        }
+        failed = 3;
+    }
+    if (!failed) {
+        jarena* arena = json_arena_create(size);
+        back = json_arena_alloc(arena, sizeof(jvalue));
+        const jparse_options opts = { .max_depth = depth, .arena = arena };
+        char* again = json_binary_decode(data, length, back, &opts) == JSON_SUCCESS ? json_write_to_str(back, JSON_WRITE_COMPACT, NULL) : NULL;
+        if (again == NULL || strcmp(again, text) != 0) {
+            failed = 4;
+        }
+        free(again);
+        json_arena_destroy(arena);
+    }
+    free(data);
+    json_free_value(json);
+    free(text);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Binary encoding\n");
+    run_test(binary_roundtrip_test, "binary_roundtrip", verbose);
+    run_test(binary_load_test, "binary_load", verbose);
+    run_test(binary_deep_test, "binary_deep", verbose);
+    return 0;
+}
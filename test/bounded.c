@@ -0,0 +1,185 @@
+//
+// Length-bounded parsing tests
+// For absolute best coverage run with valgrind (or a sanitizer, which catches reads past the slices)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// copy text into a heap buffer of exactly its length, with no terminator after it
+char* unterminated(const char* text) {
+    size_t length = strlen(text);
+    char* buffer = malloc(length ? length : 1);
+    memcpy(buffer, text, length);
+    return buffer;
+}
+
+int bounded_slice_test(const int verbose) {
+    // the middle of a bigger buffer, with junk on both sides
+    const char* buffer = "garbage{\"a\" : [1, 2, \"three\"], \"b\" : -12.5e1}more garbage";
+    const char* slice = strchr(buffer, '{');
+    const size_t length = strrchr(buffer, '}') + 1 - slice;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    int failed = json_parse_n(slice, length, json, NULL, NULL) != JSON_SUCCESS;
+    if (!failed) {
+        char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+        failed = out == NULL || strcmp(out, "{\"a\":[1,2,\"three\"],\"b\":-125.0}") != 0;
+        if (failed && verbose) {
+            printf("Slice parsed as %s\n", out ? out : "(failure)");
+        }
+        free(out);
+    }
+    json_free_value(json);
+    // one byte short of the slice can't parse, and one byte too many is trailing junk
+    json = calloc(1, sizeof(jvalue));
+    if (json_parse_n(slice, length - 1, json, NULL, NULL) != JSON_FAILURE) {
+        failed = 2;
+    }
+    json_free_value(json);
+    json = calloc(1, sizeof(jvalue));
+    if (json_parse_n(slice, length + 1, json, NULL, NULL) != JSON_FAILURE) {
+        failed = 3;
+    }
+    json_free_value(json);
+    // values that end right at the end of the buffer, which has nothing after it
+    const char* tails[] = { "12345", "-0.5e-3", "true", "null", "\"str\"", "[]", "  7  " };
+    for (size_t i = 0; i < sizeof(tails) / sizeof(tails[0]); i++) {
+        char* in = unterminated(tails[i]);
+        json = calloc(1, sizeof(jvalue));
+        if (json_parse_n(in, strlen(tails[i]), json, NULL, NULL) != JSON_SUCCESS) {
+            if (verbose) {
+                printf("\"%s\" didn't parse\n", tails[i]);
+            }
+            failed = 4;
+        }
+        json_free_value(json);
+        free(in);
+    }
+    const char* cut[] = { "1e", "-", "tru", "\"st", "[1,", "{\"a\"", "" };
+    for (size_t i = 0; i < sizeof(cut) / sizeof(cut[0]); i++) {
+        char* in = unterminated(cut[i]);
+        json = calloc(1, sizeof(jvalue));
+        if (json_parse_n(in, strlen(cut[i]), json, NULL, NULL) != JSON_FAILURE) {
+            if (verbose) {
+                printf("\"%s\" was accepted\n", cut[i]);
+            }
+            failed = 5;
+        }
+        json_free_value(json);
+        free(in);
+    }
+    if (failed && verbose) {
+        printf("Slice check %d failed\n", failed);
+    }
+    return failed;
+}
+
+int bounded_consumed_test(const int verbose) {
+    // a stream of concatenated values, walked with consumed
+    char* stream = unterminated("{\"id\": 1} [2]  \"three\"\n4 true");
+    const size_t length = strlen("{\"id\": 1} [2]  \"three\"\n4 true");
+    const int types[] = { JSON_OBJECT, JSON_ARRAY, JSON_STRING, JSON_NUMBER, JSON_BOOL };
+    const size_t offsets[] = { 10, 15, 23, 25, 29 };
+    size_t offset = 0;
+    int failed = 0;
+    for (size_t i = 0; !failed && i < 5; i++) {
+        jvalue* json = calloc(1, sizeof(jvalue));
+        size_t consumed = 0;
+        if (json_parse_n(stream + offset, length - offset, json, NULL, &consumed) != JSON_SUCCESS || json->type != types[i]
+            || offset + consumed != offsets[i]) {
+            if (verbose) {
+                printf("Value %zu: consumed %zu, type %d\n", i, consumed, json->type);
+            }
+            failed = 1;
+        }
+        offset += consumed;
+        json_free_value(json);
+    }
+    // in-situ strings point into the slice
+    const jparse_options opts = { .flags = JSON_PARSE_INSITU };
+    jvalue* json = calloc(1, sizeof(jvalue));
+    size_t consumed = 0;
+    if (!failed && (json_parse_n(stream + 15, length - 15, json, &opts, &consumed) != JSON_SUCCESS || json->string != stream + 16
+                    || strcmp(json->string, "three") != 0 || consumed != 8)) {
+        failed = 2;
+    }
+    json_free_value(json);
+    if (failed && verbose) {
+        printf("Consumed check %d failed\n", failed);
+    }
+    free(stream);
+    return failed;
+}
+
+int bounded_documents_test(const int verbose) {
+    const char* text = "{\"a\": [1, {\"b\": null}]}\n[true]  3\"x\"{}\n\n";
+    char* buffer = unterminated(text);
+    const int types[] = { JSON_OBJECT, JSON_ARRAY, JSON_NUMBER, JSON_STRING, JSON_OBJECT };
+    jdocuments docs;
+    json_documents_init(&docs, buffer, strlen(text), NULL);
+    int failed = 0;
+    int count = 0;
+    int result;
+    while (!failed) {
+        jvalue* json = calloc(1, sizeof(jvalue));
+        result = json_documents_next(&docs, json);
+        if (result == JSON_SUCCESS && (count >= 5 || json->type != types[count])) {
+            failed = 1;
+        }
+        json_free_value(json);
+        if (result != JSON_SUCCESS) {
+            break;
+        }
+        count++;
+    }
+    if (!failed && (result != JSON_DOCUMENTS_END || count != 5)) {
+        failed = 2;
+    }
+    free(buffer);
+    // a malformed value stops the iteration, with the cursor where it went wrong
+    text = "1 [2, }";
+    json_documents_init(&docs, text, strlen(text), NULL);
+    jvalue* first = calloc(1, sizeof(jvalue));
+    jvalue* second = calloc(1, sizeof(jvalue));
+    if (!failed && (json_documents_next(&docs, first) != JSON_SUCCESS || json_documents_next(&docs, second) != JSON_FAILURE
+                    || docs.cursor != text + 6)) {
+        failed = 3;
+    }
+    json_free_value(first);
+    json_free_value(second);
+    // errors inside nested values count, not just at the top level
+    const char* nested[] = { "{\"a\": }", "[1, ]", "{\"a\": 1, }", "[[1] 2]", "{\"a\" : {\"b\" : tru}}", "[{\"a\" 1}]" };
+    for (size_t i = 0; i < sizeof(nested) / sizeof(nested[0]); i++) {
+        char* in = (char*)nested[i];
+        jvalue* json = calloc(1, sizeof(jvalue));
+        if (json_parse_value(&in, json) != JSON_FAILURE) {
+            if (verbose) {
+                printf("\"%s\" was accepted\n", nested[i]);
+            }
+            failed = 4;
+        }
+        json_free_value(json);
+    }
+    if (failed && verbose) {
+        printf("Documents check %d failed\n", failed);
+    }
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Length-bounded parsing\n");
+    run_test(bounded_slice_test, "bounded_slice", verbose);
+    run_test(bounded_consumed_test, "bounded_consumed", verbose);
+    run_test(bounded_documents_test, "bounded_documents", verbose);
+    return 0;
+}
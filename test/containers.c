@@ -0,0 +1,130 @@
+//
+// Container tests (lengths, positional access and iteration over members and elements)
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+jvalue* parse(const char* text, unsigned int flags) {
+    char* cursor = (char*)text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = flags };
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS) {
+        json_free_value(json);
+        return NULL;
+    }
+    return json;
+}
+
+int containers_access_test(const int verbose) {
+    const char* text = "{\"a\": [1, 2, 3], \"b\": {\"c\": null}, \"d\": \"x\", \"e\": []}";
+    const unsigned int modes[] = { 0, JSON_PARSE_LAZY };
+    int failed = 0;
+    for (int mode = 0; !failed && mode < 2; mode++) {
+        jvalue* json = parse(text, modes[mode]);
+        jvalue* a = json_search_by_key("a", json);
+        // the loops parse lazy containers on their own
+        char keys[8] = { 0 };
+        size_t n = 0;
+        JSON_FOR_EACH_MEMBER(m, json) {
+            keys[n++] = m->key[0];
+        }
+        double sum = 0;
+        JSON_FOR_EACH_ELEMENT(e, a) {
+            sum += e->number;
+        }
+        if (strcmp(keys, "abde") != 0 || sum != 6 || json_length(json) != 4 || a->length != 3) {
+            if (verbose) {
+                printf("Mode %d: keys %s, sum %g\n", mode, keys, sum);
+            }
+            failed = 1;
+        }
+        // positions, and everything that isn't there
+        const jvalue* d = json_search_by_key("d", json);
+        if (!failed && (strcmp(json_member_at(json, 1)->key, "b") != 0 || json_member_at(json, 4) != NULL
+                        || json_array_at(a, 2)->number != 3 || json_array_at(a, 3) != NULL || json_member_at(a, 0) != NULL
+                        || json_array_at(json, 0) != NULL || json_length(d) != 0 || json_length(json_search_by_key("e", json)) != 0
+                        || json_length(json_search_by_key("b", json)) != 1)) {
+            failed = 2;
+        }
+        // loops over the wrong kind of value, or over nothing, don't run
+        n = 0;
+        JSON_FOR_EACH_MEMBER(m, a) {
+            n++;
+        }
+        JSON_FOR_EACH_ELEMENT(e, json) {
+            n++;
+        }
+        JSON_FOR_EACH_ELEMENT(e, d) {
+            n++;
+        }
+        JSON_FOR_EACH_ELEMENT(e, json_search_by_key("e", json)) {
+            n++;
+        }
+        if (!failed && n != 0) {
+            failed = 3;
+        }
+        json_free_value(json);
+    }
+    return failed;
+}
+
+int containers_mutation_test(const int verbose) {
+    // wide enough to be indexed, so deleting from the middle has to move the index along with the members
+    char text[2048];
+    char* pos = text + sprintf(text, "{\"first\": {\"x\": [1, {\"y\": 2}]}");
+    for (int i = 0; i < 40; i++) {
+        pos += sprintf(pos, ", \"k%d\": %d", i, i);
+    }
+    sprintf(pos, "}");
+    jvalue* json = parse(text, JSON_PARSE_INDEX);
+    int failed = json == NULL || json->length != 41;
+    json_delete_first_member("k10", json);
+    json_delete_first_member("first", json);
+    jvalue* added = calloc(1, sizeof(jvalue));
+    added->type = JSON_STRING;
+    added->string = malloc(4);
+    strcpy(added->string, "new");
+    json_add_member("k20", added, json);
+    for (int i = 0; !failed && i < 40; i++) {
+        char key[16];
+        sprintf(key, "k%d", i);
+        const jvalue* found = json_search_by_key(key, json);
+        if (i == 10 ? found != NULL : i == 20 ? strcmp(found->string, "new") != 0 : found->number != i) {
+            if (verbose) {
+                printf("Lookup of %s went wrong after deleting\n", key);
+            }
+            failed = 1;
+        }
+    }
+    // the added member took the shadowed one's place, that one is still there right behind it, and the rest kept their order
+    if (!failed && (json->length != 40 || strcmp(json->members[0].key, "k0") != 0 || strcmp(json->members[10].key, "k11") != 0
+                    || strcmp(json->members[19].value.string, "new") != 0 || json->members[20].value.number != 20
+                    || strcmp(json->members[39].key, "k39") != 0)) {
+        failed = 2;
+    }
+    json_delete_all_members("k20", json);
+    if (!failed && (json->length != 38 || json_search_by_key("k20", json) != NULL || json_search_by_key("k39", json)->number != 39)) {
+        failed = 3;
+    }
+    json_free_value(json);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Containers\n");
+    run_test(containers_access_test, "containers_access", verbose);
+    run_test(containers_mutation_test, "containers_mutation", verbose);
+    return 0;
+}
@@ -0,0 +1,170 @@
+//
+// Nesting depth tests
+// For absolute best coverage run with valgrind (a recursive parser would overflow the stack on these)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// depth arrays (or objects, alternating with arrays) nested inside each other around a 1
+char* nested(size_t depth, int objects) {
+    char* text = malloc(depth * 6 + 2);
+    char* pos = text;
+    for (size_t i = 0; i < depth; i++) {
+        if (objects && i % 2) {
+            memcpy(pos, "{\"k\":", 5);
+            pos += 5;
+        } else {
+            *pos++ = '[';
+        }
+    }
+    *pos++ = '1';
+    for (size_t i = depth; i > 0; i--) {
+        *pos++ = objects && (i - 1) % 2 ? '}' : ']';
+    }
+    *pos = '\0';
+    return text;
+}
+
+int depth_deep_test(const int verbose) {
+    // far deeper than any C stack could recurse, parsed, written and freed without recursing
+    const size_t depth = 1000000;
+    int failed = 0;
+    for (int objects = 0; !failed && objects < 2; objects++) {
+        char* text = nested(depth, objects);
+        jvalue* json = calloc(1, sizeof(jvalue));
+        char* cursor = text;
+        const jparse_options opts = { .max_depth = depth };
+        if (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS) {
+            if (verbose) {
+                printf("%zu levels didn't parse\n", depth);
+            }
+            failed = 1;
+        } else {
+            size_t length;
+            char* out = json_write_to_str(json, JSON_WRITE_COMPACT, &length);
+            if (out == NULL || strcmp(out, text) != 0) {
+                failed = 2;
+            }
+            free(out);
+        }
+        // the events parser only needs a byte per level, with the limit raised it goes just as deep
+        const jevents no_events = {0};
+        if (!failed && json_parse_events_opts(text, &no_events, NULL, &opts) != JSON_SUCCESS) {
+            failed = 4;
+        }
+        json_free_value(json);
+        free(text);
+    }
+    // pretty output indents by the depth, so keep that one smaller
+    char* text = nested(10000, 1);
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* cursor = text;
+    const jparse_options opts = { .max_depth = 10000 };
+    char* out = NULL;
+    if (!failed && json_parse_value_opts(&cursor, json, &opts) == JSON_SUCCESS) {
+        out = json_write_to_str(json, JSON_WRITE_PRETTY, NULL);
+    }
+    if (!failed && out == NULL) {
+        failed = 3;
+    }
+    free(out);
+    json_free_value(json);
+    free(text);
+    return failed;
+}
+
+int depth_limit_test(const int verbose) {
+    int failed = 0;
+    // the default limit, with the error pointing at the bracket that went too deep
+    char* text = nested(JSON_MAX_DEPTH + 1, 1);
+    jparse_error error;
+    jparse_options opts = { .error = &error };
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* cursor = text;
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_FAILURE || error.code != JSON_ERROR_DEPTH) {
+        if (verbose) {
+            printf("%d levels: error %d at %zu\n", JSON_MAX_DEPTH + 1, error.code, error.offset);
+        }
+        failed = 1;
+    }
+    json_free_value(json);
+    // events have the same default (they feed tapes, which have to stop somewhere too)
+    const jevents no_events = {0};
+    if (!failed && json_parse_events(text, &no_events, NULL) != JSON_FAILURE) {
+        if (verbose) {
+            printf("Events parser took %d levels\n", JSON_MAX_DEPTH + 1);
+        }
+        failed = 1;
+    }
+    free(text);
+    text = nested(JSON_MAX_DEPTH, 1);
+    json = calloc(1, sizeof(jvalue));
+    cursor = text;
+    if (!failed && (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS || json_parse_events(text, &no_events, NULL) != JSON_SUCCESS)) {
+        failed = 2;
+    }
+    json_free_value(json);
+    free(text);
+    // a tighter one, for every parser that builds trees
+    opts.max_depth = 2;
+    const char* ok = "[{\"a\": 1}, [2], {}]";
+    const char* deep = "[{\"a\": 1, \"b\": []}, [2]]"; // empty containers count too
+    const char* inputs[] = { ok, deep };
+    for (int i = 0; i < 2; i++) {
+        const int expected = i ? JSON_FAILURE : JSON_SUCCESS;
+        json = calloc(1, sizeof(jvalue));
+        cursor = (char*)inputs[i];
+        if (json_parse_value_opts(&cursor, json, &opts) != expected) {
+            failed = 3;
+        }
+        json_free_value(json);
+        json = calloc(1, sizeof(jvalue));
+        jparser* p = jparser_create(json, &opts);
+        if ((jparser_feed(p, inputs[i], strlen(inputs[i])) || jparser_finish(p)) != (expected == JSON_FAILURE)) {
+            if (verbose) {
+                printf("Push parser got %s wrong\n", inputs[i]);
+            }
+            failed = 4;
+        }
+        jparser_destroy(p);
+        json_free_value(json);
+        if (json_parse_events_opts(inputs[i], &no_events, NULL, &opts) != expected) {
+            if (verbose) {
+                printf("Events parser got %s wrong\n", inputs[i]);
+            }
+            failed = 4;
+        }
+    }
+    // and the binary form of something deep
+    jvalue* tree = calloc(1, sizeof(jvalue));
+    cursor = (char*)deep;
+    json_parse_value(&cursor, tree);
+    size_t length;
+    char* data = json_binary_encode(tree, &length);
+    json = calloc(1, sizeof(jvalue));
+    if (json_binary_decode(data, length, json, &opts) != JSON_FAILURE) {
+        failed = 5;
+    }
+    json_free_value(json);
+    free(data);
+    json_free_value(tree);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Nesting depth\n");
+    run_test(depth_deep_test, "depth_deep", verbose);
+    run_test(depth_limit_test, "depth_limit", verbose);
+    return 0;
+}
@@ -0,0 +1,207 @@
+//
+// Event (SAX) parsing tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// every callback appends a short record of itself to a log, so a whole parse can be compared as one string
+typedef struct event_log {
+    char text[1024];
+    const char* stop_at_key; // return JSON_EVENT_STOP on this key
+    const char* skip_key; // return JSON_EVENT_SKIP on this key
+    int skip_arrays; // return JSON_EVENT_SKIP from start_array
+} event_log;
+
+void log_event(event_log* log, const char* event, const char* data, size_t length) {
+    const size_t used = strlen(log->text);
+    snprintf(log->text + used, sizeof(log->text) - used, "%s%.*s ", event, (int)length, data);
+}
+
+int on_start_object(void* user) {
+    log_event(user, "{", "", 0);
+    return JSON_SUCCESS;
+}
+
+int on_end_object(void* user) {
+    log_event(user, "}", "", 0);
+    return JSON_SUCCESS;
+}
+
+int on_start_array(void* user) {
+    event_log* log = user;
+    log_event(log, "[", "", 0);
+    return log->skip_arrays ? JSON_EVENT_SKIP : JSON_SUCCESS;
+}
+
+int on_end_array(void* user) {
+    log_event(user, "]", "", 0);
+    return JSON_SUCCESS;
+}
+
+int on_key(void* user, const char* key, size_t length) {
+    event_log* log = user;
+    log_event(log, "k:", key, length);
+    if (log->stop_at_key && strlen(log->stop_at_key) == length && strncmp(key, log->stop_at_key, length) == 0) {
+        return JSON_EVENT_STOP;
+    }
+    if (log->skip_key && strlen(log->skip_key) == length && strncmp(key, log->skip_key, length) == 0) {
+        return JSON_EVENT_SKIP;
+    }
+    return JSON_SUCCESS;
+}
+
+int on_string(void* user, const char* string, size_t length) {
+    log_event(user, "s:", string, length);
+    return JSON_SUCCESS;
+}
+
+int on_number(void* user, double number, int64_t integer, int is_integer) {
+    char text[64];
+    if (is_integer) {
+        snprintf(text, sizeof(text), "%lld", (long long)integer);
+    } else {
+        snprintf(text, sizeof(text), "%g", number);
+    }
+    log_event(user, is_integer ? "i:" : "d:", text, strlen(text));
+    return JSON_SUCCESS;
+}
+
+int on_boolean(void* user, int boolean) {
+    log_event(user, boolean ? "true" : "false", "", 0);
+    return JSON_SUCCESS;
+}
+
+int on_null(void* user) {
+    log_event(user, "null", "", 0);
+    return JSON_SUCCESS;
+}
+
+const jevents logging_events = {
+    .start_object = on_start_object,
+    .end_object = on_end_object,
+    .start_array = on_start_array,
+    .end_array = on_end_array,
+    .key = on_key,
+    .string = on_string,
+    .number = on_number,
+    .boolean = on_boolean,
+    .null = on_null
+};
+
+const char* document = "{ \"id\" : 7, \"tags\" : [\"a\", \"b\\\"\"], \"pos\" : { \"x\" : 1.5, \"y\" : [true, false, null] }, \"last\" : null }";
+
+int check_log(event_log* log, const char* text, const char* expected, const int verbose) {
+    if (json_parse_events(text, &logging_events, log) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_EVENTS failed (%s)\n", text);
+        }
+        return 1;
+    }
+    if (strcmp(log->text, expected) != 0) {
+        if (verbose) {
+            printf("Events were \"%s\", expected \"%s\"\n", log->text, expected);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int events_all_test(const int verbose) {
+    event_log log = {0};
+    return check_log(&log, document,
+                     "{ k:id i:7 k:tags [ s:a s:b\" ] k:pos { k:x d:1.5 k:y [ true false null ] } k:last null } ", verbose);
+}
+
+int events_stop_test(const int verbose) {
+    // stopping succeeds without reading on, so even garbage after the stop point is fine
+    event_log log = { .stop_at_key = "pos" };
+    if (check_log(&log, "{ \"id\" : 7, \"pos\" : this is never looked at", "{ k:id i:7 k:pos ", verbose)) {
+        return 1;
+    }
+    // but garbage before it isn't
+    event_log broken = { .stop_at_key = "pos" };
+    if (json_parse_events("{ \"id\" : 7 7, \"pos\" : 1 }", &logging_events, &broken) != JSON_FAILURE) {
+        if (verbose) {
+            printf("Syntax error before the stop was accepted\n");
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int events_skip_test(const int verbose) {
+    event_log by_key = { .skip_key = "pos" };
+    if (check_log(&by_key, document, "{ k:id i:7 k:tags [ s:a s:b\" ] k:pos k:last null } ", verbose)) {
+        return 1;
+    }
+    event_log scalar = { .skip_key = "id" };
+    if (check_log(&scalar, document, "{ k:id k:tags [ s:a s:b\" ] k:pos { k:x d:1.5 k:y [ true false null ] } k:last null } ", verbose)) {
+        return 1;
+    }
+    event_log arrays = { .skip_arrays = 1 };
+    if (check_log(&arrays, document, "{ k:id i:7 k:tags [ k:pos { k:x d:1.5 k:y [ } k:last null } ", verbose)) {
+        return 1;
+    }
+    // skipped values still have to be valid
+    event_log broken = { .skip_key = "pos" };
+    if (json_parse_events("{ \"pos\" : [1, 2,, 3] }", &logging_events, &broken) != JSON_FAILURE) {
+        if (verbose) {
+            printf("Syntax error in a skipped value was accepted\n");
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int events_partial_test(const int verbose) {
+    // callbacks that aren't set are just not called
+    jevents keys_only = { .key = on_key };
+    event_log log = {0};
+    if (json_parse_events(document, &keys_only, &log) != JSON_SUCCESS || strcmp(log.text, "k:id k:tags k:pos k:x k:y k:last ") != 0) {
+        if (verbose) {
+            printf("Events were \"%s\"\n", log.text);
+        }
+        return 1;
+    }
+    // and the same events come out of a push parser fed a byte at a time
+    event_log pushed = {0};
+    jparser* p = jparser_create_events(&logging_events, &pushed);
+    int result = JSON_SUCCESS;
+    for (size_t i = 0; document[i] != '\0' && result == JSON_SUCCESS; i++) {
+        result = jparser_feed(p, document + i, 1);
+    }
+    if (result == JSON_SUCCESS) {
+        result = jparser_finish(p);
+    }
+    jparser_destroy(p);
+    event_log whole = {0};
+    json_parse_events(document, &logging_events, &whole);
+    if (result != JSON_SUCCESS || strcmp(pushed.text, whole.text) != 0) {
+        if (verbose) {
+            printf("Pushed events were \"%s\"\n", pushed.text);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Events\n");
+    run_test(events_all_test, "events_all", verbose);
+    run_test(events_stop_test, "events_stop", verbose);
+    run_test(events_skip_test, "events_skip", verbose);
+    run_test(events_partial_test, "events_partial", verbose);
+    return 0;
+}
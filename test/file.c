@@ -0,0 +1,152 @@
+//
+// File (memory-mapped) parsing tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+const char* document = "{ \"name\" : \"tiny\", \"list\" : [1, 2.5, \"x\", { \"deep\" : [true, null] }], \"n\" : -7 }\n";
+
+// write length bytes of text to a fresh temporary file, returns its path (free it) or NULL
+char* write_file(const char* text, size_t length) {
+    char* path = malloc(32);
+    strcpy(path, "/tmp/tinyjson_XXXXXX");
+    int fd = mkstemp(path);
+    FILE* file = fd < 0 ? NULL : fdopen(fd, "wb");
+    if (file == NULL || fwrite(text, 1, length, file) != length) {
+        free(path);
+        return NULL;
+    }
+    fclose(file);
+    return path;
+}
+
+int file_parse_test(const int verbose) {
+    char* path = write_file(document, strlen(document));
+    char* cursor = (char*)document;
+    jvalue* expected = calloc(1, sizeof(jvalue));
+    json_parse_value(&cursor, expected);
+    char* expected_str = json_write_to_str(expected, JSON_WRITE_COMPACT, NULL);
+    // the in-situ and lazy flags are dropped, since the mapping goes away
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INSITU | JSON_PARSE_LAZY };
+    int failed = path == NULL || json_parse_file(path, json, &opts) != JSON_SUCCESS;
+    char* out = failed ? NULL : json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    if (!failed && (out == NULL || strcmp(out, expected_str) != 0)) {
+        if (verbose) {
+            printf("File parsed as %s\n", out ? out : "(failure)");
+        }
+        failed = 2;
+    }
+    free(out);
+    json_free_value(json);
+    json_free_value(expected);
+    free(expected_str);
+    if (path != NULL) {
+        remove(path);
+    }
+    free(path);
+    return failed;
+}
+
+int file_mapping_test(const int verbose) {
+    char* path = write_file(document, strlen(document));
+    jmapping* map = path == NULL ? NULL : json_map_file(path);
+    if (map == NULL || json_mapping_length(map) != strlen(document)) {
+        if (verbose) {
+            printf("JSON_MAP_FILE failed\n");
+        }
+        json_unmap_file(map);
+        free(path);
+        return 1;
+    }
+    // values can point into the mapping as long as it's around
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INSITU | JSON_PARSE_LAZY };
+    int failed = json_parse_mapping(map, json, &opts) != JSON_SUCCESS;
+    jvalue* name = failed ? NULL : json_search_by_key("name", json);
+    jvalue* deep = failed ? NULL : json_search_by_key("deep", json_array_at(json_search_by_key("list", json), 3));
+    if (!failed && (name == NULL || strcmp(name->string, "tiny") != 0 || !(name->flags & JSON_FLAG_BORROWED)
+                    || name->string < json_mapping_data(map) || name->string >= json_mapping_data(map) + json_mapping_length(map)
+                    || deep == NULL || json_array_at(deep, 0)->boolean != 1)) {
+        failed = 2;
+    }
+    json_free_value(json);
+    json_unmap_file(map);
+    // in-situ parsing wrote to the mapping, but not to the file
+    char contents[128] = {0};
+    FILE* file = fopen(path, "rb");
+    if (file == NULL || fread(contents, 1, sizeof(contents) - 1, file) != strlen(document) || strcmp(contents, document) != 0) {
+        failed = 3;
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+    if (failed && verbose) {
+        printf("Mapping check %d failed\n", failed);
+    }
+    remove(path);
+    free(path);
+    return failed;
+}
+
+int file_bounds_test(const int verbose) {
+    // a whole page of input that ends right on a number: nothing past the end of the mapping may be read
+    char page[4096];
+    memset(page, ' ', sizeof(page));
+    memcpy(page + sizeof(page) - 9, "-1234.5e2", 9);
+    int failed = 0;
+    char* path = write_file(page, sizeof(page));
+    jvalue* json = calloc(1, sizeof(jvalue));
+    if (path == NULL || json_parse_file(path, json, NULL) != JSON_SUCCESS || json->type != JSON_NUMBER || json->number != -1234.5e2) {
+        failed = 1;
+    }
+    json_free_value(json);
+    // same for literals and unterminated strings
+    const char* broken[] = { "tru", "[1, 2", "\"abc", "{\"a\" : ", "" };
+    for (size_t i = 0; !failed && i < sizeof(broken) / sizeof(broken[0]); i++) {
+        remove(path);
+        free(path);
+        path = write_file(broken[i], strlen(broken[i]));
+        json = calloc(1, sizeof(jvalue));
+        if (path == NULL || json_parse_file(path, json, NULL) != JSON_FAILURE) {
+            if (verbose) {
+                printf("\"%s\" was accepted\n", broken[i]);
+            }
+            failed = 2;
+        }
+        json_free_value(json);
+    }
+    json = calloc(1, sizeof(jvalue));
+    if (json_parse_file("/nonexistent/tinyjson.json", json, NULL) != JSON_FAILURE) {
+        failed = 3;
+    }
+    json_free_value(json);
+    if (failed && verbose) {
+        printf("Bounds check %d failed\n", failed);
+    }
+    if (path != NULL) {
+        remove(path);
+    }
+    free(path);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("File parsing\n");
+    run_test(file_parse_test, "file_parse", verbose);
+    run_test(file_mapping_test, "file_mapping", verbose);
+    run_test(file_bounds_test, "file_bounds", verbose);
+    return 0;
+}
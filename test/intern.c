@@ -0,0 +1,198 @@
+//
+// Key interning tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+jvalue* parse(const char* text, jintern* table, unsigned int flags) {
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = flags, .intern = table };
+    if (json_parse_n(text, strlen(text), json, &opts, NULL) != JSON_SUCCESS) {
+        json_free_value(json);
+        return NULL;
+    }
+    return json;
+}
+
+int intern_shared_test(const int verbose) {
+    jintern* table = json_intern_create();
+    const char* text = "{\"name\": \"a\", \"tags\": [{\"name\": \"b\"}], \"n\\u0061me\": 1}";
+    jvalue* first = parse(text, table, 0);
+    jvalue* second = parse(text, table, 0);
+    int failed = first == NULL || second == NULL;
+    // every "name" in both trees (escaped or not) is the same string
+    const char* name = json_intern(table, "name");
+    if (!failed && (first->members[0].key != name || second->members[0].key != name || first->members[2].key != name
+                    || json_search_by_key("tags", first)->elements[0].members[0].key != name
+                    || !(first->members[0].flags & JSON_FLAG_INTERNED))) {
+        if (verbose) {
+            printf("Keys weren't shared\n");
+        }
+        failed = 1;
+    }
+    // both lookups find the first one
+    if (!failed && (strcmp(json_search_interned(name, second)->string, "a") != 0
+                    || strcmp(json_search_by_key("name", second)->string, "a") != 0
+                    || json_search_interned(json_intern(table, "missing"), second) != NULL)) {
+        failed = 2;
+    }
+    // 8 keys went in, 2 of them different (plus "missing", which json_intern added but doesn't count as a reference)
+    jintern_stats stats;
+    json_intern_stats(table, &stats);
+    if (!failed && (stats.keys != 3 || stats.references != 8 || stats.referenced_bytes != 8 * 5 || stats.bytes == 0)) {
+        if (verbose) {
+            printf("Stats: %zu keys, %zu references, %zu bytes referenced\n", stats.keys, stats.references, stats.referenced_bytes);
+        }
+        failed = 3;
+    }
+    // the trees can be changed and freed as usual, and the table stays intact
+    json_delete_first_member("name", first);
+    json_delete_all_members("name", second);
+    if (!failed && (json_search_interned(name, first)->number != 1 || json_search_by_key("name", second) != NULL
+                    || strcmp(json_intern(table, "name"), "name") != 0)) {
+        failed = 4;
+    }
+    // writing is unchanged
+    char* out = json_write_to_str(first, JSON_WRITE_COMPACT, NULL);
+    if (!failed && strcmp(out, "{\"tags\":[{\"name\":\"b\"}],\"name\":1}") != 0) {
+        failed = 5;
+    }
+    free(out);
+    json_free_value(first);
+    json_free_value(second);
+    json_intern_destroy(table);
+    return failed;
+}
+
+int intern_modes_test(const int verbose) {
+    // wide enough to be indexed, in every parser that builds trees
+    char text[1024];
+    char* pos = text + sprintf(text, "{\"k0\": 0");
+    for (int i = 1; i < 30; i++) {
+        pos += sprintf(pos, ", \"k%d\": %d", i, i);
+    }
+    sprintf(pos, "}");
+    jintern* table = json_intern_create();
+    jvalue* trees[5];
+    trees[0] = parse(text, table, JSON_PARSE_INDEX);
+    trees[1] = parse(text, table, JSON_PARSE_LAZY);
+    // in-situ parses still intern their keys, only strings point into the buffer
+    char insitu[1024];
+    strcpy(insitu, text);
+    trees[2] = parse(insitu, table, JSON_PARSE_INSITU);
+    const jparse_options opts = { .flags = JSON_PARSE_INDEX, .intern = table };
+    trees[3] = calloc(1, sizeof(jvalue));
+    jparser* p = jparser_create(trees[3], &opts);
+    jparser_feed(p, text, 500);
+    jparser_feed(p, text + 500, strlen(text) - 500);
+    jparser_finish(p);
+    jparser_destroy(p);
+    jvalue* plain = parse(text, NULL, 0);
+    size_t length;
+    char* data = json_binary_encode(plain, &length);
+    trees[4] = calloc(1, sizeof(jvalue));
+    json_binary_decode(data, length, trees[4], &opts);
+    free(data);
+    int failed = 0;
+    for (int t = 0; t < 5; t++) {
+        for (int i = 0; !failed && i < 30; i++) {
+            char key[16];
+            sprintf(key, "k%d", i);
+            const char* interned = json_intern(table, key);
+            const jvalue* found = json_search_interned(interned, trees[t]);
+            if (found == NULL || found->number != i || json_member_at(trees[t], i)->key != interned) {
+                if (verbose) {
+                    printf("Tree %d: %s went wrong\n", t, key);
+                }
+                failed = 1;
+            }
+        }
+        json_free_value(trees[t]);
+    }
+    // a key interned by another table is still found, just not by its pointer
+    jintern* other = json_intern_create();
+    if (!failed && json_search_interned(json_intern(other, "k7"), plain)->number != 7) {
+        failed = 2;
+    }
+    jvalue* tree = parse(text, table, 0);
+    if (!failed && (json_search_interned(json_intern(other, "k7"), tree)->number != 7
+                    || json_search_interned(json_intern(other, "k70"), tree) != NULL)) {
+        failed = 3;
+    }
+    json_free_value(tree);
+    json_free_value(plain);
+    json_intern_destroy(other);
+    jintern_stats stats;
+    json_intern_stats(table, &stats);
+    if (!failed && (stats.keys != 30 || stats.references != 6 * 30)) {
+        if (verbose) {
+            printf("Stats: %zu keys, %zu references\n", stats.keys, stats.references);
+        }
+        failed = 4;
+    }
+    json_intern_destroy(table);
+    return failed;
+}
+
+#define RECORDS 20000
+
+int intern_ndjson_test(const int verbose) {
+    // every thread adds keys at once, enough of them that the table has to grow while others are reading it
+    char* buffer = malloc(RECORDS * 64);
+    char* pos = buffer;
+    for (int i = 0; i < RECORDS; i++) {
+        pos += sprintf(pos, "{\"id\": %d, \"key%d\": true, \"shared\": null}\n", i, i % 500);
+    }
+    jintern* table = json_intern_create();
+    const jndjson_options opts = { .threads = 8, .intern = table };
+    size_t count;
+    jvalue** values = json_parse_ndjson_array(buffer, pos - buffer, &opts, &count);
+    int failed = values == NULL || count != RECORDS;
+    const char* shared = json_intern(table, "shared");
+    for (size_t i = 0; !failed && i < count; i++) {
+        char key[16];
+        sprintf(key, "key%zu", i % 500);
+        if (values[i] == NULL || values[i]->members[2].key != shared || values[i]->members[1].key != json_intern(table, key)
+            || json_search_interned(json_intern(table, "id"), values[i])->number != (double)i) {
+            if (verbose) {
+                printf("Record %zu went wrong\n", i);
+            }
+            failed = 1;
+        }
+    }
+    for (size_t i = 0; values != NULL && i < count; i++) {
+        json_free_value(values[i]);
+    }
+    free(values);
+    jintern_stats stats;
+    json_intern_stats(table, &stats);
+    if (!failed && (stats.keys != 502 || stats.references != 3 * RECORDS || stats.bytes >= stats.referenced_bytes)) {
+        if (verbose) {
+            printf("Stats: %zu keys, %zu bytes for %zu referenced\n", stats.keys, stats.bytes, stats.referenced_bytes);
+        }
+        failed = 2;
+    }
+    json_intern_destroy(table);
+    free(buffer);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Key interning\n");
+    run_test(intern_shared_test, "intern_shared", verbose);
+    run_test(intern_modes_test, "intern_modes", verbose);
+    run_test(intern_ndjson_test, "intern_ndjson", verbose);
+    return 0;
+}
@@ -0,0 +1,125 @@
+//
+// Lazy parsing tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+const char* document = "{ \"status\" : \"ok\", \"data\" : { \"items\" : [ {\"id\": 1, \"s\": \"]}\\\"\"}, {\"id\": 2} ], \"n\" : [] }, \"tail\" : [[1], {}] }";
+
+int lazy_lookup_test(const int verbose) {
+    char* in = (char*)document;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_LAZY };
+    if (json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE_OPTS failed (%s)\n", in);
+        }
+        json_free_value(json);
+        return 1;
+    }
+    int failed = 0;
+    // the top level is parsed, everything under it waits
+    jvalue* status = json_search_by_key("status", json);
+    jvalue* data = json_search_by_key("data", json);
+    jvalue* tail = json_search_by_key("tail", json);
+    if (status == NULL || strcmp(status->string, "ok") != 0 || data == NULL || !(data->flags & JSON_FLAG_LAZY)
+        || tail == NULL || !(tail->flags & JSON_FLAG_LAZY) || tail->length != 0) {
+        failed = 1;
+    }
+    // looking into data parses data, but not items
+    jvalue* items = failed ? NULL : json_search_by_key("items", data);
+    if (!failed && (data->flags & JSON_FLAG_LAZY || items == NULL || !(items->flags & JSON_FLAG_LAZY))) {
+        failed = 2;
+    }
+    jvalue* second = failed ? NULL : json_array_at(items, 1);
+    jvalue* first_s = failed ? NULL : json_search_by_key("s", json_array_at(items, 0));
+    if (!failed && (second == NULL || json_search_by_key("id", second)->number != 2 || first_s == NULL
+                    || strcmp(first_s->string, "]}\"") != 0 || json_array_at(items, 2) != NULL)) {
+        failed = 3;
+    }
+    // writing parses whatever is still lazy, and gives the same text as an eager parse
+    char* eager_in = (char*)document;
+    jvalue* eager = calloc(1, sizeof(jvalue));
+    json_parse_value(&eager_in, eager);
+    char* expected = json_write_to_str(eager, JSON_WRITE_COMPACT, NULL);
+    char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    if (!failed && (out == NULL || strcmp(out, expected) != 0)) {
+        if (verbose) {
+            printf("Lazy document wrote as %s\n", out ? out : "(failure)");
+        }
+        failed = 4;
+    }
+    if (failed && verbose) {
+        printf("Lazy check %d failed\n", failed);
+    }
+    free(out);
+    free(expected);
+    json_free_value(eager);
+    json_free_value(json);
+    return failed;
+}
+
+int lazy_arena_test(const int verbose) {
+    jarena* arena = json_arena_create(0);
+    char* in = (char*)document;
+    jvalue* json = json_arena_alloc(arena, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_LAZY, .arena = arena };
+    int failed = json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS;
+    jvalue* inner = failed ? NULL : json_search_by_key("n", json_search_by_key("data", json));
+    if (!failed && (inner == NULL || inner->type != JSON_ARRAY || json_materialize(inner) != JSON_SUCCESS || inner->length != 0)) {
+        failed = 2;
+    }
+    if (failed && verbose) {
+        printf("Lazy arena check %d failed\n", failed);
+    }
+    json_arena_destroy(arena);
+    return failed;
+}
+
+int lazy_invalid_test(const int verbose) {
+    // unbalanced brackets are caught up front
+    char* in = "{ \"a\" : [1, 2, { \"b\" : 3 ] }";
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_LAZY };
+    if (json_parse_value_opts(&in, json, &opts) == JSON_SUCCESS) {
+        if (verbose) {
+            printf("Unbalanced input was accepted\n");
+        }
+        json_free_value(json);
+        return 1;
+    }
+    json_free_value(json);
+    // other syntax errors only when the span is parsed: the lookup fails and the value stays lazy
+    in = "{ \"a\" : { \"b\" 3 } }";
+    json = calloc(1, sizeof(jvalue));
+    int failed = json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS;
+    jvalue* a = failed ? NULL : json_search_by_key("a", json);
+    if (!failed && (a == NULL || json_search_by_key("b", a) != NULL || !(a->flags & JSON_FLAG_LAZY))) {
+        failed = 2;
+    }
+    if (failed && verbose) {
+        printf("Lazy invalid check %d failed\n", failed);
+    }
+    json_free_value(json);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Lazy parsing\n");
+    run_test(lazy_lookup_test, "lazy_lookup", verbose);
+    run_test(lazy_arena_test, "lazy_arena", verbose);
+    run_test(lazy_invalid_test, "lazy_invalid", verbose);
+    return 0;
+}
@@ -0,0 +1,142 @@
+//
+// Newline-delimited JSON tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+#define RECORDS 20000
+
+// RECORDS records, every 1000th of them cut off, with blank lines and carriage returns mixed in
+char* make_input(size_t* length) {
+    char* buffer = malloc(RECORDS * 64);
+    char* pos = buffer;
+    for (int i = 0; i < RECORDS; i++) {
+        if (i % 1000 == 999) {
+            pos += sprintf(pos, "{\"id\": %d, \"truncated\": [1, \n", i);
+        } else {
+            pos += sprintf(pos, "{\"id\": %d, \"tags\": [\"t%d\"]}%s\n", i, i % 7, i % 3 ? "" : "\r");
+        }
+        if (i % 500 == 0) {
+            pos += sprintf(pos, "   \n\n");
+        }
+    }
+    *length = pos - buffer - 1; // no newline after the last record
+    return buffer;
+}
+
+typedef struct check_state {
+    size_t next; // record the callback expects next
+    int bad; // records out of order or with the wrong contents
+    size_t nulls;
+    size_t stop_at;
+} check_state;
+
+int check_record(void* user, size_t record, jvalue* value) {
+    check_state* state = user;
+    int broken = record % 1000 == 999;
+    if (record != state->next++ || (value == NULL) != broken) {
+        state->bad++;
+    }
+    if (value == NULL) {
+        state->nulls++;
+    } else {
+        jvalue* id = json_search_by_key("id", value);
+        if (id == NULL || id->number != (double)record) {
+            state->bad++;
+        }
+    }
+    return record + 1 == state->stop_at ? JSON_FAILURE : JSON_SUCCESS;
+}
+
+int ndjson_callback_test(const int verbose) {
+    size_t length;
+    char* buffer = make_input(&length);
+    for (unsigned int threads = 1; threads <= 8; threads *= 2) {
+        check_state state = {0};
+        const jndjson_options opts = { .threads = threads };
+        int result = json_parse_ndjson(buffer, length, &opts, check_record, &state);
+        if (result != JSON_FAILURE || state.next != RECORDS || state.bad != 0 || state.nulls != RECORDS / 1000) {
+            if (verbose) {
+                printf("%u threads: %zu records, %d bad, %zu failed\n", threads, state.next, state.bad, state.nulls);
+            }
+            free(buffer);
+            return 1;
+        }
+    }
+    // the callback can stop the whole thing
+    check_state state = { .stop_at = 5000 };
+    const jndjson_options opts = { .threads = 4 };
+    if (json_parse_ndjson(buffer, length, &opts, check_record, &state) != JSON_FAILURE || state.next != 5000) {
+        if (verbose) {
+            printf("Stopping at 5000 delivered %zu records\n", state.next);
+        }
+        free(buffer);
+        return 1;
+    }
+    free(buffer);
+    return 0;
+}
+
+int ndjson_array_test(const int verbose) {
+    size_t length;
+    char* buffer = make_input(&length);
+    const jndjson_options opts = { .threads = 4 };
+    size_t count = 0;
+    jvalue** values = json_parse_ndjson_array(buffer, length, &opts, &count);
+    int failed = values == NULL || count != RECORDS;
+    for (size_t i = 0; !failed && i < count; i++) {
+        if ((values[i] == NULL) != (i % 1000 == 999)) {
+            failed = 1;
+        } else if (values[i] != NULL && json_search_by_key("id", values[i])->number != (double)i) {
+            failed = 1;
+        }
+    }
+    if (failed && verbose) {
+        printf("Array of %zu records is incorrect\n", count);
+    }
+    for (size_t i = 0; values != NULL && i < count; i++) {
+        json_free_value(values[i]);
+    }
+    free(values);
+    // projected down to the ids, with the cut off records still failing
+    const char* fields[] = { "/id" };
+    jpaths* projection = json_paths_compile(fields, 1);
+    const jndjson_options projected = { .threads = 4, .projection = projection };
+    values = json_parse_ndjson_array(buffer, length, &projected, &count);
+    for (size_t i = 0; values != NULL && i < count; i++) {
+        if ((values[i] == NULL) != (i % 1000 == 999)
+            || (values[i] != NULL && (values[i]->length != 1 || values[i]->members[0].value.number != (double)i))) {
+            failed = 2;
+        }
+        json_free_value(values[i]);
+    }
+    free(values);
+    json_paths_free(projection);
+    // and an empty buffer is zero records
+    values = json_parse_ndjson_array("", 0, NULL, &count);
+    if (values == NULL || count != 0) {
+        failed = 1;
+    }
+    free(values);
+    free(buffer);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("NDJSON\n");
+    run_test(ndjson_callback_test, "ndjson_callback", verbose);
+    run_test(ndjson_array_test, "ndjson_array", verbose);
+    return 0;
+}
@@ -0,0 +1,200 @@
+//
+// Object tests (key search, member add/delete, hash indexes on wide objects)
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// build {"k0" : 0, "k1" : 1, ..., "dup" : -1, "dup" : -2} with count numbered keys
+char* wide_object(const int count) {
+    char* text = malloc(count * 24 + 64);
+    char* pos = text;
+    pos += sprintf(pos, "{");
+    for (int i = 0; i < count; i++) {
+        pos += sprintf(pos, "\"k%d\" : %d, ", i, i);
+    }
+    sprintf(pos, "\"dup\" : -1, \"dup\" : -2}");
+    return text;
+}
+
+// check that every numbered key maps to its own value, and dup maps to expected_dup
+int check_lookups(const jvalue* obj, const int count, const double expected_dup, const int verbose) {
+    char key[32];
+    for (int i = count - 1; i >= 0; i--) {
+        sprintf(key, "k%d", i);
+        jvalue* found = json_search_by_key(key, obj);
+        if (found == NULL || found->number != i) {
+            if (verbose) {
+                printf("Lookup of %s failed\n", key);
+            }
+            return 1;
+        }
+    }
+    jvalue* dup = json_search_by_key("dup", obj);
+    if (dup == NULL || dup->number != expected_dup) {
+        if (verbose) {
+            printf("Lookup of duplicate key returned the wrong member\n");
+        }
+        return 1;
+    }
+    if (json_search_by_key("missing", obj) != NULL) {
+        if (verbose) {
+            printf("Lookup of a missing key succeeded\n");
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int index_lazy_test(const int verbose) {
+    char* text = wide_object(1000);
+    char* in = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    if (json_parse_value(&in, json) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE failed\n");
+        }
+        json_free_value(json);
+        free(text);
+        return 1;
+    }
+    int result = check_lookups(json, 1000, -1, verbose);
+    if (!result && json->index == NULL) {
+        if (verbose) {
+            printf("Wide object was not indexed\n");
+        }
+        result = 1;
+    }
+    json_free_value(json);
+    free(text);
+    return result;
+}
+
+int index_eager_test(const int verbose) {
+    char* text = wide_object(100);
+    char* in = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INDEX };
+    if (json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS || json->index == NULL) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE_OPTS failed or didn't index\n");
+        }
+        json_free_value(json);
+        free(text);
+        return 1;
+    }
+    int result = check_lookups(json, 100, -1, verbose);
+    json_free_value(json);
+    free(text);
+    return result;
+}
+
+int index_mutation_test(const int verbose) {
+    char* text = wide_object(200);
+    char* in = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INDEX };
+    if (json_parse_value_opts(&in, json, &opts) != JSON_SUCCESS) {
+        json_free_value(json);
+        free(text);
+        return 1;
+    }
+    int result = 0;
+    // deleting the first duplicate exposes the second one
+    json_delete_first_member("dup", json);
+    if (check_lookups(json, 200, -2, verbose)) {
+        result = 1;
+    }
+    // adding a member with a key that's there already makes it the first match
+    jvalue* added = calloc(1, sizeof(jvalue));
+    added->type = JSON_NUMBER;
+    added->number = -3;
+    json_add_member("dup", added, json);
+    if (!result && check_lookups(json, 200, -3, verbose)) {
+        result = 1;
+    }
+    // and deleting every instance removes the key
+    json_delete_all_members("dup", json);
+    if (!result && json_search_by_key("dup", json) != NULL) {
+        if (verbose) {
+            printf("Deleted key is still found\n");
+        }
+        result = 1;
+    }
+    // add enough fresh keys to make the index grow
+    for (int i = 0; !result && i < 500; i++) {
+        char key[32];
+        sprintf(key, "new%d", i);
+        jvalue* value = calloc(1, sizeof(jvalue));
+        value->type = JSON_NULL;
+        json_add_member(key, value, json);
+    }
+    if (!result && (json_search_by_key("new499", json) == NULL || json_search_by_key("k0", json)->number != 0)) {
+        if (verbose) {
+            printf("Lookup after growing the index failed\n");
+        }
+        result = 1;
+    }
+    json_free_value(json);
+    free(text);
+    return result;
+}
+
+int build_wide_test(const int verbose) {
+    // a wide object built a member at a time, in order, then a few keys added a second time to shadow the first ones
+    // (new keys go on the end, so this stays linear)
+    const int count = 50000;
+    const int shadowed = 100;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    json->type = JSON_OBJECT;
+    int result = 0;
+    for (int i = 0; !result && i < count + shadowed; i++) {
+        char key[32];
+        sprintf(key, "k%d", i < count ? i : (i - count) * 2);
+        jvalue* value = calloc(1, sizeof(jvalue));
+        value->type = JSON_NUMBER;
+        value->number = i;
+        result = json_add_member(key, value, json);
+    }
+    if (!result && (json->length != (size_t)(count + shadowed) || strcmp(json->members[0].key, "k0") != 0
+                    || json->members[0].value.number != count || json->members[1].value.number != 0
+                    || strcmp(json->members[json->length - 1].key, "k49999") != 0)) {
+        if (verbose) {
+            printf("Members aren't where they should be\n");
+        }
+        result = 1;
+    }
+    for (int i = 0; !result && i < count; i++) {
+        char key[32];
+        sprintf(key, "k%d", i);
+        const jvalue* found = json_search_by_key(key, json);
+        if (found == NULL || found->number != (i % 2 || i >= shadowed * 2 ? i : count + i / 2)) {
+            if (verbose) {
+                printf("Lookup of %s failed\n", key);
+            }
+            result = 2;
+        }
+    }
+    json_free_value(json);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Objects\n");
+    run_test(index_lazy_test, "index_lazy", verbose);
+    run_test(index_eager_test, "index_eager", verbose);
+    run_test(index_mutation_test, "index_mutation", verbose);
+    run_test(build_wide_test, "build_wide", verbose);
+    return 0;
+}
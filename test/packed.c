@@ -0,0 +1,332 @@
+//
+// Packed numeric array tests
+// For absolute best coverage run with valgrind
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+jvalue* parse(const char* text, unsigned int flags) {
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = flags };
+    if (json_parse_n(text, strlen(text), json, &opts, NULL) != JSON_SUCCESS) {
+        json_free_value(json);
+        return NULL;
+    }
+    return json;
+}
+
+int packed_kinds_test(const int verbose) {
+    const char* text = "{\"ints\": [1, -2, 123456789012, 9223372036854775807, -9223372036854775808, 0],"
+                       " \"mixed\": [ 1 , 2.5,3e2, -0 ], \"late\": [1, 2, \"three\"], \"nested\": [[1, 2], [3.5], []],"
+                       " \"one\": [42], \"big\": [12345678901234567890]}";
+    jvalue* json = parse(text, JSON_PARSE_PACK_NUMBERS);
+    int failed = json == NULL;
+    if (failed) {
+        return failed;
+    }
+    const jvalue* ints = json_search_by_key("ints", json);
+    const int64_t* integers = json_array_integers(ints);
+    if (integers == NULL || json_array_doubles(ints) != NULL || json_length(ints) != 6 || integers[2] != 123456789012LL
+        || integers[3] != INT64_MAX || integers[4] != INT64_MIN || integers[1] != -2) {
+        if (verbose) {
+            printf("Integers didn't pack\n");
+        }
+        failed = 1;
+    }
+    // one double turns the whole array into doubles, -0 included
+    const jvalue* mixed = json_search_by_key("mixed", json);
+    const double* doubles = json_array_doubles(mixed);
+    if (!failed && (doubles == NULL || json_array_integers(mixed) != NULL || mixed->length != 4 || doubles[0] != 1
+                    || doubles[1] != 2.5 || doubles[2] != 300 || doubles[3] != 0 || !signbit(doubles[3]))) {
+        failed = 2;
+    }
+    // anything but numbers, and the array is an array like any other
+    const jvalue* late = json_search_by_key("late", json);
+    const jvalue* nested = json_search_by_key("nested", json);
+    if (!failed && ((late->flags & JSON_FLAG_PACKED) || strcmp(late->elements[2].string, "three") != 0
+                    || (nested->flags & JSON_FLAG_PACKED) || json_array_integers(&nested->elements[0])[1] != 2
+                    || json_array_doubles(&nested->elements[1])[0] != 3.5 || (nested->elements[2].flags & JSON_FLAG_PACKED)
+                    || json_array_integers(json_search_by_key("one", json))[0] != 42)) {
+        failed = 3;
+    }
+    // too big for an integer, so it's a double
+    const double* big = json_array_doubles(json_search_by_key("big", json));
+    if (!failed && (big == NULL || big[0] != 12345678901234567890.0)) {
+        failed = 4;
+    }
+    // written back out the same, except for integers among doubles
+    char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    const char* expected = "{\"ints\":[1,-2,123456789012,9223372036854775807,-9223372036854775808,0],"
+                           "\"mixed\":[1.0,2.5,3e2,-0.0],\"late\":[1,2,\"three\"],\"nested\":[[1,2],[3.5],[]],"
+                           "\"one\":[42],\"big\":[1.2345678901234567e19]}";
+    if (!failed && strcmp(out, expected) != 0) {
+        if (verbose) {
+            printf("Wrote %s\n", out);
+        }
+        failed = 5;
+    }
+    free(out);
+    // pretty output matches an unpacked tree's
+    jvalue* plain = parse("{\"a\": [[1, 2], {\"b\": [3, 4]}]}", 0);
+    jvalue* packed = parse("{\"a\": [[1, 2], {\"b\": [3, 4]}]}", JSON_PARSE_PACK_NUMBERS);
+    char* plain_out = json_write_to_str(plain, JSON_WRITE_PRETTY, NULL);
+    char* packed_out = json_write_to_str(packed, JSON_WRITE_PRETTY, NULL);
+    if (!failed && strcmp(plain_out, packed_out) != 0) {
+        failed = 6;
+    }
+    free(plain_out);
+    free(packed_out);
+    json_free_value(plain);
+    json_free_value(packed);
+    json_free_value(json);
+    return failed;
+}
+
+int packed_access_test(const int verbose) {
+    const char* text = "{\"data\": [10, 20, 30], \"more\": [0.5, 1.5], \"lazy\": {\"x\": [7, 8]}}";
+    const unsigned int modes[] = { JSON_PARSE_PACK_NUMBERS, JSON_PARSE_PACK_NUMBERS | JSON_PARSE_LAZY };
+    int failed = 0;
+    for (int mode = 0; !failed && mode < 2; mode++) {
+        jvalue* json = parse(text, modes[mode]);
+        jvalue* data = json_search_by_key("data", json);
+        // numbers can be changed in place
+        json_array_integers(data)[1] = 21;
+        // the binary form and tapes are written straight from the numbers
+        size_t length;
+        char* encoded = json_binary_encode(json, &length);
+        jtape* tape = json_tape_from_value(json);
+        if (!(data->flags & JSON_FLAG_PACKED) || encoded == NULL || tape == NULL) {
+            failed = 1;
+        }
+        jvalue* decoded = calloc(1, sizeof(jvalue));
+        if (!failed && (json_binary_decode(encoded, length, decoded, NULL) != JSON_SUCCESS
+                        || json_search_by_key("data", decoded)->elements[1].integer != 21
+                        || json_tape_number(tape, json_tape_index(tape, json_tape_find(tape, JSON_TAPE_ROOT, "more"), 1)) != 1.5)) {
+            failed = 2;
+        }
+        free(encoded);
+        json_tape_free(tape);
+        json_free_value(decoded);
+        // lazy arrays come out packed too, and json_length doesn't unpack them
+        jvalue* x = json_search_by_key("x", json_search_by_key("lazy", json));
+        if (!failed && (json_length(x) != 2 || json_array_integers(x)[1] != 8)) {
+            failed = 3;
+        }
+        // anything that wants jvalues unpacks
+        jpointer* ptr = json_pointer_compile("/more/1");
+        const jvalue* more = json_pointer_get(ptr, json);
+        json_pointer_free(ptr);
+        int sum = 0;
+        JSON_FOR_EACH_ELEMENT(e, data) {
+            sum += (int)e->integer;
+        }
+        if (!failed && (more == NULL || more->number != 1.5 || sum != 61 || (data->flags & JSON_FLAG_PACKED)
+                        || !(data->elements[2].flags & JSON_FLAG_INTEGER) || json_array_integers(data) != NULL
+                        || json_array_at(x, 0)->integer != 7 || json_array_doubles(json_search_by_key("more", json)) != NULL)) {
+            if (verbose) {
+                printf("Mode %d: unpacking went wrong\n", mode);
+            }
+            failed = 4;
+        }
+        json_free_value(json);
+    }
+    // in an arena, where unpacking takes from the same arena
+    jarena* arena = json_arena_create(0);
+    jvalue* json = json_arena_alloc(arena, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_PACK_NUMBERS, .arena = arena };
+    if (!failed && (json_parse_n(text, strlen(text), json, &opts, NULL) != JSON_SUCCESS
+                    || json_array_doubles(json_search_by_key("more", json))[1] != 1.5
+                    || json_array_at(json_search_by_key("data", json), 2)->integer != 30)) {
+        failed = 5;
+    }
+    json_arena_destroy(arena);
+    return failed;
+}
+
+int packed_malformed_test(const int verbose) {
+    // the usual errors, reported by the usual parse
+    const char* bad[] = { "[1, 2,]", "[1, 2", "[01]", "[1 2]", "[-]", "[1.]", "[1e]", "[1, 2}", "[1,,2]", "[--1]" };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        jvalue* json = parse(bad[i], JSON_PARSE_PACK_NUMBERS);
+        if (json != NULL) {
+            if (verbose) {
+                printf("%s parsed\n", bad[i]);
+            }
+            json_free_value(json);
+            failed = 1;
+        }
+    }
+    // a long run of numbers of every length, with the fast path cut off at the end of the input
+    char* text = malloc(200000);
+    char* pos = text + sprintf(text, "[");
+    long long expected = 0;
+    for (int i = 0; i < 10000; i++) {
+        long long n = (long long)i * 1000003 % 1000000000000LL * (i % 2 ? -1 : 1);
+        expected += n;
+        pos += sprintf(pos, i ? ",%lld" : "%lld", n);
+    }
+    sprintf(pos, "]");
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_PACK_NUMBERS };
+    if (!failed && json_parse_n(text, strlen(text), json, &opts, NULL) == JSON_SUCCESS) {
+        long long sum = 0;
+        const int64_t* integers = json_array_integers(json);
+        for (size_t i = 0; integers != NULL && i < json->length; i++) {
+            sum += integers[i];
+        }
+        if (integers == NULL || json->length != 10000 || sum != expected) {
+            failed = 2;
+        }
+    } else {
+        failed = 3;
+    }
+    json_free_value(json);
+    // and a number running right up to the end of a slice
+    json = calloc(1, sizeof(jvalue));
+    if (!failed && (json_parse_n("[12345678901234567]", 18, json, &opts, NULL) != JSON_FAILURE)) {
+        failed = 4;
+    }
+    json_free_value(json);
+    json = calloc(1, sizeof(jvalue));
+    size_t consumed;
+    if (!failed && (json_parse_n("[1234567890123456]9", 18, json, &opts, &consumed) != JSON_SUCCESS
+                    || json_array_integers(json)[0] != 1234567890123456LL || consumed != 18)) {
+        failed = 5;
+    }
+    json_free_value(json);
+    free(text);
+    // truncated arrays in buffers of exactly their own size, with no terminator after them to lean on
+    const char* truncated[] = { "[", "[1,", "[1, ", "[-" };
+    for (size_t i = 0; !failed && i < sizeof(truncated) / sizeof(truncated[0]); i++) {
+        const size_t size = strlen(truncated[i]);
+        char* exact = malloc(size);
+        memcpy(exact, truncated[i], size);
+        json = calloc(1, sizeof(jvalue));
+        if (json_parse_n(exact, size, json, &opts, NULL) != JSON_FAILURE) {
+            if (verbose) {
+                printf("%s parsed\n", truncated[i]);
+            }
+            failed = 6;
+        }
+        json_free_value(json);
+        free(exact);
+    }
+    return failed;
+}
+
+int packed_push_test(const int verbose) {
+    // pushed a few bytes at a time, arrays are packed as they close, into the same tree the one-shot parse builds
+    const char* text = "{\"ints\": [1, -2, 9223372036854775807, 0], \"mixed\": [1, 2.5, -0], \"late\": [1, \"two\"],"
+                       " \"nested\": [[1, 2], [3.5], []], \"big\": [12345678901234567890], \"obj\": {\"xs\": [4, 5]}}";
+    int failed = 0;
+    for (int arena = 0; !failed && arena < 2; arena++) {
+        jarena* a = arena ? json_arena_create(0) : NULL;
+        const jparse_options opts = { .flags = JSON_PARSE_PACK_NUMBERS, .arena = a };
+        jvalue* pushed = arena ? json_arena_alloc(a, sizeof(jvalue)) : calloc(1, sizeof(jvalue));
+        jparser* p = jparser_create(pushed, &opts);
+        const size_t length = strlen(text);
+        for (size_t i = 0; !failed && i < length; i += 3) {
+            failed = jparser_feed(p, text + i, length - i < 3 ? length - i : 3);
+        }
+        failed = failed || jparser_finish(p);
+        jparser_destroy(p);
+        jvalue* parsed = parse(text, JSON_PARSE_PACK_NUMBERS);
+        const char* keys[] = { "ints", "mixed", "late", "nested", "big" };
+        for (int k = 0; !failed && k < 5; k++) {
+            const jvalue* x = json_search_by_key(keys[k], pushed);
+            const jvalue* y = json_search_by_key(keys[k], parsed);
+            if (((x->flags ^ y->flags) & ~JSON_FLAG_ARENA) || x->length != y->length
+                || ((x->flags & JSON_FLAG_PACKED) && memcmp(x->integers, y->integers, x->length * 8) != 0)) {
+                if (verbose) {
+                    printf("%s came out different (flags %x and %x)\n", keys[k], x->flags, y->flags);
+                }
+                failed = 1;
+            }
+        }
+        const int64_t* xs = json_array_integers(json_search_by_key("xs", json_search_by_key("obj", pushed)));
+        const jvalue* nested = json_search_by_key("nested", pushed);
+        char* x = json_write_to_str(pushed, JSON_WRITE_PRETTY, NULL);
+        char* y = json_write_to_str(parsed, JSON_WRITE_PRETTY, NULL);
+        if (!failed && (xs == NULL || xs[1] != 5 || json_array_integers(&nested->elements[0])[1] != 2
+                        || json_array_doubles(&nested->elements[1])[0] != 3.5 || strcmp(x, y) != 0)) {
+            failed = 2;
+        }
+        free(x);
+        free(y);
+        json_free_value(parsed);
+        if (arena) {
+            json_arena_destroy(a);
+        } else {
+            json_free_value(pushed);
+        }
+    }
+    return failed;
+}
+
+int packed_precision_test(const int verbose) {
+    // integers past 2^53 next to doubles would lose digits in a block of doubles, those arrays aren't packed at all,
+    // one-shot or pushed, and write back exactly like they do without the flag
+    const char* texts[] = { "[9007199254740993, 1.5]", "[1.5, 9007199254740993]", "[-9223372036854775807, 0.25, 3]",
+                            "[2.5, 12, 9223372036854775807]" };
+    int failed = 0;
+    for (int t = 0; !failed && t < 4; t++) {
+        jvalue* plain = parse(texts[t], 0);
+        jvalue* parsed = parse(texts[t], JSON_PARSE_PACK_NUMBERS);
+        jvalue* pushed = calloc(1, sizeof(jvalue));
+        const jparse_options opts = { .flags = JSON_PARSE_PACK_NUMBERS };
+        jparser* p = jparser_create(pushed, &opts);
+        const size_t length = strlen(texts[t]);
+        int pushing = 0;
+        for (size_t i = 0; !pushing && i < length; i += 3) {
+            pushing = jparser_feed(p, texts[t] + i, length - i < 3 ? length - i : 3);
+        }
+        pushing = pushing || jparser_finish(p);
+        jparser_destroy(p);
+        char* expected = json_write_to_str(plain, JSON_WRITE_COMPACT, NULL);
+        char* x = json_write_to_str(parsed, JSON_WRITE_COMPACT, NULL);
+        char* y = pushing ? NULL : json_write_to_str(pushed, JSON_WRITE_COMPACT, NULL);
+        if (x == NULL || y == NULL || (parsed->flags & JSON_FLAG_PACKED) || (pushed->flags & JSON_FLAG_PACKED)
+            || strcmp(x, expected) != 0 || strcmp(y, expected) != 0) {
+            if (verbose) {
+                printf("%s came back as %s and %s\n", texts[t], x ? x : "(null)", y ? y : "(null)");
+            }
+            failed = t + 1;
+        }
+        free(expected);
+        free(x);
+        free(y);
+        json_free_value(plain);
+        json_free_value(parsed);
+        json_free_value(pushed);
+    }
+    // big integers that a double does hold exactly (2^53, -2^63) still pack next to doubles
+    jvalue* exact = parse("[9007199254740992, 0.5, -9223372036854775808]", JSON_PARSE_PACK_NUMBERS);
+    if (!failed && (exact == NULL || !(exact->flags & JSON_FLAG_PACKED) || json_array_doubles(exact)[0] != 9007199254740992.0)) {
+        failed = 5;
+    }
+    json_free_value(exact);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Packed numeric arrays\n");
+    run_test(packed_kinds_test, "packed_kinds", verbose);
+    run_test(packed_access_test, "packed_access", verbose);
+    run_test(packed_malformed_test, "packed_malformed", verbose);
+    run_test(packed_push_test, "packed_push", verbose);
+    run_test(packed_precision_test, "packed_precision", verbose);
+    return 0;
+}
@@ -0,0 +1,255 @@
+//
+// JSON Pointer tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// the example document from RFC 6901
+const char* rfc_document = "{ \"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4, \"i\\\\j\": 5,"
+                           " \"k\\\"l\": 6, \" \": 7, \"m~n\": 8 }";
+
+jvalue* parse(const char* text, unsigned int flags) {
+    char* cursor = (char*)text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = flags };
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS) {
+        json_free_value(json);
+        return NULL;
+    }
+    return json;
+}
+
+int pointer_rfc_test(const int verbose) {
+    jvalue* json = parse(rfc_document, 0);
+    const char* pointers[] = { "/foo", "/foo/0", "/", "/a~1b", "/c%d", "/e^f", "/g|h", "/i\\j", "/k\"l", "/ ", "/m~0n" };
+    const double numbers[] = { -1, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+    int failed = json == NULL;
+    for (size_t i = 0; !failed && i < sizeof(pointers) / sizeof(pointers[0]); i++) {
+        jpointer* ptr = json_pointer_compile(pointers[i]);
+        jvalue* found = json_pointer_get(ptr, json);
+        if (found == NULL || (numbers[i] >= 0 && (found->type != JSON_NUMBER || found->number != numbers[i]))) {
+            if (verbose) {
+                printf("Pointer %s found nothing (or the wrong thing)\n", pointers[i]);
+            }
+            failed = 1;
+        }
+        json_pointer_free(ptr);
+    }
+    // the whole document, the array and its element
+    jpointer* whole = json_pointer_compile("");
+    jpointer* foo = json_pointer_compile("/foo");
+    jpointer* bar = json_pointer_compile("/foo/0");
+    if (!failed && (json_pointer_get(whole, json) != json || json_pointer_get(foo, json)->type != JSON_ARRAY
+                    || strcmp(json_pointer_get(bar, json)->string, "bar") != 0)) {
+        failed = 2;
+    }
+    json_pointer_free(whole);
+    json_pointer_free(foo);
+    json_pointer_free(bar);
+    // things that aren't there
+    const char* missing[] = { "/nope", "/foo/2", "/foo/-", "/foo/01", "/foo/bar", "/foo/0/x", "/a~1b/c", "/foo/99999999999999999999999" };
+    for (size_t i = 0; !failed && i < sizeof(missing) / sizeof(missing[0]); i++) {
+        jpointer* ptr = json_pointer_compile(missing[i]);
+        if (ptr == NULL || json_pointer_get(ptr, json) != NULL) {
+            if (verbose) {
+                printf("Pointer %s found something\n", missing[i]);
+            }
+            failed = 3;
+        }
+        json_pointer_free(ptr);
+    }
+    // and ones that aren't pointers at all
+    const char* malformed[] = { "foo", "/a~", "/a~2", "~0" };
+    for (size_t i = 0; !failed && i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        jpointer* ptr = json_pointer_compile(malformed[i]);
+        if (ptr != NULL) {
+            if (verbose) {
+                printf("Pointer %s compiled\n", malformed[i]);
+            }
+            json_pointer_free(ptr);
+            failed = 4;
+        }
+    }
+    json_free_value(json);
+    return failed;
+}
+
+int pointer_paths_test(const int verbose) {
+    // wide enough to get an index with JSON_PARSE_INDEX, with a duplicate key (the first one wins), and a lazy variant
+    char text[2048];
+    char* pos = text + sprintf(text, "{ \"items\" : [ {\"id\": 0}, {\"id\": 1, \"meta\": {\"id\": \"x\"}}, [5, 6] ], \"dup\": 1, \"dup\": 2");
+    for (int i = 0; i < 40; i++) {
+        pos += sprintf(pos, ", \"k%d\": %d", i, i);
+    }
+    sprintf(pos, " }");
+    const char* pointers[] = { "/items/1/meta/id", "/items/0/id", "/k7", "/dup", "/items/2/1", "/missing", "/items/9", "/items/1/id", "/k39", "/k7", "/items" };
+    const size_t count = sizeof(pointers) / sizeof(pointers[0]);
+    jpaths* paths = json_paths_compile(pointers, count);
+    if (paths == NULL) {
+        if (verbose) {
+            printf("JSON_PATHS_COMPILE failed\n");
+        }
+        return 1;
+    }
+    const unsigned int modes[] = { 0, JSON_PARSE_INDEX, JSON_PARSE_LAZY };
+    int failed = 0;
+    for (size_t mode = 0; !failed && mode < 3; mode++) {
+        jvalue* json = parse(text, modes[mode]);
+        jvalue* out[sizeof(pointers) / sizeof(pointers[0])];
+        const size_t found = json_paths_get(paths, json, out);
+        // every path has to agree with looking it up on its own
+        for (size_t i = 0; i < count; i++) {
+            jpointer* ptr = json_pointer_compile(pointers[i]);
+            if (out[i] != json_pointer_get(ptr, json)) {
+                if (verbose) {
+                    printf("Mode %zu: path %s disagrees with the single lookup\n", mode, pointers[i]);
+                }
+                failed = 1;
+            }
+            json_pointer_free(ptr);
+        }
+        if (!failed && (found != 9 || strcmp(out[0]->string, "x") != 0 || out[1]->number != 0 || out[2]->number != 7
+                        || out[3]->number != 1 || out[4]->number != 6 || out[5] != NULL || out[6] != NULL || out[9] != out[2])) {
+            if (verbose) {
+                printf("Mode %zu: %zu found\n", mode, found);
+            }
+            failed = 2;
+        }
+        json_free_value(json);
+    }
+    json_paths_free(paths);
+    const char* bad[] = { "/ok", "not a pointer" };
+    if (json_paths_compile(bad, 2) != NULL) {
+        failed = 3;
+    }
+    return failed;
+}
+
+// push parse text a few bytes at a time, so keys and values get cut off between chunks
+int push_parse(const char* text, jvalue* json, const jparse_options* opts) {
+    jparser* p = jparser_create(json, opts);
+    const size_t length = strlen(text);
+    int result = p == NULL;
+    for (size_t i = 0; !result && i < length; i += 5) {
+        result = jparser_feed(p, text + i, length - i < 5 ? length - i : 5);
+    }
+    result = result || jparser_finish(p);
+    jparser_destroy(p);
+    return result;
+}
+
+int pointer_projection_test(const int verbose) {
+    const char* text = "{\"id\": 7, \"skip\": {\"deep\": [1, {\"x\": \"}]\\\"\"}]}, \"name\": \"a\\\"b\", \"tags\": [\"t\"],"
+                       " \"user\": {\"id\": 3, \"email\": \"e\", \"junk\": [[[]]]}, \"items\": [{\"price\": 1, \"n\": 2}, {\"n\": 3}, 4],"
+                       " \"na\\u006De2\": true, \"user\": 5, \"flat\": 1}";
+    const char* fields[] = { "/id", "/user/id", "/tags", "/items/0/price", "/items/1/n/x", "/items/2/deep", "/items/price",
+                             "/name2", "/flat/below", "/missing" };
+    const size_t count = sizeof(fields) / sizeof(fields[0]);
+    jpaths* projection = json_paths_compile(fields, count);
+    // kept in document order, keys are compared decoded, array elements are picked by index like json_paths_get
+    // picks them (so a key can't pick any), and scalars where a container was wanted are dropped, members and
+    // elements alike
+    const char* expected = "{\"id\":7,\"tags\":[\"t\"],\"user\":{\"id\":3},\"items\":[{\"price\":1},{}],\"name2\":true}";
+    // whatever the paths find in the whole document, they find the same in the projected one
+    jvalue* whole_doc = calloc(1, sizeof(jvalue));
+    char* whole_cursor = (char*)text;
+    json_parse_value(&whole_cursor, whole_doc);
+    jvalue* in_whole[10];
+    const size_t found_in_whole = json_paths_get(projection, whole_doc, in_whole);
+    int failed = 0;
+    // in one go and pushed in pieces, each with and without an arena
+    for (int mode = 0; !failed && mode < 4; mode++) {
+        const int arena = mode % 2;
+        jarena* a = arena ? json_arena_create(0) : NULL;
+        const jparse_options opts = { .flags = JSON_PARSE_LAZY | JSON_PARSE_INDEX, .arena = a, .projection = projection };
+        jvalue* json = arena ? json_arena_alloc(a, sizeof(jvalue)) : calloc(1, sizeof(jvalue));
+        char* cursor = (char*)text;
+        if ((mode < 2 ? json_parse_value_opts(&cursor, json, &opts) : push_parse(text, json, &opts)) != JSON_SUCCESS) {
+            failed = 1;
+        } else {
+            char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+            if (out == NULL || strcmp(out, expected) != 0) {
+                if (verbose) {
+                    printf("Mode %d projected to %s\n", mode, out ? out : "(failure)");
+                }
+                failed = 2;
+            }
+            free(out);
+            jvalue* in_projected[10];
+            size_t found = json_paths_get(projection, json, in_projected);
+            for (size_t i = 0; !failed && i < count; i++) {
+                char* a = in_whole[i] != NULL ? json_write_to_str(in_whole[i], JSON_WRITE_COMPACT, NULL) : NULL;
+                char* b = in_projected[i] != NULL ? json_write_to_str(in_projected[i], JSON_WRITE_COMPACT, NULL) : NULL;
+                if ((a == NULL) != (b == NULL) || (a != NULL && strcmp(a, b) != 0)) {
+                    if (verbose) {
+                        printf("Mode %d: %s found %s, not %s\n", mode, fields[i], b ? b : "nothing", a ? a : "nothing");
+                    }
+                    failed = 5;
+                }
+                free(a);
+                free(b);
+            }
+            if (!failed && (found != found_in_whole || found != 5)) {
+                failed = 5;
+            }
+        }
+        if (arena) {
+            json_arena_destroy(a);
+        } else {
+            json_free_value(json);
+        }
+    }
+    // skipped values still have to be there and bracketed properly
+    const char* broken[] = { "{\"skip\": [1, 2}", "{\"skip\": \"open}", "{\"skip\": }", "{\"skip\": tru, \"id\": 1}", "{\"id\": 1, \"skip\" 2}" };
+    const jparse_options opts = { .projection = projection };
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        jvalue* json = calloc(1, sizeof(jvalue));
+        char* cursor = (char*)broken[i];
+        jvalue* pushed = calloc(1, sizeof(jvalue));
+        if (json_parse_value_opts(&cursor, json, &opts) != JSON_FAILURE || push_parse(broken[i], pushed, &opts) != JSON_FAILURE) {
+            if (verbose) {
+                printf("\"%s\" was accepted\n", broken[i]);
+            }
+            failed = 3;
+        }
+        json_free_value(json);
+        json_free_value(pushed);
+    }
+    json_free_value(whole_doc);
+    json_paths_free(projection);
+    // "" keeps everything
+    const char* all[] = { "", "/id" };
+    projection = json_paths_compile(all, 2);
+    const jparse_options whole = { .projection = projection };
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* cursor = (char*)text;
+    jvalue* pushed = calloc(1, sizeof(jvalue));
+    if (json_parse_value_opts(&cursor, json, &whole) != JSON_SUCCESS || json_search_by_key("skip", json) == NULL
+        || push_parse(text, pushed, &whole) != JSON_SUCCESS || json_search_by_key("skip", pushed) == NULL) {
+        failed = 4;
+    }
+    json_free_value(json);
+    json_free_value(pushed);
+    json_paths_free(projection);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("JSON Pointer\n");
+    run_test(pointer_rfc_test, "pointer_rfc", verbose);
+    run_test(pointer_paths_test, "pointer_paths", verbose);
+    run_test(pointer_projection_test, "pointer_projection", verbose);
+    return 0;
+}
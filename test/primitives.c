@@ -321,6 +321,87 @@ int numbers_zeros_test(const int verbose) {
     return 0;
 }
 
+int numbers_int64_test(const int verbose) {
+    // integers past 2^53 have to survive exactly
+    char* ins[] = {"9007199254740993", "-9223372036854775808", "9223372036854775807"};
+    for (int i = 0; i < 3; i++) {
+        char* in = ins[i];
+        jvalue* json = calloc(1, sizeof(jvalue));
+        if (json_parse_value(&in, json) != JSON_SUCCESS) {
+            json_free_value(json);
+            if (verbose) {
+                printf("JSON_PARSE_VALUE failed (%s)\n", in);
+            }
+            return 1;
+        }
+        if (json->type != JSON_NUMBER || !(json->flags & JSON_FLAG_INTEGER)) {
+            if (verbose) {
+                printf("Parsed value isn't an exact integer\n");
+            }
+            json_free_value(json);
+            return 1;
+        }
+        char* out = json_jval_to_str(json);
+        if (strcmp(out, ins[i]) != 0) {
+            if (verbose) {
+                printf("Output comparison failed (%s)\n", out);
+            }
+            json_free_value(json);
+            free(out);
+            return 1;
+        }
+        json_free_value(json);
+        free(out);
+    }
+    return 0;
+}
+
+int numbers_roundtrip_test(const int verbose) {
+    // shortest output that reads back as the same double
+    char* ins[] = {"0.1", "1.7976931348623157e308", "5e-324", "2.5e-8", "123456.789", "1e100", "-0.0"};
+    for (int i = 0; i < 7; i++) {
+        char* in = ins[i];
+        jvalue* json = calloc(1, sizeof(jvalue));
+        if (json_parse_value(&in, json) != JSON_SUCCESS) {
+            json_free_value(json);
+            if (verbose) {
+                printf("JSON_PARSE_VALUE failed (%s)\n", in);
+            }
+            return 1;
+        }
+        char* out = json_jval_to_str(json);
+        if (strcmp(out, ins[i]) != 0 || strtod(out, NULL) != json->number) {
+            if (verbose) {
+                printf("Output comparison failed (%s)\n", out);
+            }
+            json_free_value(json);
+            free(out);
+            return 1;
+        }
+        json_free_value(json);
+        free(out);
+    }
+    return 0;
+}
+
+int numbers_invalid_test(const int verbose) {
+    // things strtod would take but JSON doesn't
+    char* ins[] = {"01", "1.", ".5", "-", "+1", "1e", "0x10", "inf", "1.5e+"};
+    for (int i = 0; i < 9; i++) {
+        char* in = ins[i];
+        jvalue* json = calloc(1, sizeof(jvalue));
+        if (json_parse_value(&in, json) == JSON_SUCCESS) {
+            if (verbose) {
+                printf("JSON_PARSE_VALUE accepted %s\n", ins[i]);
+            }
+            json_free_value(json);
+            return 1;
+        }
+        json_free_value(json);
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     const int verbose = 1;
     printf("Primitives\n");
@@ -332,5 +413,8 @@ int main(int argc, char **argv) {
     run_test(numbers_fp_test, "numbers_fp", verbose);
     run_test(numbers_exp_test, "numbers_exp", verbose);
     run_test(numbers_zeros_test, "numbers_zeros", verbose);
+    run_test(numbers_int64_test, "numbers_int64", verbose);
+    run_test(numbers_roundtrip_test, "numbers_roundtrip", verbose);
+    run_test(numbers_invalid_test, "numbers_invalid", verbose);
     return 0;
 }
@@ -0,0 +1,119 @@
+//
+// Push parser tests (any chunking of the input has to give the same tree as parsing it in one go)
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// push in to a parser in chunks of at most chunk bytes, with the first chunk cut at split
+// returns the compact serialization of the result (NULL if parsing failed)
+char* push_in_chunks(const char* in, const size_t split, const size_t chunk, jarena* arena) {
+    const size_t length = strlen(in);
+    jvalue* json = arena ? json_arena_alloc(arena, sizeof(jvalue)) : calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INDEX | JSON_PARSE_VALIDATE_UTF8, .arena = arena };
+    jparser* p = jparser_create(json, &opts);
+    int result = jparser_feed(p, in, split);
+    for (size_t at = split; at < length && result == JSON_SUCCESS; at += chunk) {
+        result = jparser_feed(p, in + at, at + chunk < length ? chunk : length - at);
+    }
+    if (result == JSON_SUCCESS) {
+        result = jparser_finish(p);
+    }
+    jparser_destroy(p);
+    char* out = result == JSON_SUCCESS ? json_write_to_str(json, JSON_WRITE_COMPACT, NULL) : NULL;
+    if (arena == NULL) {
+        json_free_value(json);
+    }
+    return out;
+}
+
+char* parse_whole(const char* in) {
+    char* cursor = (char*)in;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* out = json_parse_value(&cursor, json) == JSON_SUCCESS ? json_write_to_str(json, JSON_WRITE_COMPACT, NULL) : NULL;
+    json_free_value(json);
+    return out;
+}
+
+int push_splits_test(const int verbose) {
+    const char* inputs[] = {
+        "{ \"name\" : \"tablet\", \"tags\" : [\"a\", \"b\\\"c\", [], {}], \"nested\" : { \"x\" : -1.5e3, \"y\" : [true, false, null] } }",
+        "[1, 22, 333, 4444.5, -0, 1e-7, 12345678901234567890, \"\", \"\\\\\"]",
+        "{\"k\\u00e9y\" : \"\\ud83d\\ude00 \\\"\\n\\u20ac\"}",
+        "[\"h\xc3\xa9llo \xf0\x9f\x98\x80\", \"\xe2\x82\xac\"]",
+        "{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,\"g\":7,\"h\":8,\"i\":9,\"j\":10,\"k\":11,\"l\":12,\"m\":13,\"n\":14,\"o\":15,\"p\":16,\"q\":17}",
+        "  \"just a string\"  ",
+        "-12.75",
+        "[[[[[[[[[[]]]]]]]]]]",
+    };
+    jarena* arena = json_arena_create(128);
+    for (size_t n = 0; n < sizeof(inputs) / sizeof(inputs[0]); n++) {
+        char* expected = parse_whole(inputs[n]);
+        if (expected == NULL) {
+            if (verbose) {
+                printf("One-shot parse failed for %s\n", inputs[n]);
+            }
+            json_arena_destroy(arena);
+            return 1;
+        }
+        // every split point, then the rest in one piece or a byte at a time, on the heap and in an arena
+        for (size_t split = 0; split <= strlen(inputs[n]); split++) {
+            for (int mode = 0; mode < 4; mode++) {
+                char* out = push_in_chunks(inputs[n], split, mode % 2 ? 1 : strlen(inputs[n]), mode / 2 ? arena : NULL);
+                int same = out != NULL && strcmp(out, expected) == 0;
+                if (!same && verbose) {
+                    printf("Split at %zu (mode %d) gave %s for %s\n", split, mode, out ? out : "(failure)", inputs[n]);
+                }
+                free(out);
+                json_arena_reset(arena);
+                if (!same) {
+                    free(expected);
+                    json_arena_destroy(arena);
+                    return 1;
+                }
+            }
+        }
+        free(expected);
+    }
+    json_arena_destroy(arena);
+    return 0;
+}
+
+int push_invalid_test(const int verbose) {
+    const char* inputs[] = {
+        "", "   ", "{", "[1,", "[1,]", "{\"a\"}", "{\"a\":}", "{,}", "[1 2]", "{\"a\":1]", "[}", "tru", "nul1",
+        "\"abc", "[\"abc\\\"]", "01", "1.", "-", "[1] [2]", "{\"a\":1}x", "{1:2}", ",", "1,2", ":",
+        "[\"\xc3\"]", "{\"\xff\":1}", "\"\xed\xa0\x80\"",
+    };
+    for (size_t n = 0; n < sizeof(inputs) / sizeof(inputs[0]); n++) {
+        for (size_t split = 0; split <= strlen(inputs[n]); split++) {
+            char* out = push_in_chunks(inputs[n], split, 1, NULL);
+            if (out != NULL) {
+                if (verbose) {
+                    printf("Invalid input %s was accepted as %s\n", inputs[n], out);
+                }
+                free(out);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Push parser\n");
+    run_test(push_splits_test, "push_splits", verbose);
+    run_test(push_invalid_test, "push_invalid", verbose);
+    return 0;
+}
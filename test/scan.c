@@ -0,0 +1,212 @@
+//
+// Scanner tests (every SIMD level has to parse exactly like the scalar one)
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// parse in at the given simd level and return the compact serialization (NULL if parsing failed)
+char* parse_at_level(const char* in, const int level) {
+    json_set_simd_level(level);
+    char* cursor = (char*)in;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    char* out = NULL;
+    if (json_parse_value(&cursor, json) == JSON_SUCCESS) {
+        out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    }
+    json_free_value(json);
+    return out;
+}
+
+// parse in at every level and check all of them give expected (NULL meaning the parse should fail)
+int same_at_every_level(const char* in, const char* expected, const int verbose) {
+    for (int level = JSON_SIMD_SCALAR; level <= JSON_SIMD_AVX2; level++) {
+        char* out = parse_at_level(in, level);
+        int same = (out == NULL && expected == NULL) || (out != NULL && expected != NULL && strcmp(out, expected) == 0);
+        if (!same) {
+            if (verbose) {
+                printf("Level %d gave %s for %s\n", level, out ? out : "(failure)", in);
+            }
+            free(out);
+            json_set_simd_level(JSON_SIMD_AVX2);
+            return 1;
+        }
+        free(out);
+    }
+    json_set_simd_level(JSON_SIMD_AVX2);
+    return 0;
+}
+
+int scan_whitespace_test(const int verbose) {
+    // whitespace runs of every length up to a few vectors, starting at every alignment
+    char in[256];
+    char expected[] = "[1,{\"a\":null}]";
+    for (int shift = 0; shift < 32; shift++) {
+        for (int run = 0; run < 80; run += 7) {
+            char* pos = in + shift % 2; // odd starts put the cursor off alignment
+            for (int i = 0; i < run; i++) {
+                *pos++ = " \t\r\n"[i % 4];
+            }
+            sprintf(pos, "[1,%*s{\"a\"%*s:null}\n]%*s", shift, "", run % 5, "", run, "");
+            if (same_at_every_level(in + shift % 2, expected, verbose)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int scan_string_test(const int verbose) {
+    // strings long enough to span several vectors, with quotes escaped right around the vector edges
+    char in[512];
+    char expected[512];
+    for (int length = 0; length < 100; length++) {
+        char body[256];
+        for (int i = 0; i < length; i++) {
+            body[i] = 'a' + i % 26;
+        }
+        body[length] = '\0';
+        if (length >= 3) {
+            body[length / 2] = '\\';
+            body[length / 2 + 1] = '"';
+        }
+        sprintf(in, "  \"%s\"  ", body);
+        sprintf(expected, "\"%s\"", body);
+        if (same_at_every_level(in, expected, verbose)) {
+            return 1;
+        }
+    }
+    // unterminated strings fail (rather than running off the end of the input)
+    if (same_at_every_level("\"abc", NULL, verbose) || same_at_every_level("[\"abc\\", NULL, verbose)) {
+        return 1;
+    }
+    return 0;
+}
+
+int scan_escape_test(const int verbose) {
+    // escapes (and raw utf-8, which must not look like something to escape) around the vector edges, decoded and written back
+    char in[512];
+    char expected[512];
+    for (int length = 0; length < 100; length++) {
+        char* i = in + sprintf(in, "\"");
+        char* e = expected + sprintf(expected, "\"");
+        for (int n = 0; n < length; n++) {
+            if (n == length / 3) {
+                i += sprintf(i, "\\n\xc3\xa9");
+                e += sprintf(e, "\\n\xc3\xa9");
+            } else if (n == 2 * length / 3) {
+                i += sprintf(i, "\\u00e9\\t");
+                e += sprintf(e, "\xc3\xa9\\t");
+            } else {
+                *i++ = 'a' + n % 26;
+                *e++ = 'a' + n % 26;
+            }
+        }
+        sprintf(i, "\"");
+        sprintf(e, "\"");
+        if (same_at_every_level(in, expected, verbose)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct utf8_case {
+    const char* bytes;
+    int bad_at; // offset of the first bad byte, -1 if it's valid
+} utf8_case;
+
+int scan_utf8_test(const int verbose) {
+    const utf8_case cases[] = {
+        {"\xc3\xa9", -1}, {"\xe2\x82\xac", -1}, {"\xf0\x9f\x98\x80", -1}, {"\xf4\x8f\xbf\xbf", -1}, {"\xef\xbf\xbf", -1},
+        {"\xed\x9f\xbf", -1}, {"\xee\x80\x80", -1}, {"\xc2\x80", -1},
+        {"\x80", 0}, {"\xc0\x80", 0}, {"\xc1\xbf", 0}, {"\xe0\x80\x80", 0}, {"\xed\xa0\x80", 0}, {"\xf4\x90\x80\x80", 0},
+        {"\xf5\x80\x80\x80", 0}, {"\xff", 0}, {"\xc3" "a", 0}, {"\xe2\x82" "a", 0}, {"\xf0\x9f\x98", 0}, {"\xc3\xa9\xa9", 2},
+        {"\xf0\x80\x80\x80", 0}, {"a\xe2\x82\xac\x80", 4},
+    };
+    // every case at every offset from a vector edge, after plain ascii or after other multibyte characters
+    char in[256];
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        for (int prefix = 0; prefix < 70; prefix++) {
+            for (int mixed = 0; mixed < 2; mixed++) {
+                char* i = in;
+                *i++ = '"';
+                for (int n = 0; n < prefix; n++) {
+                    if (mixed && n + 2 <= prefix && n % 5 == 0) {
+                        i += sprintf(i, "\xc3\xa9");
+                        n++;
+                    } else {
+                        *i++ = 'a' + n % 26;
+                    }
+                }
+                i += sprintf(i, "%s tail\"", cases[c].bytes);
+                const size_t expected_offset = 1 + prefix + cases[c].bad_at;
+                for (int level = JSON_SIMD_SCALAR; level <= JSON_SIMD_AVX2; level++) {
+                    json_set_simd_level(level);
+                    jparse_error error;
+                    const jparse_options opts = { .flags = JSON_PARSE_VALIDATE_UTF8, .error = &error };
+                    char* cursor = in;
+                    jvalue* json = calloc(1, sizeof(jvalue));
+                    int result = json_parse_value_opts(&cursor, json, &opts);
+                    json_free_value(json);
+                    int right = cases[c].bad_at < 0 ? result == JSON_SUCCESS && error.code == JSON_ERROR_NONE
+                                                    : result == JSON_FAILURE && error.code == JSON_ERROR_UTF8 && error.offset == expected_offset;
+                    if (!right) {
+                        if (verbose) {
+                            printf("Level %d, case %zu after %d bytes (mixed %d): result %d, error %d at %zu\n",
+                                   level, c, prefix, mixed, result, error.code, error.offset);
+                        }
+                        json_set_simd_level(JSON_SIMD_AVX2);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    json_set_simd_level(JSON_SIMD_AVX2);
+    // keys are checked too, and without the flag nothing is
+    char key[] = "{\"k\xff\" : 1}";
+    char* cursor = key;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    jparse_error error;
+    const jparse_options opts = { .flags = JSON_PARSE_VALIDATE_UTF8, .error = &error };
+    int failed = json_parse_value_opts(&cursor, json, &opts) != JSON_FAILURE || error.code != JSON_ERROR_UTF8 || error.offset != 3;
+    json_free_value(json);
+    cursor = key;
+    json = calloc(1, sizeof(jvalue));
+    if (json_parse_value(&cursor, json) != JSON_SUCCESS) {
+        failed = 2;
+    }
+    json_free_value(json);
+    // syntax errors say where they are too
+    cursor = "[1, 2, x]";
+    json = calloc(1, sizeof(jvalue));
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_FAILURE || error.code != JSON_ERROR_SYNTAX || error.offset != 7) {
+        failed = 3;
+    }
+    json_free_value(json);
+    if (failed && verbose) {
+        printf("UTF-8 check %d failed\n", failed);
+    }
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Scanner\n");
+    run_test(scan_whitespace_test, "scan_whitespace", verbose);
+    run_test(scan_string_test, "scan_string", verbose);
+    run_test(scan_escape_test, "scan_escape", verbose);
+    run_test(scan_utf8_test, "scan_utf8", verbose);
+    return 0;
+}
@@ -0,0 +1,170 @@
+//
+// Tape tests
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+const char* document = "{ \"id\" : 7, \"tags\" : [\"a\", \"b\\\"\", [], {}], \"pos\" : { \"x\" : 1.5, \"y\" : [true, false, null] }, \"neg\" : -0, \"last\" : null }";
+
+int tape_access_test(const int verbose) {
+    jtape* tape = json_tape_parse(document);
+    if (tape == NULL) {
+        if (verbose) {
+            printf("JSON_TAPE_PARSE failed\n");
+        }
+        return 1;
+    }
+    int failed = 0;
+    const size_t root = JSON_TAPE_ROOT;
+    size_t tags = json_tape_find(tape, root, "tags");
+    size_t pos = json_tape_find(tape, root, "pos");
+    size_t y = json_tape_find(tape, pos, "y");
+    int64_t id = 0;
+    if (json_tape_type(tape, root) != JSON_OBJECT || json_tape_length(tape, root) != 5
+        || json_tape_integer(tape, json_tape_find(tape, root, "id"), &id) != JSON_SUCCESS || id != 7) {
+        failed = 1;
+    }
+    if (json_tape_type(tape, tags) != JSON_ARRAY || json_tape_length(tape, tags) != 4
+        || strcmp(json_tape_string(tape, json_tape_index(tape, tags, 1), NULL), "b\"") != 0
+        || json_tape_length(tape, json_tape_index(tape, tags, 2)) != 0 || json_tape_type(tape, json_tape_index(tape, tags, 3)) != JSON_OBJECT
+        || json_tape_index(tape, tags, 4) != JSON_TAPE_NONE) {
+        failed = 2;
+    }
+    if (json_tape_number(tape, json_tape_find(tape, pos, "x")) != 1.5 || json_tape_integer(tape, json_tape_find(tape, pos, "x"), NULL) != JSON_FAILURE
+        || !json_tape_boolean(tape, json_tape_index(tape, y, 0)) || json_tape_boolean(tape, json_tape_index(tape, y, 1))
+        || json_tape_type(tape, json_tape_index(tape, y, 2)) != JSON_NULL) {
+        failed = 3;
+    }
+    if (json_tape_find(tape, root, "missing") != JSON_TAPE_NONE || json_tape_find(tape, tags, "a") != JSON_TAPE_NONE) {
+        failed = 4;
+    }
+    // skipping the root lands at the end of the tape (just past its close), and iterating the root visits each key and value
+    size_t count = 0;
+    for (size_t node = json_tape_child(tape, root); node != JSON_TAPE_NONE; node = json_tape_sibling(tape, node)) {
+        count++;
+    }
+    if (count != 10 || json_tape_skip(tape, root) != json_tape_skip(tape, json_tape_find(tape, root, "last")) + 1
+        || json_tape_type(tape, json_tape_skip(tape, root)) != -1) {
+        failed = 5;
+    }
+    if (failed && verbose) {
+        printf("Tape access check %d failed\n", failed);
+    }
+    json_tape_free(tape);
+    return failed;
+}
+
+int tape_convert_test(const int verbose) {
+    // text -> tape -> tree has to match text -> tree, and tree -> tape -> tree has to give the tree back
+    char* cursor = (char*)document;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    json_parse_value(&cursor, json);
+    char* expected = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+
+    jtape* parsed = json_tape_parse(document);
+    jtape* flattened = json_tape_from_value(json);
+    jvalue* from_parsed = calloc(1, sizeof(jvalue));
+    jvalue* from_flattened = calloc(1, sizeof(jvalue));
+    int failed = parsed == NULL || flattened == NULL
+                 || json_tape_to_value(parsed, JSON_TAPE_ROOT, from_parsed, NULL) != JSON_SUCCESS
+                 || json_tape_to_value(flattened, JSON_TAPE_ROOT, from_flattened, NULL) != JSON_SUCCESS;
+    if (!failed) {
+        char* a = json_write_to_str(from_parsed, JSON_WRITE_COMPACT, NULL);
+        char* b = json_write_to_str(from_flattened, JSON_WRITE_COMPACT, NULL);
+        failed = strcmp(a, expected) != 0 || strcmp(b, expected) != 0;
+        if (failed && verbose) {
+            printf("Expected %s, got %s and %s\n", expected, a, b);
+        }
+        free(a);
+        free(b);
+    }
+    // a subtree converts on its own, into an arena if asked
+    jarena* arena = json_arena_create(0);
+    jvalue* pos = json_arena_alloc(arena, sizeof(jvalue));
+    const jparse_options opts = { .arena = arena };
+    if (!failed && (json_tape_to_value(parsed, json_tape_find(parsed, JSON_TAPE_ROOT, "pos"), pos, &opts) != JSON_SUCCESS
+                    || pos->type != JSON_OBJECT || json_search_by_key("y", pos) == NULL)) {
+        if (verbose) {
+            printf("Subtree conversion failed\n");
+        }
+        failed = 1;
+    }
+    json_arena_destroy(arena);
+    json_free_value(from_parsed);
+    json_free_value(from_flattened);
+    json_tape_free(parsed);
+    json_tape_free(flattened);
+    json_free_value(json);
+    free(expected);
+    // and broken input doesn't give a tape at all
+    jtape* broken = json_tape_parse("[1, 2");
+    if (broken != NULL) {
+        json_tape_free(broken);
+        return 1;
+    }
+    return failed;
+}
+
+int tape_deep_test(const int verbose) {
+    // far deeper than any C stack could recurse, tree -> tape -> tree without recursing
+    const size_t depth = 1000000;
+    char* text = malloc(depth * 6 + 2);
+    char* pos = text;
+    for (size_t i = 0; i < depth; i++) {
+        if (i % 2) {
+            memcpy(pos, "{\"k\":", 5);
+            pos += 5;
+        } else {
+            *pos++ = '[';
+        }
+    }
+    *pos++ = '1';
+    for (size_t i = depth; i > 0; i--) {
+        *pos++ = (i - 1) % 2 ? '}' : ']';
+    }
+    *pos = '\0';
+    char* cursor = text;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .max_depth = depth };
+    int failed = json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS;
+    jtape* tape = failed ? NULL : json_tape_from_value(json);
+    jvalue* back = calloc(1, sizeof(jvalue));
+    if (!failed && (tape == NULL || json_tape_to_value(tape, JSON_TAPE_ROOT, back, NULL) != JSON_SUCCESS)) {
+        if (verbose) {
+            printf("%zu levels didn't make it through a tape\n", depth);
+        }
+        failed = 2;
+    }
+    if (!failed) {
+        char* out = json_write_to_str(back, JSON_WRITE_COMPACT, NULL);
+        if (out == NULL || strcmp(out, text) != 0) {
+            failed = 3;
+        }
+        free(out);
+    }
+    json_free_value(back);
+    json_tape_free(tape);
+    json_free_value(json);
+    free(text);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Tape\n");
+    run_test(tape_access_test, "tape_access", verbose);
+    run_test(tape_convert_test, "tape_convert", verbose);
+    run_test(tape_deep_test, "tape_deep", verbose);
+    return 0;
+}
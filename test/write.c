@@ -0,0 +1,213 @@
+//
+// Serializer tests (compact/pretty output, streaming sinks)
+// For absolute best coverage run with valgrind
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tinyjson.h"
+
+void run_test(int (*test_func)(int), char* name, const int verbose) {
+    printf("Running test \"%s\"...\n", name);
+    int result = test_func(verbose);
+    printf(result ? "failed (%d)\n" : "passed (%d)\n", result);
+}
+
+// parse in, serialize it with flags, and compare against expected
+int roundtrip(const char* in, const int flags, const char* expected, const int verbose) {
+    char* cursor = (char*)in;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    if (json_parse_value(&cursor, json) != JSON_SUCCESS) {
+        json_free_value(json);
+        if (verbose) {
+            printf("JSON_PARSE_VALUE failed (%s)\n", in);
+        }
+        return 1;
+    }
+    size_t length = 0;
+    char* out = json_write_to_str(json, flags, &length);
+    if (out == NULL || strcmp(out, expected) != 0 || length != strlen(expected)) {
+        if (verbose) {
+            printf("Output comparison failed:\n%s\n", out);
+        }
+        json_free_value(json);
+        free(out);
+        return 1;
+    }
+    json_free_value(json);
+    free(out);
+    return 0;
+}
+
+int write_compact_test(const int verbose) {
+    return roundtrip("{ \"a\" : [1, 2, { }], \"b\" : { \"c\" : null, \"d\" : [ ] }, \"e\" : \"text\" }",
+                     JSON_WRITE_COMPACT, "{\"a\":[1,2,{}],\"b\":{\"c\":null,\"d\":[]},\"e\":\"text\"}", verbose);
+}
+
+int write_pretty_test(const int verbose) {
+    return roundtrip("{\"a\":[1,true],\"b\":{\"c\":false}}", JSON_WRITE_PRETTY,
+                     "{\n    \"a\": [\n        1,\n        true\n    ],\n    \"b\": {\n        \"c\": false\n    }\n}", verbose);
+}
+
+int write_escape_test(const int verbose) {
+    // escapes are decoded on the way in and only the necessary ones come back out (\u escapes as plain utf-8)
+    if (roundtrip("{\"k\\\"ey\" : [\"q\\\"b\\\\s\\/n\\nt\\tc\\u0001e\\u00e9\\u20AC\\ud83d\\ude00\", \"\\b\\f\\r\"]}", JSON_WRITE_COMPACT,
+                  "{\"k\\\"ey\":[\"q\\\"b\\\\s/n\\nt\\tc\\u0001e\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\",\"\\b\\f\\r\"]}", verbose)) {
+        return 1;
+    }
+    // strings built by hand get escaped too
+    jvalue* json = calloc(1, sizeof(jvalue));
+    json->type = JSON_STRING;
+    json->string = strdup("tab\there \x1f \"quoted\" back\\slash");
+    char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+    int failed = out == NULL || strcmp(out, "\"tab\\there \\u001f \\\"quoted\\\" back\\\\slash\"") != 0;
+    if (failed && verbose) {
+        printf("Escaped as %s\n", out ? out : "(failure)");
+    }
+    free(out);
+    json_free_value(json);
+    // in-situ parses decode in place
+    char text[] = "[\"a\\u0062\\n\", \"\\\\\"]";
+    char* cursor = text;
+    json = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_INSITU };
+    if (json_parse_value_opts(&cursor, json, &opts) != JSON_SUCCESS || strcmp(json->elements[0].string, "ab\n") != 0
+        || strcmp(json->elements[1].string, "\\") != 0) {
+        failed = 2;
+    }
+    json_free_value(json);
+    // malformed escapes and lone surrogates don't parse
+    const char* invalid[] = { "\"\\x\"", "\"\\u12\"", "\"\\u12G4\"", "\"\\ud800\"", "\"\\udc00\"", "\"\\ud800\\u0041\"", "\"\\ud800x\"" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        cursor = (char*)invalid[i];
+        json = calloc(1, sizeof(jvalue));
+        if (json_parse_value(&cursor, json) != JSON_FAILURE) {
+            if (verbose) {
+                printf("%s was accepted\n", invalid[i]);
+            }
+            failed = 3;
+        }
+        json_free_value(json);
+    }
+    return failed;
+}
+
+typedef struct counting_sink {
+    size_t calls;
+    size_t bytes;
+    char* copy;
+} counting_sink;
+
+int count_chunks(void* user, const char* data, size_t length) {
+    counting_sink* sink = user;
+    memcpy(sink->copy + sink->bytes, data, length);
+    sink->calls++;
+    sink->bytes += length;
+    return JSON_SUCCESS;
+}
+
+int write_sink_test(const int verbose) {
+    // big enough array that the sink has to be flushed several times
+    const int count = 5000;
+    char* in = malloc(count * 6 + 3);
+    char* pos = in;
+    *pos++ = '[';
+    for (int i = 0; i < count; i++) {
+        pos += sprintf(pos, i ? ",%d" : "%d", i % 1000);
+    }
+    *pos++ = ']';
+    *pos = '\0';
+    char* cursor = in;
+    jvalue* json = calloc(1, sizeof(jvalue));
+    if (json_parse_value(&cursor, json) != JSON_SUCCESS) {
+        if (verbose) {
+            printf("JSON_PARSE_VALUE failed\n");
+        }
+        json_free_value(json);
+        free(in);
+        return 1;
+    }
+    counting_sink sink = { 0, 0, calloc(strlen(in) + 1, 1) };
+    int result = json_write_value(json, JSON_WRITE_COMPACT, count_chunks, &sink);
+    if (result != JSON_SUCCESS || sink.calls < 2 || strcmp(sink.copy, in) != 0) {
+        if (verbose) {
+            printf("Streamed output is incorrect (%zu chunks, %zu bytes)\n", sink.calls, sink.bytes);
+        }
+        result = 1;
+    }
+    json_free_value(json);
+    free(sink.copy);
+    free(in);
+    return result;
+}
+
+int write_nonfinite_test(const int verbose) {
+    // nan and the infinities can't be written as JSON numbers, so writing fails instead of changing them to something else
+    const double bad[] = { NAN, INFINITY, -INFINITY };
+    int failed = 0;
+    for (int i = 0; i < 3; i++) {
+        char in[] = "[1, 2.5, {\"x\": 3.5}]";
+        char* cursor = in;
+        jvalue* json = calloc(1, sizeof(jvalue));
+        json_parse_value(&cursor, json);
+        json->elements[2].members[0].value.number = bad[i];
+        counting_sink sink = { 0, 0, calloc(sizeof(in), 1) };
+        char* out = json_write_to_str(json, JSON_WRITE_COMPACT, NULL);
+        if (out != NULL || json_write_value(json, JSON_WRITE_PRETTY, count_chunks, &sink) != JSON_FAILURE) {
+            if (verbose) {
+                printf("Wrote %f as %s\n", bad[i], out);
+            }
+            failed = 1;
+        }
+        free(out);
+        free(sink.copy);
+        json_free_value(json);
+    }
+    // packed arrays too
+    jvalue* packed = calloc(1, sizeof(jvalue));
+    const jparse_options opts = { .flags = JSON_PARSE_PACK_NUMBERS };
+    json_parse_n("[0.5, 1.5]", 10, packed, &opts, NULL);
+    json_array_doubles(packed)[1] = INFINITY;
+    if (!failed && json_write_to_str(packed, JSON_WRITE_COMPACT, NULL) != NULL) {
+        failed = 2;
+    }
+    // json_print_value prints nothing at all when a write fails halfway (here a lazy span that doesn't parse)
+    char malformed[] = "{\"a\": 1, \"b\": [1, 2,]}";
+    jvalue* lazy = calloc(1, sizeof(jvalue));
+    const jparse_options lazy_opts = { .flags = JSON_PARSE_LAZY };
+    json_parse_n(malformed, strlen(malformed), lazy, &lazy_opts, NULL);
+    FILE* captured = tmpfile();
+    fflush(stdout);
+    const int saved = dup(STDOUT_FILENO);
+    dup2(fileno(captured), STDOUT_FILENO);
+    json_print_value(lazy);
+    json_print_value(packed);
+    fflush(stdout);
+    const off_t after_failures = lseek(fileno(captured), 0, SEEK_END);
+    json_print_value(json_search_by_key("a", lazy));
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    if (!failed && (after_failures != 0 || lseek(fileno(captured), 0, SEEK_END) != 2)) {
+        failed = 3;
+    }
+    fclose(captured);
+    json_free_value(lazy);
+    json_free_value(packed);
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const int verbose = 1;
+    printf("Serializer\n");
+    run_test(write_compact_test, "write_compact", verbose);
+    run_test(write_pretty_test, "write_pretty", verbose);
+    run_test(write_escape_test, "write_escape", verbose);
+    run_test(write_sink_test, "write_sink", verbose);
+    run_test(write_nonfinite_test, "write_nonfinite", verbose);
+    return 0;
+}